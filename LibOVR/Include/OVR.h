@@ -18,6 +18,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "../Src/Kernel/OVR_Allocator.h"
 #include "../Src/Kernel/OVR_Log.h"
 #include "../Src/Kernel/OVR_Math.h"
+#include "../Src/Kernel/OVR_Profiler.h"
 #include "../Src/Kernel/OVR_System.h"
 #include "../Src/Kernel/OVR_Types.h"
 #include "../Src/OVR_Device.h"
@@ -25,7 +26,11 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "../Src/OVR_DeviceHandle.h"
 #include "../Src/OVR_DeviceMessages.h"
 #include "../Src/OVR_SensorFusion.h"
+#include "../Src/Util/Util_LatencyStatistics.h"
 #include "../Src/Util/Util_LatencyTest.h"
+#include "../Src/Util/Util_Render_DynamicResolution.h"
+#include "../Src/Util/Util_Render_FrameTiming.h"
+#include "../Src/Util/Util_Render_SoftwareDistortion.h"
 #include "../Src/Util/Util_Render_Stereo.h"
 
 #endif
@@ -0,0 +1,392 @@
+/************************************************************************************
+
+Filename    :   OVR_Profiler.cpp
+Content     :   Low-overhead hierarchical CPU profiler with scoped markers
+Created     :
+Notes       :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+************************************************************************************/
+
+#include "OVR_Profiler.h"
+#include "OVR_Timer.h"
+#include "OVR_Alg.h"
+#include "OVR_Atomic.h"
+#include "OVR_Threads.h"
+#include "OVR_SysFile.h"
+#include "OVR_String.h"
+#include "OVR_Std.h"
+
+#include <signal.h>
+
+namespace OVR {
+
+//-----------------------------------------------------------------------------------
+// ***** Thread buffers
+
+// A scope guarded by a sequence count, which is odd while the owning thread writes
+// the scope. Readers copy the scope and check that the count was even and unchanged
+// meanwhile, so that they never see a torn UInt64 on 32-bit builds.
+struct ProfilerScopeSlot
+{
+    mutable AtomicInt<UInt32> Seq;
+    ProfilerScope             Scope;
+
+    void BeginWrite()   { Seq.ExchangeAdd_Sync(1); }
+    void EndWrite()     { Seq.Store_Release(Seq.Load_Acquire() + 1); }
+
+    // Copies the scope; returns false if it was being written, even after a few retries.
+    bool Read(ProfilerScope* scope) const
+    {
+        for (int retry = 0; retry < 4; retry++)
+        {
+            UInt32 seq = Seq.Load_Acquire();
+            if (seq & 1)
+                continue;
+            *scope = Scope;
+            // A full barrier, so that the copy is complete before the count is read again.
+            if (Seq.ExchangeAdd_Sync(0) == seq)
+                return true;
+        }
+        return false;
+    }
+};
+
+// Scopes of one thread. Only the owning thread writes to it; EndFrame reads the
+// scopes below WriteCount, which is published after each scope is initialized.
+// A scope that is being written while it is read is skipped.
+struct ProfilerThreadBuffer
+{
+#ifdef OVR_ENABLE_THREADS
+    ThreadId         Id;
+#endif
+    AtomicInt<UInt32> WriteCount;
+    ProfilerScopeSlot Slots[Profiler::ThreadBufferSize];
+    char             Name[Profiler::MaxThreadName];
+
+    // Indices of open scopes; SkippedDepth counts pushes beyond MaxDepth.
+    UInt32           OpenScopes[Profiler::MaxDepth];
+    int              Depth;
+    int              SkippedDepth;
+};
+
+static ProfilerThreadBuffer ProfilerThreads[Profiler::MaxThreads];
+static AtomicInt<int>       ProfilerThreadCount;
+static Lock                 ProfilerThreadLock;
+
+static UInt64               ProfilerFrameStart = 0;
+static double               ProfilerPeakHoldTime = 2.0;
+
+static char                 ProfilerTracePath[256];
+static volatile sig_atomic_t ProfilerTraceRequested = 0;
+
+// Recording is on while enabled through SetEnabled or while a trace signal is installed.
+static bool                 ProfilerEnableRequested = false;
+static bool                 ProfilerTraceSignalSet  = false;
+
+bool          Profiler::Enabled = false;
+ProfilerFrame Profiler::LastFrame;
+ProfilerFrame Profiler::PeakFrame;
+
+
+// Returns the buffer of a thread, registering it on first use; null once all
+// buffers are taken.
+static ProfilerThreadBuffer* GetProfilerThreadBuffer(ThreadId id)
+{
+#ifdef OVR_ENABLE_THREADS
+    int count = ProfilerThreadCount.Load_Acquire();
+    for (int i = 0; i < count; i++)
+    {
+        if (ProfilerThreads[i].Id == id)
+            return &ProfilerThreads[i];
+    }
+
+    Lock::Locker lock(&ProfilerThreadLock);
+    count = ProfilerThreadCount.Load_Acquire();
+    for (int i = 0; i < count; i++)
+    {
+        if (ProfilerThreads[i].Id == id)
+            return &ProfilerThreads[i];
+    }
+    if (count == Profiler::MaxThreads)
+        return 0;
+
+    ProfilerThreads[count].Id = id;
+    ProfilerThreadCount.Store_Release(count + 1);
+    return &ProfilerThreads[count];
+#else
+    OVR_UNUSED(id);
+    if (ProfilerThreadCount.Load_Acquire() == 0)
+        ProfilerThreadCount.Store_Release(1);
+    return &ProfilerThreads[0];
+#endif
+}
+
+static ProfilerThreadBuffer* GetProfilerThreadBuffer()
+{
+#ifdef OVR_ENABLE_THREADS
+    return GetProfilerThreadBuffer(GetCurrentThreadId());
+#else
+    return GetProfilerThreadBuffer(0);
+#endif
+}
+
+#if !defined(OVR_OS_WIN32)
+static void ProfilerTraceSignalHandler(int)
+{
+    ProfilerTraceRequested = 1;
+}
+#endif
+
+// Copies 'src', truncating it to fit.
+static void CopyProfilerString(char* dest, UPInt size, const char* src)
+{
+    OVR_strncpy(dest, size, src, size - 1);
+    dest[size - 1] = 0;
+}
+
+// Writes 'str' as a JSON string, quotes included.
+static void WriteJsonString(File* file, const char* str)
+{
+    char buf[256];
+    UPInt length = 0;
+    buf[length++] = '"';
+    for (; *str && (length < sizeof(buf) - 3); str++)
+    {
+        if ((*str == '"') || (*str == '\\'))
+            buf[length++] = '\\';
+        buf[length++] = ((unsigned char)*str < 0x20) ? ' ' : *str;
+    }
+    buf[length++] = '"';
+    file->Write((const UByte*)buf, (int)length);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Profiler
+
+void Profiler::SetEnabled(bool enabled)
+{
+    ProfilerEnableRequested = enabled;
+    enabled = ProfilerEnableRequested || ProfilerTraceSignalSet;
+    if (enabled && !Enabled)
+        ProfilerFrameStart = Timer::GetRawTicks();
+    Enabled = enabled;
+}
+
+void Profiler::SetPeakHoldTime(double seconds)
+{
+    ProfilerPeakHoldTime = seconds;
+}
+
+#ifdef OVR_ENABLE_THREADS
+void Profiler::SetThreadName(ThreadId id, const char* name)
+{
+    ProfilerThreadBuffer* buffer = GetProfilerThreadBuffer(id);
+    if (buffer)
+        CopyProfilerString(buffer->Name, sizeof(buffer->Name), name);
+}
+#endif
+
+bool Profiler::WriteChromeTrace(const char* path)
+{
+    SysFile file;
+    if (!file.Open(path, File::Open_Write | File::Open_Create | File::Open_Truncate | File::Open_Buffered))
+        return false;
+
+    // Chrome expects timestamps in microseconds; they are made relative to the
+    // oldest scope to keep them short.
+    UInt64 frequency   = Timer::GetRawFrequency();
+    UInt64 now         = Timer::GetRawTicks();
+    int    threadCount = ProfilerThreadCount.Load_Acquire();
+    UInt64 origin      = now;
+    for (int t = 0; t < threadCount; t++)
+    {
+        const ProfilerThreadBuffer& buffer = ProfilerThreads[t];
+        UInt32 writeCount = buffer.WriteCount.Load_Acquire();
+        UInt32 first      = (writeCount < ThreadBufferSize) ? 0 : writeCount - ThreadBufferSize;
+        ProfilerScope scope;
+        if ((writeCount != first) && buffer.Slots[first & (ThreadBufferSize - 1)].Read(&scope))
+            origin = Alg::Min(origin, scope.Start);
+    }
+
+    const char* separator = "\n";
+    char        buf[256];
+    file.Write((const UByte*)"{\"traceEvents\":[", 16);
+
+    for (int t = 0; t < threadCount; t++)
+    {
+        const ProfilerThreadBuffer& buffer = ProfilerThreads[t];
+        if (buffer.Name[0])
+        {
+            int n = (int)OVR_sprintf(buf, sizeof(buf),
+                                     "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":",
+                                     separator, t);
+            file.Write((const UByte*)buf, n);
+            WriteJsonString(&file, buffer.Name);
+            file.Write((const UByte*)"}}", 2);
+            separator = ",\n";
+        }
+
+        // Open scopes, and scopes overwritten while they were read, are skipped.
+        UInt32 writeCount = buffer.WriteCount.Load_Acquire();
+        UInt32 first      = (writeCount < ThreadBufferSize) ? 0 : writeCount - ThreadBufferSize;
+        for (UInt32 i = first; i != writeCount; i++)
+        {
+            ProfilerScope scope;
+            if (!buffer.Slots[i & (ThreadBufferSize - 1)].Read(&scope))
+                continue;
+            if ((scope.End < scope.Start) || (scope.Start < origin) || (scope.End > now))
+                continue;
+
+            double start    = double(scope.Start - origin) * 1000000.0 / double(frequency);
+            double duration = double(scope.End - scope.Start) * 1000000.0 / double(frequency);
+            int n = (int)OVR_sprintf(buf, sizeof(buf),
+                                     "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                                     separator, t, start, duration);
+            file.Write((const UByte*)buf, n);
+            WriteJsonString(&file, scope.Name);
+            file.Write((const UByte*)"}", 1);
+            separator = ",\n";
+        }
+    }
+
+    file.Write((const UByte*)"\n]}\n", 4);
+    return file.Close();
+}
+
+bool Profiler::SetTraceSignal(const char* path)
+{
+#if !defined(OVR_OS_WIN32)
+    CopyProfilerString(ProfilerTracePath, sizeof(ProfilerTracePath), path);
+    signal(SIGUSR1, ProfilerTraceSignalHandler);
+
+    // A trace is only useful if scopes were recorded before the signal came.
+    ProfilerTraceSignalSet = true;
+    SetEnabled(ProfilerEnableRequested);
+    return true;
+#else
+    OVR_UNUSED(path);
+    return false;
+#endif
+}
+
+void Profiler::Push(const char* name)
+{
+    ProfilerThreadBuffer* buffer = GetProfilerThreadBuffer();
+    if (!buffer)
+        return;
+
+    if (buffer->Depth == MaxDepth)
+    {
+        buffer->SkippedDepth++;
+        return;
+    }
+
+    UInt32             index = buffer->WriteCount.Load_Acquire();
+    ProfilerScopeSlot& slot  = buffer->Slots[index & (ThreadBufferSize - 1)];
+    slot.BeginWrite();
+    slot.Scope.Name   = name;
+    slot.Scope.End    = 0;
+    slot.Scope.Depth  = (UInt16)buffer->Depth;
+    slot.Scope.Thread = (UInt16)(buffer - ProfilerThreads);
+    slot.Scope.Start  = Timer::GetRawTicks();
+    slot.EndWrite();
+
+    buffer->OpenScopes[buffer->Depth++] = index;
+    buffer->WriteCount.Store_Release(index + 1);
+}
+
+void Profiler::Pop()
+{
+    UInt64                end    = Timer::GetRawTicks();
+    ProfilerThreadBuffer* buffer = GetProfilerThreadBuffer();
+    if (!buffer)
+        return;
+
+    if (buffer->SkippedDepth > 0)
+    {
+        buffer->SkippedDepth--;
+        return;
+    }
+    if (buffer->Depth == 0)
+        return;
+
+    UInt32 index = buffer->OpenScopes[--buffer->Depth];
+    // The scope was overwritten if more than a full buffer was marked while it was open.
+    if (buffer->WriteCount.Load_Acquire() - index <= ThreadBufferSize)
+    {
+        ProfilerScopeSlot& slot = buffer->Slots[index & (ThreadBufferSize - 1)];
+        slot.BeginWrite();
+        slot.Scope.End = end;
+        slot.EndWrite();
+    }
+}
+
+void Profiler::EndFrame()
+{
+    UInt64 now = Timer::GetRawTicks();
+
+    ProfilerFrame& frame = LastFrame;
+    frame.Start        = ProfilerFrameStart;
+    frame.End          = now;
+    frame.RawFrequency = Timer::GetRawFrequency();
+    frame.ScopeCount   = 0;
+
+    int threadCount = ProfilerThreadCount.Load_Acquire();
+    for (int t = 0; t < threadCount; t++)
+    {
+        const ProfilerThreadBuffer& buffer = ProfilerThreads[t];
+        UInt32 writeCount = buffer.WriteCount.Load_Acquire();
+        UInt32 available  = (writeCount < ThreadBufferSize) ? writeCount : (UInt32)ThreadBufferSize;
+
+        // Scopes are started in index order, so walk back to the first one of the frame.
+        UInt32 first = writeCount;
+        while ((writeCount - first) < available)
+        {
+            ProfilerScope scope;
+            if (!buffer.Slots[(first - 1) & (ThreadBufferSize - 1)].Read(&scope) ||
+                (scope.Start < frame.Start))
+                break;
+            first--;
+        }
+
+        for (UInt32 i = first; i != writeCount; i++)
+        {
+            if (frame.ScopeCount == ProfilerFrame::MaxScopes)
+                break;
+
+            ProfilerScope scope;
+            if (!buffer.Slots[i & (ThreadBufferSize - 1)].Read(&scope) || (scope.Start > now))
+                continue;
+            if ((scope.End == 0) || (scope.End > now))
+                scope.End = now;
+            frame.Scopes[frame.ScopeCount++] = scope;
+        }
+    }
+
+    // Keep the slowest frame until a slower one comes or it has been held long enough.
+    double heldFor = double(now - PeakFrame.End) / double(frame.RawFrequency);
+    if ((PeakFrame.ScopeCount == 0) || (frame.GetDuration() >= PeakFrame.GetDuration()) ||
+        (heldFor > ProfilerPeakHoldTime))
+    {
+        PeakFrame = frame;
+    }
+
+    // Traces requested by signal are written here, outside of the signal handler.
+    if (ProfilerTraceRequested)
+    {
+        ProfilerTraceRequested = 0;
+        WriteChromeTrace(ProfilerTracePath);
+    }
+
+    ProfilerFrameStart = now;
+}
+
+
+} // OVR
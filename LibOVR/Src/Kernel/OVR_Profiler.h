@@ -0,0 +1,164 @@
+/************************************************************************************
+
+PublicHeader:   OVR
+Filename    :   OVR_Profiler.h
+Content     :   Low-overhead hierarchical CPU profiler with scoped markers
+Created     :
+Notes       :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+************************************************************************************/
+
+#ifndef OVR_Profiler_h
+#define OVR_Profiler_h
+
+#include "OVR_Types.h"
+#include "OVR_Threads.h"
+
+namespace OVR {
+
+//-----------------------------------------------------------------------------------
+// ***** ProfilerScope
+
+// A named CPU time range recorded by the profiler. Times are in Timer::GetRawTicks
+// units; ProfilerFrame::ToSeconds converts them relative to the frame start.
+struct ProfilerScope
+{
+    const char* Name;
+    UInt64      Start;
+    UInt64      End;
+    UInt16      Depth;      // Nesting level within its thread, 0 for outermost.
+    UInt16      Thread;     // Index of the thread, in the order threads first marked a scope.
+};
+
+
+//-----------------------------------------------------------------------------------
+// ***** ProfilerFrame
+
+// Scopes that started during one frame, from all threads. Scopes are ordered by thread
+// and then by start time, so that each thread's scopes are listed parent first.
+// Scopes that were still open when the frame ended are clipped to its end.
+class ProfilerFrame
+{
+public:
+    enum { MaxScopes = 512 };
+
+    UInt64          Start, End;
+    UInt64          RawFrequency;
+    int             ScopeCount;
+    ProfilerScope   Scopes[MaxScopes];
+
+    ProfilerFrame() : Start(0), End(0), RawFrequency(1), ScopeCount(0) { }
+
+    double  GetDuration() const             { return double(End - Start) / double(RawFrequency); }
+    // Converts a raw tick value into seconds since the frame start.
+    double  ToSeconds(UInt64 ticks) const   { return (double(ticks) - double(Start)) / double(RawFrequency); }
+};
+
+
+//-----------------------------------------------------------------------------------
+// ***** Profiler
+
+// Profiler records nested, named time ranges from any thread. Each thread writes only
+// to its own ring buffer, so marking a scope takes no locks; when the profiler is
+// disabled, a marker costs a single test. Ranges are marked with OVR_PROFILE_SCOPE,
+// which closes the range when the enclosing block is left:
+//
+//      void Player::HandleCollision(...)
+//      {
+//          OVR_PROFILE_SCOPE("HandleCollision");
+//          ...
+//      }
+//
+// The main loop calls EndFrame once per frame; it collects the scopes of the frame
+// from all threads into GetLastFrame. Averages hide the occasional slow frame, so the
+// slowest frame of the last few seconds is held in GetPeakFrame as well.
+//
+// The scopes still held in the thread buffers can also be written out as a Chrome
+// trace (chrome://tracing) with WriteChromeTrace, giving one timeline of all threads;
+// threads are labelled with the names given to Thread::SetThreadName.
+//
+// Threads beyond MaxThreads and scopes nested deeper than MaxDepth are not recorded.
+// Each thread keeps its last ThreadBufferSize scopes.
+
+class Profiler
+{
+public:
+    enum
+    {
+        MaxThreads       = 8,
+        MaxDepth         = 32,
+        MaxThreadName    = 32,
+        ThreadBufferSize = 4096     // Must be a power of two.
+    };
+
+    static void     SetEnabled(bool enabled);
+    static bool     IsEnabled()                 { return Enabled; }
+
+    // Opens and closes a range on the calling thread. 'name' isn't copied, and must
+    // stay valid; usually it is a string literal.
+    static void     Push(const char* name);
+    static void     Pop();
+
+    // Ends the current frame on the calling thread and starts the next one.
+    static void     EndFrame();
+
+    static const ProfilerFrame& GetLastFrame()  { return LastFrame; }
+    static const ProfilerFrame& GetPeakFrame()  { return PeakFrame; }
+
+    // Time for which the slowest frame is kept, in seconds; 2 by default.
+    static void     SetPeakHoldTime(double seconds);
+
+#ifdef OVR_ENABLE_THREADS
+    // Names the thread in traces; called by Thread::SetThreadName. The name is copied.
+    static void     SetThreadName(ThreadId id, const char* name);
+#endif
+
+    // Writes all scopes held in the thread buffers to 'path' in the Chrome trace event
+    // JSON format. Returns false if the file can't be written.
+    static bool     WriteChromeTrace(const char* path);
+
+    // Makes SIGUSR1 request a trace, which the next EndFrame writes to 'path'. Returns
+    // false where signals are not supported. Once the signal is installed, scopes are
+    // recorded even while the profiler is disabled through SetEnabled, so that the
+    // trace holds the scopes leading up to the signal.
+    static bool     SetTraceSignal(const char* path);
+
+private:
+    static bool          Enabled;
+    static ProfilerFrame LastFrame;
+    static ProfilerFrame PeakFrame;
+};
+
+
+// Marks the enclosing block as a profiler range; see Profiler.
+class ProfilerMarker
+{
+public:
+    ProfilerMarker(const char* name) : Active(Profiler::IsEnabled())
+    {
+        if (Active)
+            Profiler::Push(name);
+    }
+    ~ProfilerMarker()
+    {
+        if (Active)
+            Profiler::Pop();
+    }
+
+private:
+    bool Active;
+};
+
+#define OVR_PROFILE_SCOPE_CAT2(a, b)    a##b
+#define OVR_PROFILE_SCOPE_CAT(a, b)     OVR_PROFILE_SCOPE_CAT2(a, b)
+#define OVR_PROFILE_SCOPE(name)         OVR::ProfilerMarker OVR_PROFILE_SCOPE_CAT(ovrProfilerMarker, __LINE__)(name)
+
+} // OVR
+
+#endif
@@ -332,11 +332,8 @@ public:
 
 
     // *** Debugging functionality
-#if defined(OVR_OS_WIN32)
+    // Names the thread for the debugger, where supported, and for Profiler traces.
     virtual void    SetThreadName( const char* name );
-#else
-    virtual void    SetThreadName( const char* name ) { OVR_UNUSED(name); }
-#endif
 
 private:
 #if defined(OVR_OS_WIN32)
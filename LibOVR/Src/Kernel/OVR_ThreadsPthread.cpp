@@ -6,6 +6,7 @@
 
 #include "OVR_Timer.h"
 #include "OVR_Log.h"
+#include "OVR_Profiler.h"
 
 #include <pthread.h>
 #include <time.h>
@@ -777,10 +778,22 @@ bool    Thread::MSleep(unsigned msecs)
     return 1;
 }
 
+void Thread::SetThreadName( const char* name )
+{
+    // Threads usually name themselves at the start of Run, possibly before
+    // pthread_create has stored ThreadHandle.
+    Profiler::SetThreadName(ThreadHandle ? GetThreadId() : GetCurrentThreadId(), name);
+}
+
 /* static */
 int     Thread::GetCPUCount()
 {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int)count : 1;
+#else
     return 1;
+#endif
 }
 
 
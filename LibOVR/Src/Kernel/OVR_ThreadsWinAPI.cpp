@@ -17,6 +17,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "OVR_Threads.h"
 #include "OVR_Hash.h"
 #include "OVR_Log.h"
+#include "OVR_Profiler.h"
 
 #ifdef OVR_ENABLE_THREADS
 
@@ -942,6 +943,8 @@ bool Thread::MSleep(unsigned msecs)
 
 void Thread::SetThreadName( const char* name )
 {
+    Profiler::SetThreadName(GetThreadId(), name);
+
 #if !defined(OVR_BUILD_SHIPPING) || defined(OVR_BUILD_PROFILING)
     // Looks ugly, but it is the recommended way to name a thread.
     typedef struct tagTHREADNAME_INFO {
@@ -250,7 +250,20 @@ public:
     // End users should call DeumerateDevices<>() instead.
     virtual DeviceEnumerator<> EnumerateDevicesEx(const DeviceEnumerationArgs& args) = 0;
 
-    
+    // Enables an on-disk cache of HMD display info and sensor range, keyed by sensor
+    // serial number and firmware version. With the cache in place, devices seen before
+    // report HMDInfo without waiting on USB feature reads; the reports are then read
+    // in the background to validate the cached values. Call this before enumerating
+    // devices; passing a null or empty path disables the cache (default).
+    virtual void       SetDeviceInfoCachePath(const char* path) = 0;
+
+    // Adds or removes a software Latency Tester that is enumerated like a plugged-in
+    // one. Instead of sensing the screen, it is told by the application which color
+    // each frame put under the tester location and when that frame was scanned out;
+    // see LatencyTestDevice::ReportScanoutColor. Disabled by default.
+    virtual void       SetVirtualLatencyTesterEnabled(bool enabled) = 0;
+
+
     // Creates a new DeviceManager. Only one instance of DeviceManager should be created at a time.
     static   DeviceManager* Create();
 
@@ -581,6 +594,13 @@ public:
     virtual bool       SetCalibrate(const LatencyTestCalibrate& calibrate, bool waitFlag = false) = 0;
     virtual bool       SetStartTest(const LatencyTestStartTest& start, bool waitFlag = false) = 0;
     virtual bool       SetDisplay(const LatencyTestDisplay& display, bool waitFlag = false) = 0;
+
+    // Used with virtual testers only (see DeviceManager::SetVirtualLatencyTesterEnabled):
+    // reports the color read back from the tester location of a rendered frame, together
+    // with the Timer::GetTicks() time at which that frame reached (simulated) scanout;
+    // 0 stands for the current time. Returns false for hardware testers.
+    virtual bool       ReportScanoutColor(const Color& color, UInt64 scanoutTicksMicroS = 0)
+    { OVR_UNUSED2(color, scanoutTicksMicroS); return false; }
 };
 
 } // namespace OVR
@@ -14,6 +14,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 *************************************************************************************/
 
 #include "OVR_DeviceImpl.h"
+#include "OVR_VirtualLatencyTest.h"
 #include "Kernel/OVR_Atomic.h"
 #include "Kernel/OVR_Log.h"
 #include "Kernel/OVR_System.h"
@@ -540,6 +541,31 @@ Void DeviceManagerImpl::EnumerateFactoryDevices(DeviceFactory* factory)
 }
 
 
+void DeviceManagerImpl::SetVirtualLatencyTesterEnabled(bool enabled)
+{
+    VirtualLatencyTestDeviceFactory* factory = &VirtualLatencyTestDeviceFactory::Instance;
+    {
+        Lock::Locker deviceLock(GetLock());
+
+        if (factory->GetManagerImpl() != this)
+        {
+            if (!enabled)
+                return;
+            if (factory->GetManagerImpl())
+            {
+                LogError("OVR::DeviceManager - Virtual Latency Tester is in use by another manager\n");
+                return;
+            }
+            AddFactory(factory);
+        }
+        factory->Enabled = enabled;
+    }
+
+    // Re-enumerate so that the device is added or removed as if it was hot-plugged.
+    GetThreadQueue()->PushCall(this, &DeviceManagerImpl::EnumerateAllFactoryDevices, true);
+}
+
+
 DeviceEnumerator<> DeviceManagerImpl::EnumerateDevicesEx(const DeviceEnumerationArgs& args)
 {
     Lock::Locker deviceLock(GetLock());
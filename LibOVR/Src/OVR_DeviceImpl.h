@@ -17,6 +17,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #define OVR_DeviceImpl_h
 
 #include "OVR_Device.h"
+#include "OVR_DeviceInfoCache.h"
 #include "Kernel/OVR_Atomic.h"
 #include "Kernel/OVR_Log.h"
 #include "Kernel/OVR_System.h"
@@ -329,6 +330,9 @@ public:
 
     virtual DeviceEnumerator<> EnumerateDevicesEx(const DeviceEnumerationArgs& args);
 
+    virtual void SetDeviceInfoCachePath(const char* path) { InfoCache.SetFilePath(path); }
+    virtual void SetVirtualLatencyTesterEnabled(bool enabled);
+
 
     // 
     void AddFactory(DeviceFactory* factory)
@@ -370,6 +374,9 @@ public:
 
     // Factories used to detect and manage devices.
     List<DeviceFactory>   Factories;
+
+    // Cached sensor DisplayInfo/Range reports; used by factories to skip USB reads.
+    DeviceInfoCache       InfoCache;
 };
 
 
@@ -0,0 +1,280 @@
+/************************************************************************************
+
+Filename    :   OVR_DeviceInfoCache.cpp
+Content     :   On-disk cache of sensor-reported display info and sensor range
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "OVR_DeviceInfoCache.h"
+
+#include "Kernel/OVR_SysFile.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_Log.h"
+
+namespace OVR {
+
+// File layout, all values little-endian:
+//   UInt32 Magic, UInt32 FormatVersion, UInt32 RecordCount, followed by records
+//   written field by field in the order declared in DeviceInfoCache::Record.
+enum
+{
+    DeviceInfoCache_Magic         = 0x4344564F, // "OVDC"
+    DeviceInfoCache_FormatVersion = 1,
+    DeviceInfoCache_HeaderSize    = 12,
+    DeviceInfoCache_RecordSize    = 91,
+    DeviceInfoCache_MaxRecords    = 64
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** DeviceInfoCache::Record
+
+DeviceInfoCache::Record::Record()
+    : VersionNumber(0), Contents(0), DistortionType(0),
+      HResolution(0), VResolution(0), HScreenSize(0), VScreenSize(0),
+      VCenter(0), LensSeparation(0)
+{
+    SerialNumber[0] = 0;
+    EyeToScreenDistance[0] = EyeToScreenDistance[1] = 0;
+    memset(DistortionK, 0, sizeof(DistortionK));
+}
+
+DeviceInfoCache::Record::Record(const char* serialNumber, UInt16 versionNumber)
+    : VersionNumber(versionNumber), Contents(0), DistortionType(0),
+      HResolution(0), VResolution(0), HScreenSize(0), VScreenSize(0),
+      VCenter(0), LensSeparation(0)
+{
+    OVR_strcpy(SerialNumber, SerialNumberSize, serialNumber);
+    EyeToScreenDistance[0] = EyeToScreenDistance[1] = 0;
+    memset(DistortionK, 0, sizeof(DistortionK));
+}
+
+bool DeviceInfoCache::Record::MatchesKey(const char* serialNumber, UInt16 versionNumber) const
+{
+    return (VersionNumber == versionNumber) &&
+           (OVR_strncmp(SerialNumber, serialNumber, SerialNumberSize) == 0);
+}
+
+bool DeviceInfoCache::Record::MatchesContents(const Record& other, unsigned contents) const
+{
+    if (contents & Contents_Display)
+    {
+        if ((DistortionType != other.DistortionType) ||
+            (HResolution != other.HResolution) || (VResolution != other.VResolution) ||
+            (HScreenSize != other.HScreenSize) || (VScreenSize != other.VScreenSize) ||
+            (VCenter != other.VCenter) || (LensSeparation != other.LensSeparation) ||
+            (EyeToScreenDistance[0] != other.EyeToScreenDistance[0]) ||
+            (EyeToScreenDistance[1] != other.EyeToScreenDistance[1]) ||
+            memcmp(DistortionK, other.DistortionK, sizeof(DistortionK)))
+            return false;
+    }
+    if (contents & Contents_Range)
+    {
+        if ((Range.MaxAcceleration != other.Range.MaxAcceleration) ||
+            (Range.MaxRotationRate != other.Range.MaxRotationRate) ||
+            (Range.MaxMagneticField != other.Range.MaxMagneticField))
+            return false;
+    }
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** DeviceInfoCache
+
+DeviceInfoCache::DeviceInfoCache()
+{
+}
+
+void DeviceInfoCache::SetFilePath(const char* path)
+{
+    Lock::Locker lockScope(&CacheLock);
+
+    Records.Clear();
+    FilePath = path ? path : "";
+
+    if (!FilePath.IsEmpty() && loadFile())
+    {
+        LogText("OVR::DeviceInfoCache - Loaded %d records from '%s'\n",
+                (int)Records.GetSize(), FilePath.ToCStr());
+    }
+}
+
+String DeviceInfoCache::GetFilePath() const
+{
+    Lock::Locker lockScope(&CacheLock);
+    return FilePath;
+}
+
+bool DeviceInfoCache::IsEnabled() const
+{
+    Lock::Locker lockScope(&CacheLock);
+    return !FilePath.IsEmpty();
+}
+
+bool DeviceInfoCache::Find(const char* serialNumber, UInt16 versionNumber, Record* record) const
+{
+    Lock::Locker lockScope(&CacheLock);
+
+    // Devices without a serial number can't be told apart, so never cache them.
+    if (FilePath.IsEmpty() || !serialNumber || !serialNumber[0])
+        return false;
+
+    for (UPInt i = 0; i < Records.GetSize(); i++)
+    {
+        if (Records[i].MatchesKey(serialNumber, versionNumber))
+        {
+            *record = Records[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DeviceInfoCache::Update(const Record& record)
+{
+    Lock::Locker lockScope(&CacheLock);
+
+    if (FilePath.IsEmpty() || !record.SerialNumber[0] || !record.Contents)
+        return false;
+
+    Record* cached = 0;
+    for (UPInt i = 0; i < Records.GetSize(); i++)
+    {
+        if (Records[i].MatchesKey(record.SerialNumber, record.VersionNumber))
+        {
+            cached = &Records[i];
+            break;
+        }
+    }
+
+    if (!cached)
+    {
+        // Drop the oldest record to keep the file bounded.
+        if (Records.GetSize() >= DeviceInfoCache_MaxRecords)
+            Records.RemoveAt(0);
+        Records.PushBack(Record(record.SerialNumber, record.VersionNumber));
+        cached = &Records[Records.GetSize() - 1];
+    }
+    else if (((cached->Contents & record.Contents) == record.Contents) &&
+             cached->MatchesContents(record, record.Contents))
+    {
+        return false;
+    }
+
+    if (record.Contents & Record::Contents_Display)
+    {
+        cached->DistortionType         = record.DistortionType;
+        cached->HResolution            = record.HResolution;
+        cached->VResolution            = record.VResolution;
+        cached->HScreenSize            = record.HScreenSize;
+        cached->VScreenSize            = record.VScreenSize;
+        cached->VCenter                = record.VCenter;
+        cached->LensSeparation         = record.LensSeparation;
+        cached->EyeToScreenDistance[0] = record.EyeToScreenDistance[0];
+        cached->EyeToScreenDistance[1] = record.EyeToScreenDistance[1];
+        memcpy(cached->DistortionK, record.DistortionK, sizeof(cached->DistortionK));
+    }
+    if (record.Contents & Record::Contents_Range)
+    {
+        cached->Range = record.Range;
+    }
+    cached->Contents |= record.Contents;
+
+    if (!saveFile())
+    {
+        LogError("OVR::DeviceInfoCache - Failed to write '%s'\n", FilePath.ToCStr());
+    }
+    return true;
+}
+
+
+bool DeviceInfoCache::loadFile()
+{
+    SysFile file(FilePath, File::Open_Read | File::Open_Buffered);
+    if (!file.IsValid())
+        return false;
+
+    if ((file.ReadUInt32() != DeviceInfoCache_Magic) ||
+        (file.ReadUInt32() != DeviceInfoCache_FormatVersion))
+        return false;
+
+    // Reject truncated or oversized files rather than reading garbage records.
+    UInt32 count = file.ReadUInt32();
+    if ((count > DeviceInfoCache_MaxRecords) ||
+        (file.GetLength() != int(DeviceInfoCache_HeaderSize + count * DeviceInfoCache_RecordSize)))
+        return false;
+
+    for (UInt32 i = 0; i < count; i++)
+    {
+        Record r;
+        file.Read((UByte*)r.SerialNumber, Record::SerialNumberSize);
+        r.SerialNumber[Record::SerialNumberSize - 1] = 0;
+        r.VersionNumber          = file.ReadUInt16();
+        r.Contents               = file.ReadUInt32() & Record::Contents_All;
+        r.DistortionType         = file.ReadUByte();
+        r.HResolution            = file.ReadUInt16();
+        r.VResolution            = file.ReadUInt16();
+        r.HScreenSize            = file.ReadFloat();
+        r.VScreenSize            = file.ReadFloat();
+        r.VCenter                = file.ReadFloat();
+        r.LensSeparation         = file.ReadFloat();
+        r.EyeToScreenDistance[0] = file.ReadFloat();
+        r.EyeToScreenDistance[1] = file.ReadFloat();
+        for (int k = 0; k < 6; k++)
+            r.DistortionK[k]     = file.ReadFloat();
+        r.Range.MaxAcceleration  = file.ReadFloat();
+        r.Range.MaxRotationRate  = file.ReadFloat();
+        r.Range.MaxMagneticField = file.ReadFloat();
+        Records.PushBack(r);
+    }
+    return true;
+}
+
+bool DeviceInfoCache::saveFile() const
+{
+    SysFile file(FilePath, File::Open_Write | File::Open_Create | File::Open_Truncate |
+                           File::Open_Buffered);
+    if (!file.IsValid())
+        return false;
+
+    file.WriteUInt32(DeviceInfoCache_Magic);
+    file.WriteUInt32(DeviceInfoCache_FormatVersion);
+    file.WriteUInt32((UInt32)Records.GetSize());
+
+    for (UPInt i = 0; i < Records.GetSize(); i++)
+    {
+        const Record& r = Records[i];
+        file.Write((const UByte*)r.SerialNumber, Record::SerialNumberSize);
+        file.WriteUInt16(r.VersionNumber);
+        file.WriteUInt32(r.Contents);
+        file.WriteUByte(r.DistortionType);
+        file.WriteUInt16(r.HResolution);
+        file.WriteUInt16(r.VResolution);
+        file.WriteFloat(r.HScreenSize);
+        file.WriteFloat(r.VScreenSize);
+        file.WriteFloat(r.VCenter);
+        file.WriteFloat(r.LensSeparation);
+        file.WriteFloat(r.EyeToScreenDistance[0]);
+        file.WriteFloat(r.EyeToScreenDistance[1]);
+        for (int k = 0; k < 6; k++)
+            file.WriteFloat(r.DistortionK[k]);
+        file.WriteFloat(r.Range.MaxAcceleration);
+        file.WriteFloat(r.Range.MaxRotationRate);
+        file.WriteFloat(r.Range.MaxMagneticField);
+    }
+
+    bool ok = (file.GetErrorCode() == 0);
+    return file.Close() && ok;
+}
+
+
+} // namespace OVR
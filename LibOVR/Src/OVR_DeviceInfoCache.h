@@ -0,0 +1,104 @@
+/************************************************************************************
+
+Filename    :   OVR_DeviceInfoCache.h
+Content     :   On-disk cache of sensor-reported display info and sensor range
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_DeviceInfoCache_h
+#define OVR_DeviceInfoCache_h
+
+#include "OVR_Device.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_String.h"
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// ***** DeviceInfoCache
+
+// DeviceInfoCache stores the DisplayInfo and SensorRange feature reports of each
+// sensor seen so far, keyed by its serial number and firmware version. Reading these
+// reports costs a USB round trip each, so platform factories consult the cache first
+// and validate the cached values asynchronously once the device is running.
+//
+// The cache is disabled until a file path is assigned through
+// DeviceManager::SetDeviceInfoCachePath. All functions are thread-safe.
+
+class DeviceInfoCache
+{
+public:
+
+    struct Record
+    {
+        // Flags for Contents, describing which parts of the record are valid.
+        enum
+        {
+            Contents_Display = 1,
+            Contents_Range   = 2,
+            Contents_All     = Contents_Display | Contents_Range
+        };
+
+        enum { SerialNumberSize = 20 };
+
+        char        SerialNumber[SerialNumberSize];
+        UInt16      VersionNumber;
+        unsigned    Contents;
+
+        // Display info, in the units reported by the sensor DisplayInfo feature.
+        UByte       DistortionType;
+        UInt16      HResolution, VResolution;
+        float       HScreenSize, VScreenSize;
+        float       VCenter;
+        float       LensSeparation;
+        float       EyeToScreenDistance[2];
+        float       DistortionK[6];
+
+        // Sensor range currently configured on the device.
+        SensorRange Range;
+
+        Record();
+        Record(const char* serialNumber, UInt16 versionNumber);
+
+        bool MatchesKey(const char* serialNumber, UInt16 versionNumber) const;
+        // Returns true if 'other' holds the same values for the contents both describe.
+        bool MatchesContents(const Record& other, unsigned contents) const;
+    };
+
+    DeviceInfoCache();
+
+    // Assigns the file backing this cache and loads its contents. Passing a null or
+    // empty path disables caching.
+    void    SetFilePath(const char* path);
+    String  GetFilePath() const;
+    bool    IsEnabled() const;
+
+    // Looks up the record for a device; returns false if caching is disabled or
+    // nothing is known about the device.
+    bool    Find(const char* serialNumber, UInt16 versionNumber, Record* record) const;
+
+    // Merges the valid contents of 'record' into the cache and rewrites the file if
+    // anything changed. Returns true if cached values were added or modified.
+    bool    Update(const Record& record);
+
+private:
+    bool    loadFile();
+    bool    saveFile() const;
+
+    mutable Lock    CacheLock;
+    String          FilePath;
+    Array<Record>   Records;
+};
+
+
+} // namespace OVR
+
+#endif // OVR_DeviceInfoCache_h
@@ -0,0 +1,596 @@
+/************************************************************************************
+
+Filename    :   OVR_SensorBroker.cpp
+Content     :   Shared-memory publishing of SensorFusion state to other processes
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "OVR_SensorBroker.h"
+
+#include "Kernel/OVR_Atomic.h"
+#include "Kernel/OVR_Timer.h"
+#include "Kernel/OVR_String.h"
+#include "Kernel/OVR_Log.h"
+
+#if defined(OVR_OS_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace OVR {
+
+typedef AtomicOps<UInt32> SeqOps;
+
+//-------------------------------------------------------------------------------------
+// ***** SensorBrokerLayout
+
+// Contents of the shared memory segment. Slot i holds frame Index where
+// (Index % RingSize) == i; its Seq is 0 while the writer is filling it in and equals
+// the frame Index once the frame is complete. LatestIndex is stored after the slot,
+// so readers following it always find a completed frame unless the ring wrapped.
+struct SensorBrokerLayout
+{
+    enum
+    {
+        MagicValue     = 0x4B425253, // "SRBK"
+        FormatVersion  = 1,
+        RingSize       = 256,        // Must be a power of two.
+        // Reads give up after this many torn copies, which only keep happening if
+        // the broker died while writing.
+        MaxReadRetries = 64
+    };
+
+    struct Slot
+    {
+        volatile UInt32     Seq;
+        UInt32              Pad;
+        SensorBrokerFrame   Frame;
+    };
+
+    volatile UInt32 Magic;
+    UInt32          Version;
+    UInt32          SlotCount;
+    UInt32          FrameSize;
+    volatile UInt32 LatestIndex;
+
+    // Fusion configuration, guarded by ConfigSeq which is odd while it is updated.
+    volatile UInt32 ConfigSeq;
+    volatile float  AccelGain;
+    volatile float  YawMultiplier;
+    volatile float  PredictionDelta;
+    volatile UInt32 GravityEnabled;
+
+    Slot            Slots[RingSize];
+};
+
+// Frames are copied one 32-bit word at a time through volatile pointers.
+static void CopyFrameWords(volatile UInt32* dest, const volatile UInt32* src)
+{
+    OVR_COMPILER_ASSERT((sizeof(SensorBrokerFrame) % sizeof(UInt32)) == 0);
+    for (UPInt i = 0; i < sizeof(SensorBrokerFrame) / sizeof(UInt32); i++)
+        dest[i] = src[i];
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorBrokerMapping
+
+// Named shared memory mapping; POSIX shm_open on Unix systems, a named file
+// mapping backed by the page file on Windows.
+class SensorBrokerMapping : public NewOverrideBase
+{
+public:
+    SensorBrokerMapping() : pData(0), Size(0), Owner(false), Existing(false)
+#if defined(OVR_OS_WIN32)
+        , hMapping(0)
+#endif
+    { }
+    ~SensorBrokerMapping() { Close(); }
+
+    // Creates the segment, mapped read-write. On Unix systems a leftover segment of
+    // the same name is unlinked first; on Windows, where a mapping lives as long as
+    // any process holds it, an existing one is attached to and IsExisting is set.
+    bool    Create(const char* name, UPInt size);
+    // Maps an existing segment read-only.
+    bool    OpenReadOnly(const char* name, UPInt size);
+    void    Close();
+
+    void*   GetData() const     { return pData; }
+    bool    IsExisting() const  { return Existing; }
+
+private:
+    void*   pData;
+    UPInt   Size;
+    bool    Owner;
+    bool    Existing;
+    String  Name;
+#if defined(OVR_OS_WIN32)
+    HANDLE  hMapping;
+#endif
+};
+
+#if defined(OVR_OS_WIN32)
+
+bool SensorBrokerMapping::Create(const char* name, UPInt size)
+{
+    hMapping = ::CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                    0, (DWORD)size, name);
+    if (!hMapping)
+        return false;
+    Existing = (::GetLastError() == ERROR_ALREADY_EXISTS);
+    pData = ::MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!pData)
+    {
+        Close();
+        return false;
+    }
+    Size  = size;
+    Owner = true;
+    Name  = name;
+    return true;
+}
+
+bool SensorBrokerMapping::OpenReadOnly(const char* name, UPInt size)
+{
+    hMapping = ::OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+    if (!hMapping)
+        return false;
+    pData = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, size);
+    if (!pData)
+    {
+        Close();
+        return false;
+    }
+    Size = size;
+    Name = name;
+    return true;
+}
+
+void SensorBrokerMapping::Close()
+{
+    // The mapping object is destroyed by the system once its last handle is closed.
+    if (pData)
+        ::UnmapViewOfFile(pData);
+    if (hMapping)
+        ::CloseHandle(hMapping);
+    pData    = 0;
+    hMapping = 0;
+    Owner    = false;
+    Existing = false;
+}
+
+#else
+
+// POSIX shared memory object names must start with a single slash.
+static String GetShmName(const char* name)
+{
+    String shmName(name);
+    if (shmName.IsEmpty() || shmName[0] != '/')
+        shmName = String("/") + shmName;
+    return shmName;
+}
+
+bool SensorBrokerMapping::Create(const char* name, UPInt size)
+{
+    Name = GetShmName(name);
+
+    // O_EXCL keeps us from attaching to a segment left by a broker that died, or
+    // one of another size or format; such a segment is unlinked and replaced.
+    // Readers still mapping it see no new frames and have to open again.
+    int fd = shm_open(Name.ToCStr(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if ((fd < 0) && (errno == EEXIST))
+    {
+        shm_unlink(Name.ToCStr());
+        fd = shm_open(Name.ToCStr(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        shm_unlink(Name.ToCStr());
+        return false;
+    }
+    pData    = data;
+    Size     = size;
+    Owner    = true;
+    Existing = false;
+    return true;
+}
+
+bool SensorBrokerMapping::OpenReadOnly(const char* name, UPInt size)
+{
+    Name = GetShmName(name);
+
+    int fd = shm_open(Name.ToCStr(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    // A segment smaller than the layout would fault on access instead of failing here.
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || ((UPInt)st.st_size < size))
+    {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+    pData = data;
+    Size  = size;
+    return true;
+}
+
+void SensorBrokerMapping::Close()
+{
+    if (pData)
+        munmap(pData, Size);
+    if (Owner)
+        shm_unlink(Name.ToCStr());
+    pData    = 0;
+    Owner    = false;
+    Existing = false;
+}
+
+#endif
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorBroker
+
+SensorBroker::SensorBroker()
+    : pFusion(0), pChainedDelegate(0), pLayout(0), pMapping(0), LastIndex(0)
+{
+}
+
+SensorBroker::~SensorBroker()
+{
+    Close();
+}
+
+bool SensorBroker::Open(SensorFusion* fusion, const char* name)
+{
+    OVR_ASSERT(fusion);
+    Close();
+
+    pMapping = new SensorBrokerMapping;
+    if (!pMapping->Create(name, sizeof(SensorBrokerLayout)))
+    {
+        LogError("OVR::SensorBroker - Failed to create shared memory '%s'\n", name);
+        delete pMapping;
+        pMapping = 0;
+        return false;
+    }
+    pLayout = (SensorBrokerLayout*)pMapping->GetData();
+
+    // A Windows mapping still held by readers of a broker that exited is reused if
+    // its layout matches, and frame indices continue from it so that those readers
+    // don't see them go back. One of another format may belong to someone else.
+    if (pMapping->IsExisting())
+    {
+        if ((pLayout->Magic     != SensorBrokerLayout::MagicValue) ||
+            (pLayout->Version   != SensorBrokerLayout::FormatVersion) ||
+            (pLayout->SlotCount != SensorBrokerLayout::RingSize) ||
+            (pLayout->FrameSize != sizeof(SensorBrokerFrame)))
+        {
+            LogError("OVR::SensorBroker - Shared memory '%s' exists with an unknown format\n", name);
+            delete pMapping;
+            pMapping = 0;
+            pLayout  = 0;
+            return false;
+        }
+        LastIndex = pLayout->LatestIndex;
+    }
+    else
+    {
+        SeqOps::Store_Release(&pLayout->Magic, 0);
+        memset((void*)pLayout, 0, sizeof(SensorBrokerLayout));
+        pLayout->Version   = SensorBrokerLayout::FormatVersion;
+        pLayout->SlotCount = SensorBrokerLayout::RingSize;
+        pLayout->FrameSize = sizeof(SensorBrokerFrame);
+        SeqOps::Store_Release(&pLayout->Magic, SensorBrokerLayout::MagicValue);
+        LastIndex = 0;
+    }
+
+    pFusion          = fusion;
+    pChainedDelegate = fusion->GetDelegateMessageHandler();
+    publishConfig();
+    pFusion->SetDelegateMessageHandler(this);
+    return true;
+}
+
+void SensorBroker::Close()
+{
+    if (pFusion)
+    {
+        pFusion->SetDelegateMessageHandler(pChainedDelegate);
+        pFusion          = 0;
+        pChainedDelegate = 0;
+    }
+    if (pMapping)
+    {
+        delete pMapping;
+        pMapping = 0;
+    }
+    pLayout   = 0;
+    LastIndex = 0;
+}
+
+void SensorBroker::OnMessage(const Message& msg)
+{
+    if ((msg.Type == Message_BodyFrame) && pLayout)
+        publish(static_cast<const MessageBodyFrame&>(msg));
+
+    if (pChainedDelegate)
+        pChainedDelegate->OnMessage(msg);
+}
+
+bool SensorBroker::SupportsMessageType(MessageType type) const
+{
+    return (type == Message_BodyFrame) ||
+           (pChainedDelegate && pChainedDelegate->SupportsMessageType(type));
+}
+
+void SensorBroker::publish(const MessageBodyFrame& msg)
+{
+    // Called on the device thread after the fusion processed 'msg'; the fusion getters
+    // take the handler lock that is already held here, which is fine as it's recursive.
+    SensorBrokerFrame frame;
+    frame.Index                = (LastIndex + 1) ? (LastIndex + 1) : 1;
+    frame.Reserved             = 0;
+    frame.TimestampTicks       = Timer::GetTicks();
+    frame.Orientation          = pFusion->GetOrientation();
+    frame.PredictedOrientation = pFusion->GetPredictedOrientation();
+    frame.Acceleration         = pFusion->GetAcceleration();
+    frame.AngularVelocity      = pFusion->GetAngularVelocity();
+    frame.RawAcceleration      = msg.Acceleration;
+    frame.RawRotationRate      = msg.RotationRate;
+    frame.RawMagneticField     = msg.MagneticField;
+    frame.Temperature          = msg.Temperature;
+    frame.TimeDelta            = msg.TimeDelta;
+
+    publishConfig();
+
+    // Invalidate the slot before touching the frame, so that a reader copying the
+    // previous frame in it notices the overwrite when it re-checks Seq.
+    SensorBrokerLayout::Slot& slot =
+        pLayout->Slots[frame.Index & (SensorBrokerLayout::RingSize - 1)];
+    SeqOps::Exchange_Sync(&slot.Seq, 0);
+    CopyFrameWords((volatile UInt32*)&slot.Frame, (const UInt32*)&frame);
+    SeqOps::Store_Release(&slot.Seq, frame.Index);
+
+    SeqOps::Store_Release(&pLayout->LatestIndex, frame.Index);
+    LastIndex = frame.Index;
+}
+
+void SensorBroker::publishConfig()
+{
+    // Configuration rarely changes, so only take the config seqlock when it does.
+    float  gain    = pFusion->GetAccelGain();
+    float  yaw     = pFusion->GetYawMultiplier();
+    float  dt      = pFusion->GetPredictionDelta();
+    UInt32 gravity = pFusion->IsGravityEnabled() ? 1 : 0;
+    if ((pLayout->AccelGain == gain) && (pLayout->YawMultiplier == yaw) &&
+        (pLayout->PredictionDelta == dt) && (pLayout->GravityEnabled == gravity))
+        return;
+
+    UInt32 seq = pLayout->ConfigSeq;
+    SeqOps::Exchange_Sync(&pLayout->ConfigSeq, seq + 1);
+    pLayout->AccelGain       = gain;
+    pLayout->YawMultiplier   = yaw;
+    pLayout->PredictionDelta = dt;
+    pLayout->GravityEnabled  = gravity;
+    SeqOps::Store_Release(&pLayout->ConfigSeq, seq + 2);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** RemoteSensorFusion
+
+RemoteSensorFusion::RemoteSensorFusion()
+    : pLayout(0), pMapping(0)
+{
+}
+
+RemoteSensorFusion::~RemoteSensorFusion()
+{
+    Close();
+}
+
+bool RemoteSensorFusion::Open(const char* name)
+{
+    Close();
+
+    pMapping = new SensorBrokerMapping;
+    if (pMapping->OpenReadOnly(name, sizeof(SensorBrokerLayout)))
+    {
+        const SensorBrokerLayout* layout = (const SensorBrokerLayout*)pMapping->GetData();
+
+        if ((SeqOps::Load_Acquire(&layout->Magic) == SensorBrokerLayout::MagicValue) &&
+            (layout->Version   == SensorBrokerLayout::FormatVersion) &&
+            (layout->SlotCount == SensorBrokerLayout::RingSize) &&
+            (layout->FrameSize == sizeof(SensorBrokerFrame)))
+        {
+            pLayout = layout;
+            return true;
+        }
+        LogError("OVR::RemoteSensorFusion - Shared memory '%s' has an unknown format\n", name);
+    }
+
+    delete pMapping;
+    pMapping = 0;
+    return false;
+}
+
+void RemoteSensorFusion::Close()
+{
+    if (pMapping)
+    {
+        delete pMapping;
+        pMapping = 0;
+    }
+    pLayout = 0;
+}
+
+bool RemoteSensorFusion::readFrame(UInt32 index, SensorBrokerFrame* frame) const
+{
+    const SensorBrokerLayout::Slot& slot =
+        pLayout->Slots[index & (SensorBrokerLayout::RingSize - 1)];
+
+    if (SeqOps::Load_Acquire(&slot.Seq) != index)
+        return false;
+    CopyFrameWords((volatile UInt32*)frame, (const volatile UInt32*)&slot.Frame);
+
+    // Order the copy before re-reading Seq; a changed value means a torn frame.
+    {
+        AtomicOpsRawBase::FullSync sync;
+        OVR_UNUSED(sync);
+    }
+    return SeqOps::Load_Acquire(&slot.Seq) == index;
+}
+
+bool RemoteSensorFusion::GetLatestFrame(SensorBrokerFrame* frame) const
+{
+    if (!pLayout)
+        return false;
+
+    // A retry happens only if the writer published a whole ring of frames while we
+    // were copying one; LatestIndex is re-read so that we move to the newest frame.
+    for (int retry = 0; retry < SensorBrokerLayout::MaxReadRetries; retry++)
+    {
+        UInt32 index = SeqOps::Load_Acquire(&pLayout->LatestIndex);
+        if (index == 0)
+            return false;
+        if (readFrame(index, frame))
+            return true;
+    }
+    return false;
+}
+
+UInt32 RemoteSensorFusion::GetLatestIndex() const
+{
+    return pLayout ? SeqOps::Load_Acquire(&pLayout->LatestIndex) : 0;
+}
+
+UInt32 RemoteSensorFusion::ReadFrames(UInt32 firstIndex, SensorBrokerFrame* frames,
+                                      UInt32 maxCount) const
+{
+    UInt32 latest = GetLatestIndex();
+    if (latest == 0)
+        return 0;
+
+    // Frames more than a ring behind are gone; half a ring of margin leaves time to
+    // copy them before the writer catches up. Differences are unsigned to handle wrap.
+    UInt32 behind = latest - firstIndex;
+    if ((SInt32)behind < 0)
+        return 0;
+    if (behind >= SensorBrokerLayout::RingSize / 2)
+        firstIndex = latest - (SensorBrokerLayout::RingSize / 2 - 1);
+
+    UInt32 count = 0;
+    for (UInt32 index = firstIndex; count < maxCount; index++)
+    {
+        if (index == 0)
+            continue;
+        if (!readFrame(index, &frames[count]))
+            break;
+        count++;
+        if (index == latest)
+            break;
+    }
+    return count;
+}
+
+Quatf RemoteSensorFusion::GetOrientation() const
+{
+    SensorBrokerFrame frame;
+    return GetLatestFrame(&frame) ? frame.Orientation : Quatf();
+}
+
+Quatf RemoteSensorFusion::GetPredictedOrientation() const
+{
+    SensorBrokerFrame frame;
+    return GetLatestFrame(&frame) ? frame.PredictedOrientation : Quatf();
+}
+
+Vector3f RemoteSensorFusion::GetAcceleration() const
+{
+    SensorBrokerFrame frame;
+    return GetLatestFrame(&frame) ? frame.Acceleration : Vector3f();
+}
+
+Vector3f RemoteSensorFusion::GetAngularVelocity() const
+{
+    SensorBrokerFrame frame;
+    return GetLatestFrame(&frame) ? frame.AngularVelocity : Vector3f();
+}
+
+// Configuration values are read under ConfigSeq; a retry happens only if the broker
+// changed its settings in the middle of the read. If it stays odd, the broker died
+// while writing it, and the default is returned.
+#define OVR_REMOTEFUSION_READ_CONFIG(type, field, defaultValue)             \
+    if (!pLayout)                                                           \
+        return defaultValue;                                                \
+    for (int retry = 0; retry < SensorBrokerLayout::MaxReadRetries; retry++) \
+    {                                                                       \
+        UInt32 seq = SeqOps::Load_Acquire(&pLayout->ConfigSeq);             \
+        if (seq & 1)                                                        \
+            continue;                                                       \
+        type value = (type)pLayout->field;                                  \
+        /* Order the read before re-reading ConfigSeq, as in readFrame. */  \
+        {                                                                   \
+            AtomicOpsRawBase::FullSync sync;                                \
+            OVR_UNUSED(sync);                                               \
+        }                                                                   \
+        if (SeqOps::Load_Acquire(&pLayout->ConfigSeq) == seq)               \
+            return value;                                                   \
+    }                                                                       \
+    return defaultValue;
+
+bool RemoteSensorFusion::IsGravityEnabled() const
+{
+    OVR_REMOTEFUSION_READ_CONFIG(bool, GravityEnabled, true);
+}
+
+float RemoteSensorFusion::GetAccelGain() const
+{
+    OVR_REMOTEFUSION_READ_CONFIG(float, AccelGain, 0.05f);
+}
+
+float RemoteSensorFusion::GetYawMultiplier() const
+{
+    OVR_REMOTEFUSION_READ_CONFIG(float, YawMultiplier, 1.0f);
+}
+
+float RemoteSensorFusion::GetPredictionDelta() const
+{
+    OVR_REMOTEFUSION_READ_CONFIG(float, PredictionDelta, 0.0f);
+}
+
+#undef OVR_REMOTEFUSION_READ_CONFIG
+
+
+} // namespace OVR
@@ -0,0 +1,155 @@
+/************************************************************************************
+
+Filename    :   OVR_SensorBroker.h
+Content     :   Shared-memory publishing of SensorFusion state to other processes
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_SensorBroker_h
+#define OVR_SensorBroker_h
+
+#include "OVR_SensorFusion.h"
+
+namespace OVR {
+
+struct SensorBrokerLayout;
+class  SensorBrokerMapping;
+
+// Name of the shared memory segment used when none is specified.
+#define OVR_SENSORBROKER_DEFAULT_NAME "OVR_SensorBroker"
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorBrokerFrame
+
+// SensorBrokerFrame is one published sensor update: the fused state right after the
+// sample was applied, followed by the raw sample values from MessageBodyFrame.
+struct SensorBrokerFrame
+{
+    // Sequential frame number assigned by the broker; starts at 1, never 0.
+    UInt32      Index;
+    UInt32      Reserved;
+    // Timer::GetTicks() value at the time the frame was published.
+    UInt64      TimestampTicks;
+
+    Quatf       Orientation;
+    Quatf       PredictedOrientation;
+    Vector3f    Acceleration;
+    Vector3f    AngularVelocity;
+
+    Vector3f    RawAcceleration;
+    Vector3f    RawRotationRate;
+    Vector3f    RawMagneticField;
+    float       Temperature;
+    float       TimeDelta;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorBroker
+
+// SensorBroker lets the one process that owns the tracker share its head pose with
+// others. It installs itself as the delegate message handler of a SensorFusion and,
+// for every BodyFrame the fusion consumes, publishes a SensorBrokerFrame into a ring
+// of frames in a named shared memory segment. Readers use RemoteSensorFusion.
+//
+// Each ring slot is guarded by its own sequence number, so the writer never waits
+// for readers and readers never block the writer.
+
+class SensorBroker : public MessageHandler
+{
+public:
+    SensorBroker();
+    ~SensorBroker();
+
+    // Creates the shared memory segment and starts publishing updates of 'fusion'.
+    // A delegate handler already installed on the fusion keeps receiving messages.
+    bool        Open(SensorFusion* fusion, const char* name = OVR_SENSORBROKER_DEFAULT_NAME);
+    // Stops publishing and removes the segment; attached readers see no new frames.
+    void        Close();
+
+    bool        IsOpen() const { return pLayout != 0; }
+
+    // Index of the most recently published frame, or 0 if none was published.
+    UInt32      GetLatestIndex() const { return LastIndex; }
+
+    virtual void OnMessage(const Message& msg);
+    virtual bool SupportsMessageType(MessageType type) const;
+
+private:
+    void        publish(const MessageBodyFrame& msg);
+    void        publishConfig();
+
+    SensorFusion*        pFusion;
+    MessageHandler*      pChainedDelegate;
+    SensorBrokerLayout*  pLayout;
+    SensorBrokerMapping* pMapping;
+    UInt32               LastIndex;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** RemoteSensorFusion
+
+// RemoteSensorFusion reads the state published by a SensorBroker in another process,
+// exposing the same getters as SensorFusion. Reads copy from the mapped segment and
+// never lock or enter the kernel; a read retries only if the writer overwrote the
+// slot being copied, which requires it to lap the whole ring first.
+//
+// Getters return default values until the segment is open and a frame was published.
+
+class RemoteSensorFusion : public NewOverrideBase
+{
+public:
+    RemoteSensorFusion();
+    ~RemoteSensorFusion();
+
+    // Maps the segment created by SensorBroker::Open with the same name. Fails if no
+    // broker is running.
+    bool        Open(const char* name = OVR_SENSORBROKER_DEFAULT_NAME);
+    void        Close();
+
+    bool        IsOpen() const { return pLayout != 0; }
+
+    Quatf       GetOrientation() const;
+    Quatf       GetPredictedOrientation() const;
+    Vector3f    GetAcceleration() const;
+    Vector3f    GetAngularVelocity() const;
+
+    bool        IsGravityEnabled() const;
+    float       GetAccelGain() const;
+    float       GetYawMultiplier() const;
+    float       GetPredictionDelta() const;
+
+    // Copies the most recent frame; returns false if nothing was published yet, or
+    // if the broker stopped in the middle of writing it.
+    bool        GetLatestFrame(SensorBrokerFrame* frame) const;
+
+    // Returns the Index of the most recent frame, or 0 if nothing was published.
+    UInt32      GetLatestIndex() const;
+
+    // Copies consecutive frames starting at 'firstIndex' and returns how many were
+    // read. Frames already overwritten in the ring are skipped, so consumers such as
+    // recorders should compare the Index of the first frame returned with the one
+    // they asked for to detect gaps.
+    UInt32      ReadFrames(UInt32 firstIndex, SensorBrokerFrame* frames, UInt32 maxCount) const;
+
+private:
+    bool        readFrame(UInt32 index, SensorBrokerFrame* frame) const;
+
+    const SensorBrokerLayout* pLayout;
+    SensorBrokerMapping*      pMapping;
+};
+
+
+} // namespace OVR
+
+#endif // OVR_SensorBroker_h
@@ -14,8 +14,11 @@ otherwise accompanies this software in either electronic or hard copy form.
 *************************************************************************************/
 
 #include "OVR_SensorFusion.h"
+#include "Kernel/OVR_Alg.h"
 #include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Profiler.h"
 #include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Timer.h"
 
 namespace OVR {
 
@@ -63,10 +66,15 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
     if (msg.Type != Message_BodyFrame)
         return;
 
+    OVR_PROFILE_SCOPE("SensorFusion");
+
     AngV = msg.RotationRate;
     AngV.y *= YawMult;
     A = msg.Acceleration * msg.TimeDelta;
 
+    GetAngVFilterVal(AngV, AngVF);
+    SampleTicks = Timer::GetTicks();
+
     /*
     // Mike's original integration approach. Subdivision to reduce error.
     Quatf q = AngVToYawPitchRollQuatf(msg.AngV * msg.TimeDelta * (1.0f / 16.0f));
@@ -91,8 +99,6 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
 
         if (EnablePrediction)
         {
-			Vector3f AngVF;
-			GetAngVFilterVal(AngV, AngVF);
             float angSpeed = AngVF.Length();
             if (angSpeed > 0.001f)
             {
@@ -173,6 +179,27 @@ bool SensorFusion::BodyFrameHandler::SupportsMessageType(MessageType type) const
     return (type == Message_BodyFrame);
 }
 
+Quatf SensorFusion::GetPredictedOrientationAt(UInt64 ticks) const
+{
+    // Extrapolating further than this amplifies gyro noise more than it helps.
+    const float maxPredictionDT = 0.1f;
+
+    Lock::Locker lockScope(Handler.GetHandlerLock());
+
+    if ((SampleTicks == 0) || (ticks <= SampleTicks))
+        return Q;
+
+    float dt       = Alg::Min(float(Timer::TicksToSeconds(ticks - SampleTicks)), maxPredictionDT);
+    float angSpeed = AngVF.Length();
+    if (angSpeed <= 0.001f)
+        return Q;
+
+    Vector3f axis  = AngVF / angSpeed;
+    float    halfa = angSpeed * dt * 0.5f;
+    float    sina  = sin(halfa);
+    return Q * Quatf(axis.x*sina, axis.y*sina, axis.z*sina, cos(halfa));
+}
+
 void SensorFusion::ResetAngVFilter()
 {
 	for (int i = 0; i < 8; i++)
@@ -41,7 +41,8 @@ public:
     SensorFusion(SensorDevice* sensor = 0)
         : Handler(getThis()), pDelegate(0),
           Gain(0.05f), YawMult(1), EnableGravity(true), 
-		  EnablePrediction(false), FilterPrediction(false), PredictionDT(0)
+		  EnablePrediction(false), FilterPrediction(false), PredictionDT(0),
+          SampleTicks(0)
     {
         if (sensor)
             AttachToSensor(sensor);
@@ -86,6 +87,12 @@ public:
         Lock::Locker lockScope(Handler.GetHandlerLock());
         return QP;
     }    
+    // Obtain the orientation extrapolated to 'ticks', a Timer::GetTicks() value, from the
+    // latest sensor sample and its filtered angular velocity. Unlike GetPredictedOrientation,
+    // this doesn't depend on the prediction settings, so it can be used to predict the
+    // orientation for a particular display time.
+    Quatf       GetPredictedOrientationAt(UInt64 ticks) const;
+
     // Obtain the last absolute acceleration reading, in m/s^2.
     Vector3f    GetAcceleration() const
     {
@@ -110,6 +117,8 @@ public:
         Q = Quatf();
         QP = Quatf();
         A = Vector3f();
+        AngVF = Vector3f();
+        SampleTicks = 0;
 
 		ResetAngVFilter();
     }
@@ -128,6 +137,8 @@ public:
 
     void        SetDelegateMessageHandler(MessageHandler* handler)
     { pDelegate = handler; }
+    MessageHandler* GetDelegateMessageHandler() const
+    { return pDelegate; }
 
 	// Prediction functions.
     // Prediction delta specifes how much prediction should be applied in seconds; it should in
@@ -168,6 +179,10 @@ private:
     float             PredictionDT;
     Quatf             QP;
 
+    // Filtered angular velocity and the time of the sample it was computed for.
+    Vector3f          AngVF;
+    UInt64            SampleTicks;
+
 	// Testing AngV filtering suggested by Steve
 	Vector3f		  AngVFilterHistory[8];
 	void			  ResetAngVFilter();
@@ -14,6 +14,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 ************************************************************************************/
 
 #include "OVR_ThreadCommandQueue.h"
+#include "Kernel/OVR_Profiler.h"
 
 namespace OVR {
 
@@ -151,6 +152,8 @@ void ThreadCommand::PopBuffer::InitFromBuffer(void* data)
 
 void ThreadCommand::PopBuffer::Execute()
 {
+    OVR_PROFILE_SCOPE("ThreadCommand");
+
     ThreadCommand* command = toCommand();
     OVR_ASSERT(command);
     command->Execute();
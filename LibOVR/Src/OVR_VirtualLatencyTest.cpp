@@ -0,0 +1,234 @@
+/************************************************************************************
+
+Filename    :   OVR_VirtualLatencyTest.cpp
+Content     :   Software stand-in for the Latency Tester, fed by the render loop.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "OVR_VirtualLatencyTest.h"
+
+#include "Kernel/OVR_Timer.h"
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// ***** VirtualLatencyTestDeviceFactory
+
+VirtualLatencyTestDeviceFactory VirtualLatencyTestDeviceFactory::Instance;
+
+void VirtualLatencyTestDeviceFactory::EnumerateDevices(EnumerateVisitor& visitor)
+{
+    if (Enabled)
+    {
+        VirtualLatencyTestDeviceCreateDesc createDesc(this);
+        visitor.Visit(createDesc);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** VirtualLatencyTestDeviceCreateDesc
+
+DeviceBase* VirtualLatencyTestDeviceCreateDesc::NewDeviceInstance()
+{
+    return new VirtualLatencyTestDevice(this);
+}
+
+bool VirtualLatencyTestDeviceCreateDesc::GetDeviceInfo(DeviceInfo* info) const
+{
+    if ((info->InfoClassType != Device_LatencyTester) &&
+        (info->InfoClassType != Device_None))
+        return false;
+
+    OVR_strcpy(info->ProductName,  DeviceInfo::MaxNameLength, "Virtual Latency Tester");
+    OVR_strcpy(info->Manufacturer, DeviceInfo::MaxNameLength, "Oculus VR, Inc.");
+    info->Type    = Device_LatencyTester;
+    info->Version = 0;
+
+    if (info->InfoClassType == Device_LatencyTester)
+    {
+        SensorInfo* sinfo = (SensorInfo*)info;
+        sinfo->VendorId  = 0;
+        sinfo->ProductId = 0;
+        OVR_strcpy(sinfo->SerialNumber, sizeof(sinfo->SerialNumber), "VIRTUAL");
+    }
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** VirtualLatencyTestDevice
+
+VirtualLatencyTestDevice::VirtualLatencyTestDevice(VirtualLatencyTestDeviceCreateDesc* createDesc)
+    : OVR::DeviceImpl<OVR::LatencyTestDevice>(createDesc, 0),
+      Configuration(Color(128, 128, 128)),
+      TestActive(false), StartTestTicksMicroS(0)
+{
+}
+
+VirtualLatencyTestDevice::~VirtualLatencyTestDevice()
+{
+    // Check that Shutdown() was called.
+    OVR_ASSERT(!pCreateDesc->pDevice);
+}
+
+bool VirtualLatencyTestDevice::Initialize(DeviceBase* parent)
+{
+    LogText("OVR::VirtualLatencyTestDevice - Opened\n");
+
+    // AddRef() to parent, forcing chain to stay alive.
+    pParent = parent;
+    return true;
+}
+
+void VirtualLatencyTestDevice::Shutdown()
+{
+    // Remove the handler, if any.
+    HandlerRef.SetHandler(0);
+    LogText("OVR::VirtualLatencyTestDevice - Closed\n");
+
+    pParent.Clear();
+}
+
+bool VirtualLatencyTestDevice::SetConfiguration(const OVR::LatencyTestConfiguration& configuration, bool waitFlag)
+{
+    bool                 result = 0;
+    ThreadCommandQueue * threadQueue = GetManagerImpl()->GetThreadQueue();
+
+    if (!waitFlag)
+        return threadQueue->PushCall(this, &VirtualLatencyTestDevice::setConfiguration, configuration);
+
+    if (!threadQueue->PushCallAndWaitResult(this, &VirtualLatencyTestDevice::setConfiguration,
+        &result, configuration))
+        return false;
+
+    return result;
+}
+
+bool VirtualLatencyTestDevice::setConfiguration(const OVR::LatencyTestConfiguration& configuration)
+{
+    Configuration = configuration;
+    return true;
+}
+
+bool VirtualLatencyTestDevice::SetCalibrate(const OVR::LatencyTestCalibrate& calibrate, bool waitFlag)
+{
+    bool                 result = 0;
+    ThreadCommandQueue * threadQueue = GetManagerImpl()->GetThreadQueue();
+
+    if (!waitFlag)
+        return threadQueue->PushCall(this, &VirtualLatencyTestDevice::setCalibrate, calibrate);
+
+    if (!threadQueue->PushCallAndWaitResult(this, &VirtualLatencyTestDevice::setCalibrate,
+        &result, calibrate))
+        return false;
+
+    return result;
+}
+
+bool VirtualLatencyTestDevice::setCalibrate(const OVR::LatencyTestCalibrate& calibrate)
+{
+    // Read-back colors are exact, so there is nothing to calibrate.
+    OVR_UNUSED(calibrate);
+    return true;
+}
+
+bool VirtualLatencyTestDevice::SetStartTest(const OVR::LatencyTestStartTest& start, bool waitFlag)
+{
+    bool                 result = 0;
+    ThreadCommandQueue * threadQueue = GetManagerImpl()->GetThreadQueue();
+
+    if (!waitFlag)
+        return threadQueue->PushCall(this, &VirtualLatencyTestDevice::setStartTest, start);
+
+    if (!threadQueue->PushCallAndWaitResult(this, &VirtualLatencyTestDevice::setStartTest,
+        &result, start))
+        return false;
+
+    return result;
+}
+
+bool VirtualLatencyTestDevice::setStartTest(const OVR::LatencyTestStartTest& start)
+{
+    TestActive           = true;
+    TargetColor          = start.TargetValue;
+    StartTestTicksMicroS = Timer::GetTicks();
+
+    MessageLatencyTestStarted startedMessage(this);
+    startedMessage.TargetValue = start.TargetValue;
+    HandlerRef.Call(startedMessage);
+    return true;
+}
+
+bool VirtualLatencyTestDevice::SetDisplay(const OVR::LatencyTestDisplay& display, bool waitFlag)
+{
+    // There is no LED display to drive.
+    OVR_UNUSED2(display, waitFlag);
+    return true;
+}
+
+bool VirtualLatencyTestDevice::ReportScanoutColor(const Color& color, UInt64 scanoutTicksMicroS)
+{
+    if (scanoutTicksMicroS == 0)
+        scanoutTicksMicroS = Timer::GetTicks();
+
+    return GetManagerImpl()->GetThreadQueue()->PushCall(this, &VirtualLatencyTestDevice::reportScanoutColor,
+                                                        color, scanoutTicksMicroS);
+}
+
+bool VirtualLatencyTestDevice::reportScanoutColor(const Color& color, UInt64 scanoutTicksMicroS)
+{
+    if (Configuration.SendSamples)
+    {
+        MessageLatencyTestSamples samplesMessage(this);
+        samplesMessage.Samples.PushBack(color);
+        HandlerRef.Call(samplesMessage);
+    }
+
+    // Frames that were scanned out before the test started can't show its color.
+    if (!TestActive || (scanoutTicksMicroS < StartTestTicksMicroS) ||
+        !isColorDetected(color, TargetColor))
+        return true;
+
+    TestActive = false;
+
+    UInt64 elapsedMilliS = (scanoutTicksMicroS - StartTestTicksMicroS + 500) / 1000;
+
+    MessageLatencyTestColorDetected detectedMessage(this);
+    detectedMessage.Elapsed       = (UInt16)Alg::Min(elapsedMilliS, (UInt64)0xFFFF);
+    detectedMessage.DetectedValue = color;
+    detectedMessage.TargetValue   = TargetColor;
+    HandlerRef.Call(detectedMessage);
+    return true;
+}
+
+bool VirtualLatencyTestDevice::isColorDetected(const Color& color, const Color& target) const
+{
+    // Like the hardware, compare each channel against the configured threshold; a
+    // threshold of 255 can never be crossed, so such channels are ignored.
+    const UByte threshold[3] = { Configuration.Threshold.R, Configuration.Threshold.G, Configuration.Threshold.B };
+    const UByte value[3]     = { color.R, color.G, color.B };
+    const UByte goal[3]      = { target.R, target.G, target.B };
+    bool        anyChannel   = false;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (threshold[i] == 255)
+            continue;
+        anyChannel = true;
+        if ((value[i] >= threshold[i]) != (goal[i] >= threshold[i]))
+            return false;
+    }
+
+    return anyChannel || (color == target);
+}
+
+} // namespace OVR
@@ -0,0 +1,118 @@
+/************************************************************************************
+
+Filename    :   OVR_VirtualLatencyTest.h
+Content     :   Software stand-in for the Latency Tester, fed by the render loop.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_VirtualLatencyTest_h
+#define OVR_VirtualLatencyTest_h
+
+#include "OVR_DeviceImpl.h"
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// VirtualLatencyTestDeviceFactory reports a single virtual Latency Tester while
+// enabled through DeviceManager::SetVirtualLatencyTesterEnabled.
+class VirtualLatencyTestDeviceFactory : public DeviceFactory
+{
+public:
+    static VirtualLatencyTestDeviceFactory Instance;
+
+    VirtualLatencyTestDeviceFactory() : Enabled(false) { }
+
+    virtual void RemovedFromManager()
+    {
+        Enabled = false;
+        DeviceFactory::RemovedFromManager();
+    }
+
+    // Enumerates devices, creating and destroying relevant objects in manager.
+    virtual void EnumerateDevices(EnumerateVisitor& visitor);
+
+    // Modified under the manager lock.
+    bool Enabled;
+};
+
+
+// Describes the virtual Latency Tester and supports creating its instance.
+class VirtualLatencyTestDeviceCreateDesc : public DeviceCreateDesc
+{
+public:
+    VirtualLatencyTestDeviceCreateDesc(DeviceFactory* factory)
+        : DeviceCreateDesc(factory, Device_LatencyTester) { }
+
+    virtual DeviceCreateDesc* Clone() const
+    {
+        return new VirtualLatencyTestDeviceCreateDesc(pFactory);
+    }
+
+    virtual DeviceBase* NewDeviceInstance();
+
+    virtual MatchResult MatchDevice(const DeviceCreateDesc& other,
+                                    DeviceCreateDesc**) const
+    {
+        if ((other.Type == Device_LatencyTester) && (pFactory == other.pFactory))
+            return Match_Found;
+        return Match_None;
+    }
+
+    virtual bool        GetDeviceInfo(DeviceInfo* info) const;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** OVR::VirtualLatencyTestDevice
+
+// VirtualLatencyTestDevice emulates the Latency Tester protocol on the device manager
+// thread. StartTest is acknowledged with a 'TestStarted' message right away; frames
+// reported through ReportScanoutColor then play the role of the light sensor. The
+// first frame scanned out after the test started whose color crosses the configured
+// threshold towards the target color produces 'ColorDetected', with the time from
+// test start to that frame's scanout as Elapsed.
+
+class VirtualLatencyTestDevice : public DeviceImpl<OVR::LatencyTestDevice>
+{
+public:
+     VirtualLatencyTestDevice(VirtualLatencyTestDeviceCreateDesc* createDesc);
+    ~VirtualLatencyTestDevice();
+
+    // DeviceCommon interface
+    virtual bool Initialize(DeviceBase* parent);
+    virtual void Shutdown();
+
+    // LatencyTesterDevice interface
+    virtual bool SetConfiguration(const OVR::LatencyTestConfiguration& configuration, bool waitFlag);
+    virtual bool SetCalibrate(const OVR::LatencyTestCalibrate& calibrate, bool waitFlag);
+    virtual bool SetStartTest(const OVR::LatencyTestStartTest& start, bool waitFlag);
+    virtual bool SetDisplay(const OVR::LatencyTestDisplay& display, bool waitFlag);
+    virtual bool ReportScanoutColor(const Color& color, UInt64 scanoutTicksMicroS);
+
+protected:
+    bool    setConfiguration(const OVR::LatencyTestConfiguration& configuration);
+    bool    setCalibrate(const OVR::LatencyTestCalibrate& calibrate);
+    bool    setStartTest(const OVR::LatencyTestStartTest& start);
+    bool    reportScanoutColor(const Color& color, UInt64 scanoutTicksMicroS);
+
+    // Returns true if 'color' is on the same side of the threshold as 'target'.
+    bool    isColorDetected(const Color& color, const Color& target) const;
+
+    // State below is only accessed on the device manager thread.
+    OVR::LatencyTestConfiguration Configuration;
+    bool        TestActive;
+    Color       TargetColor;
+    UInt64      StartTestTicksMicroS;
+};
+
+} // namespace OVR
+
+#endif // OVR_VirtualLatencyTest_h
@@ -18,6 +18,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "OVR_Win32_HMDDevice.h"
 
 #include "Kernel/OVR_Timer.h"
+#include "Kernel/OVR_Profiler.h"
 
 
 namespace OVR { namespace Win32 {
@@ -407,6 +408,35 @@ struct SensorDisplayInfo
         DistortionK[5]          = DecodeFloat(Buffer+52);
     }
 
+    // Conversion to/from DeviceInfoCache, used to skip the feature read on startup.
+    void ToCacheRecord(DeviceInfoCache::Record* r) const
+    {
+        r->DistortionType          = DistortionType;
+        r->HResolution             = HResolution;
+        r->VResolution             = VResolution;
+        r->HScreenSize             = HScreenSize;
+        r->VScreenSize             = VScreenSize;
+        r->VCenter                 = VCenter;
+        r->LensSeparation          = LensSeparation;
+        r->EyeToScreenDistance[0]  = EyeToScreenDistance[0];
+        r->EyeToScreenDistance[1]  = EyeToScreenDistance[1];
+        memcpy(r->DistortionK, DistortionK, sizeof(DistortionK));
+        r->Contents               |= DeviceInfoCache::Record::Contents_Display;
+    }
+
+    void FromCacheRecord(const DeviceInfoCache::Record& r)
+    {
+        DistortionType          = r.DistortionType;
+        HResolution             = r.HResolution;
+        VResolution             = r.VResolution;
+        HScreenSize             = r.HScreenSize;
+        VScreenSize             = r.VScreenSize;
+        VCenter                 = r.VCenter;
+        LensSeparation          = r.LensSeparation;
+        EyeToScreenDistance[0]  = r.EyeToScreenDistance[0];
+        EyeToScreenDistance[1]  = r.EyeToScreenDistance[1];
+        memcpy(DistortionK, r.DistortionK, sizeof(DistortionK));
+    }
 };
 
 
@@ -450,9 +480,22 @@ void SensorDeviceFactory::EnumerateDevices(EnumerateVisitor& visitor)
             DeviceManager* manager = (Win32::DeviceManager*)pFactory->GetManagerImpl();
             Win32HIDInterface& hid = manager->HIDInterface;
             
-            SensorDisplayInfo displayInfo;
-            if (hid.HidD_GetFeature(hidDev, displayInfo.Buffer, SensorDisplayInfo::PacketSize))            
+            // DisplayInfo of a previously seen sensor comes from the cache, saving
+            // a feature read; SensorDevice::openDevice validates it later.
+            SensorDisplayInfo       displayInfo;
+            DeviceInfoCache::Record cached(desc.SerialNumber.ToCStr(), desc.VersionNumber);
+
+            if (manager->InfoCache.Find(desc.SerialNumber.ToCStr(), desc.VersionNumber, &cached) &&
+                (cached.Contents & DeviceInfoCache::Record::Contents_Display))
+            {
+                displayInfo.FromCacheRecord(cached);
+            }
+            else if (hid.HidD_GetFeature(hidDev, displayInfo.Buffer, SensorDisplayInfo::PacketSize))
+            {
                 displayInfo.Unpack();
+                displayInfo.ToCacheRecord(&cached);
+                manager->InfoCache.Update(cached);
+            }
 
             /*
             displayInfo.HResolution = 1280;
@@ -627,21 +670,32 @@ bool SensorDevice::openDevice(const char ** errorFormatString)
         return false;
     }
 
-    // Read the currently configured range from sensor.
-    SensorScaleRange ssr(SensorRange(), 0);
-    if (hid.HidD_GetFeature(hDev, ssr.Buffer, SensorScaleRange::PacketSize))
+    DeviceInfoCache::Record cached;
+    if (manager->InfoCache.Find(hidDesc.SerialNumber.ToCStr(), hidDesc.VersionNumber, &cached) &&
+        (cached.Contents == DeviceInfoCache::Record::Contents_All))
     {
-        ssr.Unpack();
-        ssr.GetSensorRange(&CurrentRange);
+        // Use the cached range and DisplayInfo right away, deferring the feature
+        // reads to validateCachedInfo, which runs after this command completes.
+        CurrentRange = cached.Range;
+        Coordinates  = (cached.DistortionType & SensorDisplayInfo::Mask_BaseFmt) ?
+                       Coord_HMD : Coord_Sensor;
+        manager->pThread->PushCall(this, &SensorDevice::validateCachedInfo);
     }
-
-    // If the sensor has "DisplayInfo" data, use HMD coordinate frame by default.
-    SensorDisplayInfo displayInfo;
-    if (hid.HidD_GetFeature(hDev, displayInfo.Buffer, SensorDisplayInfo::PacketSize))
+    else
     {
-        displayInfo.Unpack();
-        Coordinates = (displayInfo.DistortionType & SensorDisplayInfo::Mask_BaseFmt) ?
-                      Coord_HMD : Coord_Sensor;
+        readInfoReports(&cached);
+        manager->InfoCache.Update(cached);
+
+        // Read the currently configured range from sensor.
+        if (cached.Contents & DeviceInfoCache::Record::Contents_Range)
+            CurrentRange = cached.Range;
+
+        // If the sensor has "DisplayInfo" data, use HMD coordinate frame by default.
+        if (cached.Contents & DeviceInfoCache::Record::Contents_Display)
+        {
+            Coordinates = (cached.DistortionType & SensorDisplayInfo::Mask_BaseFmt) ?
+                          Coord_HMD : Coord_Sensor;
+        }
     }
 
     // Read/Apply sensor config.
@@ -662,6 +716,59 @@ bool SensorDevice::openDevice(const char ** errorFormatString)
 }
 
 
+void SensorDevice::readInfoReports(DeviceInfoCache::Record* record)
+{
+    HIDDeviceDesc&     hidDesc = *getHIDDesc();
+    Win32HIDInterface& hid     = getManagerImpl()->HIDInterface;
+
+    *record = DeviceInfoCache::Record(hidDesc.SerialNumber.ToCStr(), hidDesc.VersionNumber);
+
+    SensorScaleRange ssr(SensorRange(), 0);
+    if (hid.HidD_GetFeature(hDev, ssr.Buffer, SensorScaleRange::PacketSize))
+    {
+        ssr.Unpack();
+        ssr.GetSensorRange(&record->Range);
+        record->Contents |= DeviceInfoCache::Record::Contents_Range;
+    }
+
+    SensorDisplayInfo displayInfo;
+    if (hid.HidD_GetFeature(hDev, displayInfo.Buffer, SensorDisplayInfo::PacketSize))
+    {
+        displayInfo.Unpack();
+        displayInfo.ToCacheRecord(record);
+    }
+}
+
+Void SensorDevice::validateCachedInfo()
+{
+    // Device may have been lost since openDevice queued us.
+    if (!hDev)
+        return 0;
+
+    DeviceInfoCache::Record actual;
+    readInfoReports(&actual);
+
+    if (actual.Contents & DeviceInfoCache::Record::Contents_Range)
+    {
+        Lock::Locker lockScope(GetLock());
+        CurrentRange = actual.Range;
+    }
+
+    DeviceManager* manager = getManagerImpl();
+    if (manager->InfoCache.Update(actual))
+    {
+        LogText("OVR::SensorDevice - Cached info for '%s' was stale; updated\n",
+                getHIDDesc()->Path.ToCStr());
+
+        // Re-enumerate so that HMDDevice descriptors pick up the corrected DisplayInfo
+        // through HMDDeviceCreateDesc::UpdateMatchedCandidate.
+        if (actual.Contents & DeviceInfoCache::Record::Contents_Display)
+            manager->EnumerateAllFactoryDevices();
+    }
+    return 0;
+}
+
+
 void SensorDevice::closeDevice()
 {
     if (ReadRequested)
@@ -874,8 +981,16 @@ bool SensorDevice::setRange(const SensorRange& range)
     if (manager->HIDInterface.HidD_SetFeature(hDev, (void*)ssr.Buffer,
                                               SensorScaleRange::PacketSize))
     {
-        Lock::Locker lockScope(GetLock());
-        ssr.GetSensorRange(&CurrentRange);
+        DeviceInfoCache::Record record(getHIDDesc()->SerialNumber.ToCStr(),
+                                       getHIDDesc()->VersionNumber);
+        {
+            Lock::Locker lockScope(GetLock());
+            ssr.GetSensorRange(&CurrentRange);
+            record.Range = CurrentRange;
+        }
+        // Keep the cache in sync so the next open doesn't report a stale range.
+        record.Contents = DeviceInfoCache::Record::Contents_Range;
+        manager->InfoCache.Update(record);
         return true;
     }
     return false;
@@ -1099,6 +1214,9 @@ void SensorDevice::onTrackerMessage(TrackerMessage* message)
 {
     if (message->Type != TrackerMessage_Sensors)
         return;
+
+    // Starts when the packet is decoded; handlers such as SensorFusion nest inside.
+    OVR_PROFILE_SCOPE("TrackerMessage");
     
     const float     timeUnit   = (1.0f / 1000.f);
     TrackerSensors& s = message->Sensors;
@@ -120,6 +120,11 @@ protected:
     bool    initializeRead();
     bool    processReadResult();
 
+    // Reads SensorScaleRange and DisplayInfo feature reports into a cache record.
+    void    readInfoReports(DeviceInfoCache::Record* record);
+    // Queued by openDevice when it used cached info instead of reading the reports.
+    Void    validateCachedInfo();
+
     struct WriteData
     {
         enum { BufferSize = 64 };
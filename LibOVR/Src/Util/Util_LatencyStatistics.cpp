@@ -0,0 +1,142 @@
+/************************************************************************************
+
+Filename    :   Util_LatencyStatistics.cpp
+Content     :   Streaming latency histograms with percentile reporting.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "Util_LatencyStatistics.h"
+
+#include "../Kernel/OVR_Std.h"
+#include <math.h>
+
+namespace OVR { namespace Util {
+
+//-------------------------------------------------------------------------------------
+// ***** LatencyHistogram
+
+LatencyHistogram::LatencyHistogram()
+{
+    Reset();
+}
+
+void LatencyHistogram::Reset()
+{
+    memset(Counts, 0, sizeof(Counts));
+    TotalCount = 0;
+    MinValue   = 0xFFFFFFFF;
+    MaxValue   = 0;
+    Sum        = 0;
+}
+
+// Values below SubBucketCount get a bucket each. Above that, a value with its highest
+// set bit at position p is shifted right by (p - SubBucketBits), which leaves a
+// sub-bucket number in [SubBucketCount, 2*SubBucketCount); each shift amount owns
+// SubBucketCount consecutive buckets.
+unsigned LatencyHistogram::getBucketIndex(UInt32 value)
+{
+    if (value < SubBucketCount)
+        return value;
+
+    unsigned highBit = 0;
+    for (UInt32 v = value; v > 1; v >>= 1)
+        highBit++;
+
+    unsigned shift     = highBit - SubBucketBits;
+    unsigned subBucket = value >> shift;
+    return SubBucketCount * (shift + 1) + (subBucket - SubBucketCount);
+}
+
+UInt32 LatencyHistogram::getBucketHighestValue(unsigned index)
+{
+    if (index < SubBucketCount)
+        return index;
+
+    unsigned shift     = index / SubBucketCount - 1;
+    UInt64   subBucket = SubBucketCount + (index % SubBucketCount);
+    return (UInt32)(((subBucket + 1) << shift) - 1);
+}
+
+void LatencyHistogram::AddValue(UInt32 valueMicroS)
+{
+    Counts[getBucketIndex(valueMicroS)]++;
+    TotalCount++;
+    Sum += valueMicroS;
+    if (valueMicroS < MinValue)
+        MinValue = valueMicroS;
+    if (valueMicroS > MaxValue)
+        MaxValue = valueMicroS;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other)
+{
+    if (!other.TotalCount)
+        return;
+
+    for (unsigned i = 0; i < BucketCount; i++)
+        Counts[i] += other.Counts[i];
+    TotalCount += other.TotalCount;
+    Sum        += other.Sum;
+    if (other.MinValue < MinValue)
+        MinValue = other.MinValue;
+    if (other.MaxValue > MaxValue)
+        MaxValue = other.MaxValue;
+}
+
+double LatencyHistogram::GetMeanMicroS() const
+{
+    return TotalCount ? (double)Sum / (double)TotalCount : 0.0;
+}
+
+UInt32 LatencyHistogram::GetValueAtPercentile(float percentile) const
+{
+    if (!TotalCount)
+        return 0;
+
+    // Nearest-rank definition: the smallest value with at least 'percentile' percent
+    // of the values at or below it. The epsilon keeps e.g. 0.9 * 10 from rounding up.
+    double fraction = percentile < 0.0f ? 0.0 : (percentile > 100.0f ? 1.0 : percentile * 0.01);
+    UInt32 rank     = (UInt32)ceil(fraction * TotalCount - 1e-6);
+    if (rank < 1)
+        rank = 1;
+
+    UInt32 seen = 0;
+    for (unsigned i = 0; i < BucketCount; i++)
+    {
+        seen += Counts[i];
+        if (seen >= rank)
+        {
+            // Report the top of the bucket, but never beyond what was recorded.
+            UInt32 value = getBucketHighestValue(i);
+            if (value > MaxValue)
+                value = MaxValue;
+            if (value < MinValue)
+                value = MinValue;
+            return value;
+        }
+    }
+    return MaxValue;
+}
+
+void LatencyHistogram::GetStatistics(LatencyStatistics* stats) const
+{
+    stats->Count      = TotalCount;
+    stats->MinMilliS  = 0.001f * GetMinMicroS();
+    stats->MaxMilliS  = 0.001f * GetMaxMicroS();
+    stats->MeanMilliS = (float)(0.001 * GetMeanMicroS());
+    stats->P50MilliS  = 0.001f * GetValueAtPercentile(50.0f);
+    stats->P90MilliS  = 0.001f * GetValueAtPercentile(90.0f);
+    stats->P99MilliS  = 0.001f * GetValueAtPercentile(99.0f);
+    stats->P999MilliS = 0.001f * GetValueAtPercentile(99.9f);
+}
+
+
+}} // namespace OVR::Util
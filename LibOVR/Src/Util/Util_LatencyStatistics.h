@@ -0,0 +1,98 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   Util_LatencyStatistics.h
+Content     :   Streaming latency histograms with percentile reporting.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_LatencyStatistics_h
+#define OVR_Util_LatencyStatistics_h
+
+#include "../Kernel/OVR_Types.h"
+
+namespace OVR { namespace Util {
+
+
+//-------------------------------------------------------------------------------------
+// ***** LatencyStatistics
+
+// LatencyStatistics is a snapshot of the distribution of a latency value, in
+// milliseconds. Percentiles are accurate to within LatencyHistogram precision.
+struct LatencyStatistics
+{
+    UInt32  Count;
+    float   MinMilliS;
+    float   MaxMilliS;
+    float   MeanMilliS;
+    float   P50MilliS;
+    float   P90MilliS;
+    float   P99MilliS;
+    float   P999MilliS;
+
+    LatencyStatistics()
+        : Count(0), MinMilliS(0), MaxMilliS(0), MeanMilliS(0),
+          P50MilliS(0), P90MilliS(0), P99MilliS(0), P999MilliS(0) { }
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** LatencyHistogram
+
+// LatencyHistogram records latency values in microseconds into log-linear buckets,
+// in the manner of an HDR histogram: every power of two range is split into
+// SubBucketCount linear buckets, so any recorded value is known within 1/64 of itself
+// while the whole 32-bit range fits in a fixed array. Adding a value is O(1) and never
+// allocates; reading a percentile walks the bucket array.
+
+class LatencyHistogram
+{
+public:
+    enum
+    {
+        SubBucketBits  = 6,
+        SubBucketCount = 1 << SubBucketBits,
+        BucketCount    = SubBucketCount * (33 - SubBucketBits)
+    };
+
+    LatencyHistogram();
+
+    void    Reset();
+    void    AddValue(UInt32 valueMicroS);
+    // Adds all values recorded in another histogram.
+    void    Merge(const LatencyHistogram& other);
+
+    UInt32  GetCount() const        { return TotalCount; }
+    UInt32  GetMinMicroS() const    { return TotalCount ? MinValue : 0; }
+    UInt32  GetMaxMicroS() const    { return MaxValue; }
+    double  GetMeanMicroS() const;
+
+    // Returns the value below or at which 'percentile' percent of the recorded values
+    // fall, e.g. 99.9f for P99.9. Returns 0 if the histogram is empty.
+    UInt32  GetValueAtPercentile(float percentile) const;
+
+    void    GetStatistics(LatencyStatistics* stats) const;
+
+private:
+    static unsigned getBucketIndex(UInt32 value);
+    static UInt32   getBucketHighestValue(unsigned index);
+
+    UInt32  Counts[BucketCount];
+    UInt32  TotalCount;
+    UInt32  MinValue;
+    UInt32  MaxValue;
+    UInt64  Sum;
+};
+
+
+}} // namespace OVR::Util
+
+#endif // OVR_Util_LatencyStatistics_h
@@ -27,13 +27,13 @@ static const UInt32     DEFAULT_NUMBER_OF_SAMPLES = 10;                 // For b
 static const UInt32     INITIAL_SAMPLES_TO_IGNORE = 4;
 static const UInt32     TIMEOUT_WAITING_FOR_TEST_STARTED = 1000;
 static const UInt32     TIMEOUT_WAITING_FOR_COLOR_DETECTED = 4000;
+static const UInt32     MAX_CONTINUOUS_IDLE_TIME = 60000;
+static const float      MIN_CONTINUOUS_DUTY_CYCLE = 0.001f;
 static const Color      CALIBRATE_BLACK(0, 0, 0);
 static const Color      CALIBRATE_WHITE(255, 255, 255);
 static const Color      COLOR1(0, 0, 0);
 static const Color      COLOR2(255, 255, 255);
 static const Color      SENSOR_DETECT_THRESHOLD(128, 255, 255);
-static const float      BIG_FLOAT = 1000000.0f;
-static const float      SMALL_FLOAT = -1000000.0f;
 
 //-------------------------------------------------------------------------------------
 // ***** LatencyTest
@@ -47,6 +47,7 @@ LatencyTest::LatencyTest(LatencyTestDevice* device)
     }
 
     reset();
+    clearStatistics();
 }
 
 LatencyTest::~LatencyTest()
@@ -82,6 +83,12 @@ bool LatencyTest::SetDevice(LatencyTestDevice* device)
             // Set trigger threshold.
             LatencyTestConfiguration configuration(SENSOR_DETECT_THRESHOLD, false);     // No samples streaming.
             Device->SetConfiguration(configuration, true);
+
+            // Resume continuous monitoring on the new device.
+            if (IsContinuous() && State == State_WaitingForButton)
+            {
+                startCalibration();
+            }
         }
     }
 
@@ -154,6 +161,13 @@ void LatencyTest::handleMessage(const Message& msg, LatencyTestMessageType laten
         {
             // Prepare for next measurement.
 
+            // Continuous measurements are recorded as they complete, so only the
+            // active one needs to be kept.
+            if (IsContinuous())
+            {
+                clearMeasurementResults();
+            }
+
             // Create a new result object.
             MeasurementResult* pResult = new MeasurementResult();
             Results.PushBack(pResult);
@@ -161,10 +175,25 @@ void LatencyTest::handleMessage(const Message& msg, LatencyTestMessageType laten
             State = State_WaitingToTakeMeasurement;
             OVR_DEBUG_LOG(("State_WaitingForSettlePostMeasurement -> State_WaitingToTakeMeasurement."));
         }
+        else if (State == State_WaitingForNextContinuousMeasurement)
+        {
+            // Idle time is over; show the last color again and let it settle before measuring.
+            setContinuousStartTime();
+
+            State = State_WaitingForSettlePostMeasurement;
+            OVR_DEBUG_LOG(("State_WaitingForNextContinuousMeasurement -> State_WaitingForSettlePostMeasurement."));
+
+            setTimer(TIME_TO_WAIT_FOR_SETTLE_POST_MEASUREMENT);
+        }
         else if (State == State_WaitingForTestStarted)
         {
             // We timed out waiting for 'TestStarted'. Abandon this measurement and setup for the next.
             getActiveResult()->TimedOutWaitingForTestStarted = true;
+            TimeoutCount++;
+            {
+                Lock::Locker lock(&ContinuousLock);
+                Continuous.TimeoutCount++;
+            }
 
             State = State_WaitingForSettlePostMeasurement;
             OVR_DEBUG_LOG(("** Timed out waiting for 'TestStarted'."));
@@ -176,6 +205,11 @@ void LatencyTest::handleMessage(const Message& msg, LatencyTestMessageType laten
         {
             // We timed out waiting for 'ColorDetected'. Abandon this measurement and setup for the next.
             getActiveResult()->TimedOutWaitingForColorDetected = true;
+            TimeoutCount++;
+            {
+                Lock::Locker lock(&ContinuousLock);
+                Continuous.TimeoutCount++;
+            }
 
             State = State_WaitingForSettlePostMeasurement;
             OVR_DEBUG_LOG(("** Timed out waiting for 'ColorDetected'."));
@@ -216,13 +250,7 @@ void LatencyTest::handleMessage(const Message& msg, LatencyTestMessageType laten
     {
         if (State == State_WaitingForButton)
         {
-            // Set color to black and wait a while.
-            RenderColor = CALIBRATE_BLACK;
-
-            State = State_WaitingForSettlePreCalibrationColorBlack;
-            OVR_DEBUG_LOG(("State_WaitingForButton -> State_WaitingForSettlePreCalibrationColorBlack."));
-
-            setTimer(TIME_TO_WAIT_FOR_SETTLE_PRE_CALIBRATION);
+            startCalibration();
         }
     }
     else if (msg.Type == Message_LatencyTestStarted)
@@ -251,6 +279,34 @@ void LatencyTest::handleMessage(const Message& msg, LatencyTestMessageType laten
             
             getActiveResult()->DeviceMeasuredElapsedMilliS = elapsedTime;
 
+            bool  continuous = false;
+            float idleMilliS = 0;
+            {
+                Lock::Locker lock(&ContinuousLock);
+                if (Continuous.Active)
+                {
+                    continuous = true;
+                    recordContinuousMeasurement(*getActiveResult());
+
+                    // Stay idle long enough for the time spent measuring to match the duty cycle.
+                    UInt32 activeMilliS = Timer::GetTicksMs() - Continuous.ActiveStartMilliS;
+                    float  dutyCycle    = Continuous.Params.DutyCycle;
+                    idleMilliS = (float) activeMilliS * (1.0f - dutyCycle) / dutyCycle;
+                    idleMilliS = Alg::Min(idleMilliS, (float) MAX_CONTINUOUS_IDLE_TIME);
+                }
+            }
+
+            if (continuous)
+            {
+                State = State_WaitingForNextContinuousMeasurement;
+                OVR_DEBUG_LOG(("State_WaitingForColorDetected -> State_WaitingForNextContinuousMeasurement."));
+
+                setTimer(Alg::Max((UInt32) idleMilliS, (UInt32) 1));
+                return;
+            }
+
+            recordMeasurement(*getActiveResult());
+
             if (areResultsComplete())
             {
                 // We're done.
@@ -298,6 +354,254 @@ void LatencyTest::reset()
     ActiveTimerMilliS = 0;
 }
 
+void LatencyTest::startCalibration()
+{
+    // Starting a new test; drop the statistics of the previous one.
+    clearStatistics();
+    setContinuousStartTime();
+
+    // Set color to black and wait a while.
+    RenderColor = CALIBRATE_BLACK;
+
+    State = State_WaitingForSettlePreCalibrationColorBlack;
+    OVR_DEBUG_LOG(("State_WaitingForButton -> State_WaitingForSettlePreCalibrationColorBlack."));
+
+    setTimer(TIME_TO_WAIT_FOR_SETTLE_PRE_CALIBRATION);
+}
+
+void LatencyTest::clearStatistics()
+{
+    ElapsedHistogram1To2.Reset();
+    ElapsedHistogram2To1.Reset();
+    USBRoundTripHistogram.Reset();
+    TotalHistogram.Reset();
+    MeasurementCount = 0;
+    TimeoutCount = 0;
+    StatisticsComplete = false;
+}
+
+void LatencyTest::recordMeasurement(const MeasurementResult& result)
+{
+    MeasurementCount++;
+    if (MeasurementCount <= INITIAL_SAMPLES_TO_IGNORE)
+    {
+        return;
+    }
+
+    UInt32 usbRoundtripMicroS = (UInt32) (result.TestStartedTicksMicroS - result.StartTestTicksMicroS);
+    USBRoundTripHistogram.AddValue(usbRoundtripMicroS);
+
+    // Only the first DEFAULT_NUMBER_OF_SAMPLES of each transition count toward the test;
+    // the other direction may still need more.
+    LatencyHistogram& elapsedHistogram = (result.TargetColor == COLOR2) ? ElapsedHistogram1To2
+                                                                        : ElapsedHistogram2To1;
+    if (elapsedHistogram.GetCount() < DEFAULT_NUMBER_OF_SAMPLES)
+    {
+        UInt32 elapsedMicroS = result.DeviceMeasuredElapsedMilliS * 1000;
+        elapsedHistogram.AddValue(elapsedMicroS);
+        TotalHistogram.AddValue(elapsedMicroS + usbRoundtripMicroS);
+    }
+}
+
+void LatencyTest::GetStatistics(Statistics* stats) const
+{
+    ElapsedHistogram1To2.GetStatistics(&stats->BlackToWhite);
+    ElapsedHistogram2To1.GetStatistics(&stats->WhiteToBlack);
+    USBRoundTripHistogram.GetStatistics(&stats->USBRoundTrip);
+    TotalHistogram.GetStatistics(&stats->Total);
+    stats->TimeoutCount = TimeoutCount;
+    stats->Complete = StatisticsComplete;
+}
+
+bool LatencyTest::StartContinuous(const ContinuousParams& params, RegressionFn regressionFn, void* userData)
+{
+    if (!Device)
+    {
+        return false;
+    }
+
+    {
+        Lock::Locker lock(&ContinuousLock);
+        Continuous.Reset(params, regressionFn, userData);
+        Continuous.Params.DutyCycle  = Alg::Clamp(params.DutyCycle, MIN_CONTINUOUS_DUTY_CYCLE, 1.0f);
+        Continuous.Params.WindowSize = Alg::Max(params.WindowSize, (UInt32) 1);
+    }
+
+    // Abandon any interactive test in progress and calibrate from scratch.
+    reset();
+    startCalibration();
+    return true;
+}
+
+void LatencyTest::StopContinuous()
+{
+    {
+        Lock::Locker lock(&ContinuousLock);
+        if (!Continuous.Active)
+        {
+            return;
+        }
+        Continuous.Active = false;
+    }
+    reset();
+}
+
+bool LatencyTest::IsContinuous() const
+{
+    Lock::Locker lock(&ContinuousLock);
+    return Continuous.Active;
+}
+
+void LatencyTest::setContinuousStartTime()
+{
+    Lock::Locker lock(&ContinuousLock);
+    Continuous.ActiveStartMilliS = Timer::GetTicksMs();
+}
+
+void LatencyTest::ContinuousState::Reset(const ContinuousParams& params, RegressionFn regressionFn, void* userData)
+{
+    Active                 = true;
+    Params                 = params;
+    pRegressionFn          = regressionFn;
+    pUserData              = userData;
+    RegressionReported     = false;
+    PendingRegressionCheck = false;
+    ActiveStartMilliS      = 0;
+    MeasurementCount       = 0;
+    TimeoutCount           = 0;
+    Elapsed1To2.Reset();
+    Elapsed2To1.Reset();
+    USBRoundTrip.Reset();
+    Total.Reset();
+}
+
+void LatencyTest::RollingHistogram::Add(UInt32 valueMicroS, UInt32 windowSize)
+{
+    if (Current.GetCount() >= windowSize)
+    {
+        Previous = Current;
+        Current.Reset();
+    }
+    Current.AddValue(valueMicroS);
+}
+
+void LatencyTest::RollingHistogram::GetMerged(LatencyHistogram* merged) const
+{
+    *merged = Previous;
+    merged->Merge(Current);
+}
+
+void LatencyTest::RollingHistogram::Reset()
+{
+    Current.Reset();
+    Previous.Reset();
+}
+
+// Called with ContinuousLock held.
+void LatencyTest::recordContinuousMeasurement(const MeasurementResult& result)
+{
+    Continuous.MeasurementCount++;
+    if (Continuous.MeasurementCount <= INITIAL_SAMPLES_TO_IGNORE)
+    {
+        return;
+    }
+
+    UInt32 windowSize         = Continuous.Params.WindowSize;
+    UInt32 usbRoundtripMicroS = (UInt32) (result.TestStartedTicksMicroS - result.StartTestTicksMicroS);
+    UInt32 elapsedMicroS      = result.DeviceMeasuredElapsedMilliS * 1000;
+
+    if (result.TargetColor == COLOR2)
+    {
+        Continuous.Elapsed1To2.Add(elapsedMicroS, windowSize);
+    }
+    else
+    {
+        Continuous.Elapsed2To1.Add(elapsedMicroS, windowSize);
+    }
+    Continuous.USBRoundTrip.Add(usbRoundtripMicroS, windowSize);
+    Continuous.Total.Add(elapsedMicroS + usbRoundtripMicroS, windowSize);
+
+    Continuous.PendingRegressionCheck = true;
+}
+
+bool LatencyTest::GetContinuousStatistics(Statistics* stats) const
+{
+    Lock::Locker lock(&ContinuousLock);
+    if (!Continuous.Active)
+    {
+        return false;
+    }
+
+    LatencyHistogram merged;
+    Continuous.Elapsed1To2.GetMerged(&merged);
+    merged.GetStatistics(&stats->BlackToWhite);
+    Continuous.Elapsed2To1.GetMerged(&merged);
+    merged.GetStatistics(&stats->WhiteToBlack);
+    Continuous.USBRoundTrip.GetMerged(&merged);
+    merged.GetStatistics(&stats->USBRoundTrip);
+    Continuous.Total.GetMerged(&merged);
+    merged.GetStatistics(&stats->Total);
+    stats->TimeoutCount = Continuous.TimeoutCount;
+    stats->Complete = false;
+    return true;
+}
+
+void LatencyTest::checkForRegression()
+{
+    RegressionFn regressionFn = NULL;
+    void*        userData     = NULL;
+    Statistics   stats;
+    {
+        Lock::Locker lock(&ContinuousLock);
+        if (!Continuous.Active || !Continuous.PendingRegressionCheck)
+        {
+            return;
+        }
+        Continuous.PendingRegressionCheck = false;
+
+        const ContinuousParams& params = Continuous.Params;
+        if (params.RegressionThresholdMilliS <= 0.0f)
+        {
+            return;
+        }
+
+        LatencyHistogram total;
+        Continuous.Total.GetMerged(&total);
+        if (total.GetCount() < params.RegressionMinCount)
+        {
+            return;
+        }
+
+        float latencyMilliS = 0.001f * total.GetValueAtPercentile(params.RegressionPercentile);
+        if (latencyMilliS <= params.RegressionThresholdMilliS)
+        {
+            Continuous.RegressionReported = false;
+            return;
+        }
+        if (Continuous.RegressionReported)
+        {
+            return;
+        }
+        Continuous.RegressionReported = true;
+
+        LogText("OVR::Util::LatencyTest - Latency P%.1f of %.1fms exceeds %.1fms\n",
+                params.RegressionPercentile, latencyMilliS, params.RegressionThresholdMilliS);
+
+        regressionFn = Continuous.pRegressionFn;
+        userData     = Continuous.pUserData;
+        if (regressionFn)
+        {
+            GetContinuousStatistics(&stats);
+        }
+    }
+
+    // Run the callback without the lock so that it may stop or restart monitoring.
+    if (regressionFn)
+    {
+        regressionFn(this, stats, userData);
+    }
+}
+
 void LatencyTest::clearMeasurementResults()
 {
     while(!Results.IsEmpty())
@@ -322,13 +626,15 @@ void LatencyTest::ProcessInputs()
 {
     updateForTimeouts();
     handleMessage(Message(), LatencyTest_ProcessInputs);
+    checkForRegression();
 }
 
 bool LatencyTest::DisplayScreenColor(Color& colorToDisplay)
 {
     updateForTimeouts();
 
-    if (State == State_WaitingForButton)
+    if (State == State_WaitingForButton ||
+        State == State_WaitingForNextContinuousMeasurement)
     {
         return false;
     }
@@ -350,146 +656,29 @@ const char*	LatencyTest::GetResultsString()
 
 bool LatencyTest::areResultsComplete()
 {
-    UInt32 initialMeasurements = 0;
-
-    UInt32 measurements1to2 = 0;
-    UInt32 measurements2to1 = 0;
-
-    MeasurementResult* pCurr = Results.GetFirst();
-    while(true)
-    {
-        // Process.
-        if (!pCurr->TimedOutWaitingForTestStarted &&
-            !pCurr->TimedOutWaitingForColorDetected)
-        {
-            initialMeasurements++;
-
-            if (initialMeasurements > INITIAL_SAMPLES_TO_IGNORE)
-            {
-                if (pCurr->TargetColor == COLOR2)
-                {
-                    measurements1to2++;
-                }
-                else
-                {
-                    measurements2to1++;
-                }
-            }
-        }
-
-        if (Results.IsLast(pCurr))
-        {
-            break;
-        }
-        pCurr = Results.GetNext(pCurr);
-    }
-
-    if (measurements1to2 >= DEFAULT_NUMBER_OF_SAMPLES &&
-        measurements2to1 >= DEFAULT_NUMBER_OF_SAMPLES)
-    {
-        return true;
-    }
-
-    return false;
+    return ElapsedHistogram1To2.GetCount() >= DEFAULT_NUMBER_OF_SAMPLES &&
+           ElapsedHistogram2To1.GetCount() >= DEFAULT_NUMBER_OF_SAMPLES;
 }
 
 void LatencyTest::processResults()
 {
+    // Statistics were accumulated by recordMeasurement as measurements came in.
+    StatisticsComplete = true;
 
-    UInt32 minTime1To2 = UINT_MAX;
-    UInt32 maxTime1To2 = 0;
-    float averageTime1To2 = 0.0f;
-    UInt32 minTime2To1 = UINT_MAX;
-    UInt32 maxTime2To1 = 0;
-    float averageTime2To1 = 0.0f;
-
-    float minUSBTripMilliS = BIG_FLOAT;
-    float maxUSBTripMilliS = SMALL_FLOAT;
-    float averageUSBTripMilliS = 0.0f;
-    UInt32 countUSBTripTime = 0;
-
-    UInt32 measurementsCount = 0;
-    UInt32 measurements1to2 = 0;
-    UInt32 measurements2to1 = 0;
-
-    MeasurementResult* pCurr = Results.GetFirst();
-    UInt32 count = 0;
-    while(true)
-    {
-        count++;
-
-        if (!pCurr->TimedOutWaitingForTestStarted &&
-            !pCurr->TimedOutWaitingForColorDetected)
-        {
-            measurementsCount++;
-
-            if (measurementsCount > INITIAL_SAMPLES_TO_IGNORE)
-            {
-                if (pCurr->TargetColor == COLOR2)
-                {
-                    measurements1to2++;
-
-                    if (measurements1to2 <= DEFAULT_NUMBER_OF_SAMPLES)
-                    {
-                        UInt32 elapsed = pCurr->DeviceMeasuredElapsedMilliS;
-
-                        minTime1To2 = Alg::Min(elapsed, minTime1To2);
-                        maxTime1To2 = Alg::Max(elapsed, maxTime1To2);
-
-                        averageTime1To2 += (float) elapsed;
-                    }
-                }
-                else
-                {
-                    measurements2to1++;
-
-                    if (measurements2to1 <= DEFAULT_NUMBER_OF_SAMPLES)
-                    {
-                        UInt32 elapsed = pCurr->DeviceMeasuredElapsedMilliS;
-
-                        minTime2To1 = Alg::Min(elapsed, minTime2To1);
-                        maxTime2To1 = Alg::Max(elapsed, maxTime2To1);
+    Statistics stats;
+    GetStatistics(&stats);
 
-                        averageTime2To1 += (float) elapsed;
-                    }
-                }
-
-                float usbRountripElapsedMilliS = 0.001f * (float) (pCurr->TestStartedTicksMicroS - pCurr->StartTestTicksMicroS);
-                minUSBTripMilliS = Alg::Min(usbRountripElapsedMilliS, minUSBTripMilliS);
-                maxUSBTripMilliS = Alg::Max(usbRountripElapsedMilliS, maxUSBTripMilliS);
-                averageUSBTripMilliS += usbRountripElapsedMilliS;
-                countUSBTripTime++;
-            }
-        }
-
-        if (measurements1to2 >= DEFAULT_NUMBER_OF_SAMPLES &&
-            measurements2to1 >= DEFAULT_NUMBER_OF_SAMPLES)
-        {
-            break;
-        }
-
-        if (Results.IsLast(pCurr))
-        {
-            break;
-        }
-        pCurr = Results.GetNext(pCurr);
-    }
-
-    averageTime1To2 /= (float) DEFAULT_NUMBER_OF_SAMPLES;      
-    averageTime2To1 /= (float) DEFAULT_NUMBER_OF_SAMPLES;
-
-    averageUSBTripMilliS /= countUSBTripTime;
-    
-    float finalResult = 0.5f * (averageTime1To2 + averageTime2To1);
-    finalResult += averageUSBTripMilliS;
+    float finalResult = 0.5f * (stats.BlackToWhite.MeanMilliS + stats.WhiteToBlack.MeanMilliS);
+    finalResult += stats.USBRoundTrip.MeanMilliS;
 
     ResultsString.Clear();
-    ResultsString.AppendFormat("RESULT=%.1f (add half Tracker period) [b->w %d|%.1f|%d] [w->b %d|%.1f|%d] [usb rndtrp %.1f|%.1f|%.1f] [cnt %d] [tmouts %d]",  
+    ResultsString.AppendFormat("RESULT=%.1f (add half Tracker period) [b->w %.0f|%.1f|%.0f] [w->b %.0f|%.1f|%.0f] [usb rndtrp %.1f|%.1f|%.1f] [p50|p90|p99|p99.9 %.1f|%.1f|%.1f|%.1f] [cnt %d] [tmouts %d]",  
                 finalResult, 
-                minTime1To2, averageTime1To2, maxTime1To2, 
-                minTime2To1, averageTime2To1, maxTime2To1,
-                minUSBTripMilliS, averageUSBTripMilliS, maxUSBTripMilliS,
-                DEFAULT_NUMBER_OF_SAMPLES*2, count - measurementsCount);
+                stats.BlackToWhite.MinMilliS, stats.BlackToWhite.MeanMilliS, stats.BlackToWhite.MaxMilliS, 
+                stats.WhiteToBlack.MinMilliS, stats.WhiteToBlack.MeanMilliS, stats.WhiteToBlack.MaxMilliS,
+                stats.USBRoundTrip.MinMilliS, stats.USBRoundTrip.MeanMilliS, stats.USBRoundTrip.MaxMilliS,
+                stats.Total.P50MilliS, stats.Total.P90MilliS, stats.Total.P99MilliS, stats.Total.P999MilliS,
+                DEFAULT_NUMBER_OF_SAMPLES*2, stats.TimeoutCount);
 }
 
 void LatencyTest::updateForTimeouts()
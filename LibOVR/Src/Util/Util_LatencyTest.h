@@ -18,6 +18,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #define OVR_Util_LatencyTest_h
 
 #include "../OVR_Device.h"
+#include "Util_LatencyStatistics.h"
 
 #include "../Kernel/OVR_String.h"
 #include "../Kernel/OVR_List.h"
@@ -49,6 +50,13 @@ namespace OVR { namespace Util {
 //							If the string has already been gotten then NULL will be returned.
 //							The string pointer will remain valid until the next time this 
 //							method is called.
+//      GetStatistics - Optional; returns the latency distributions of the current or most
+//                      recent test, including P50/P90/P99/P99.9 percentiles.
+//
+// Instead of waiting for the tester button, StartContinuous runs measurements for as long
+// as the application runs. The tester color is then only shown for a small fraction of
+// the time (the duty cycle), so it can stay enabled during normal use; rolling statistics
+// are available from GetContinuousStatistics.
 //
 
 class LatencyTest : public NewOverrideBase
@@ -69,6 +77,56 @@ public:
     bool        DisplayScreenColor(Color& colorToDisplay);
 	const char*	GetResultsString();
 
+    // Latency distributions of the current or most recent test. They are updated as
+    // each measurement completes and cleared when a new test is started.
+    struct Statistics
+    {
+        LatencyStatistics   BlackToWhite;   // Device-measured time to detect color 1->2.
+        LatencyStatistics   WhiteToBlack;   // Device-measured time to detect color 2->1.
+        LatencyStatistics   USBRoundTrip;   // 'StartTest' sent to 'TestStarted' received.
+        LatencyStatistics   Total;          // Detection time plus USB round trip, per measurement.
+        UInt32              TimeoutCount;
+        bool                Complete;       // True once the test collected all its samples.
+
+        Statistics() : TimeoutCount(0), Complete(false) { }
+    };
+    void        GetStatistics(Statistics* stats) const;
+
+    // Continuous monitoring parameters.
+    struct ContinuousParams
+    {
+        // Fraction of time during which the test color is displayed, in (0, 1].
+        float       DutyCycle;
+        // Number of measurements after which the rolling window advances; rolling
+        // statistics cover between one and two windows of the latest measurements.
+        UInt32      WindowSize;
+        // Regression is reported once the given percentile of Total latency in the
+        // rolling window exceeds the threshold; a threshold of 0 disables it.
+        float       RegressionThresholdMilliS;
+        float       RegressionPercentile;
+        // Number of measurements required before regression is checked.
+        UInt32      RegressionMinCount;
+
+        ContinuousParams()
+            : DutyCycle(0.05f), WindowSize(100), RegressionThresholdMilliS(0),
+              RegressionPercentile(99.0f), RegressionMinCount(20) { }
+    };
+
+    // Called from ProcessInputs when latency first exceeds the regression threshold;
+    // it is called again only after latency has dropped back to the threshold or below.
+    typedef void (*RegressionFn)(LatencyTest* test, const Statistics& rollingStats, void* userData);
+
+    // Starts continuous monitoring. The device must be set; calibration runs first,
+    // followed by measurements spaced out according to the duty cycle.
+    bool        StartContinuous(const ContinuousParams& params,
+                                RegressionFn regressionFn = NULL, void* userData = NULL);
+    void        StopContinuous();
+    bool        IsContinuous() const;
+
+    // Statistics over the rolling window of continuous measurements. Returns false
+    // if continuous monitoring is not running.
+    bool        GetContinuousStatistics(Statistics* stats) const;
+
 private:
     LatencyTest* getThis()  { return this; }
 
@@ -97,6 +155,10 @@ private:
     bool areResultsComplete();
     void processResults();
     void updateForTimeouts();
+    void clearStatistics();
+    void startCalibration();
+    void checkForRegression();
+    void setContinuousStartTime();
 
     Ptr<LatencyTestDevice>      Device;
     LatencyTestHandler          Handler;
@@ -111,7 +173,8 @@ private:
         State_WaitingToTakeMeasurement,
         State_WaitingForTestStarted,
         State_WaitingForColorDetected,
-        State_WaitingForSettlePostMeasurement
+        State_WaitingForSettlePostMeasurement,
+        State_WaitingForNextContinuousMeasurement
     };
     TesterState                 State;
 
@@ -146,6 +209,62 @@ private:
     void clearMeasurementResults();
 
     MeasurementResult*          getActiveResult();
+    void                        recordMeasurement(const MeasurementResult& result);
+    void                        recordContinuousMeasurement(const MeasurementResult& result);
+
+    LatencyHistogram            ElapsedHistogram1To2;
+    LatencyHistogram            ElapsedHistogram2To1;
+    LatencyHistogram            USBRoundTripHistogram;
+    LatencyHistogram            TotalHistogram;
+    UInt32                      MeasurementCount;
+    UInt32                      TimeoutCount;
+    bool                        StatisticsComplete;
+
+    // A pair of histograms covering a rolling window of continuous measurements;
+    // Previous holds the last full window, Current the one being filled.
+    struct RollingHistogram
+    {
+        LatencyHistogram        Current;
+        LatencyHistogram        Previous;
+
+        void Add(UInt32 valueMicroS, UInt32 windowSize);
+        void GetMerged(LatencyHistogram* merged) const;
+        void Reset();
+    };
+
+    // Continuous monitoring state. Messages from the device thread update it while the
+    // application thread starts, stops and reads it, so every access is made under
+    // ContinuousLock. The lock is never held across calls into the device, which may
+    // wait on the device thread. The state is kept for the lifetime of the tester so
+    // that stopping never frees it under the other thread.
+    struct ContinuousState
+    {
+        ContinuousState()
+         :  Active(false), pRegressionFn(NULL), pUserData(NULL),
+            RegressionReported(false), PendingRegressionCheck(false),
+            ActiveStartMilliS(0), MeasurementCount(0), TimeoutCount(0)
+        {}
+
+        void Reset(const ContinuousParams& params, RegressionFn regressionFn, void* userData);
+
+        bool                    Active;
+        ContinuousParams        Params;
+        RegressionFn            pRegressionFn;
+        void*                   pUserData;
+        bool                    RegressionReported;
+        // Set by the device thread when a measurement completes; ProcessInputs then
+        // checks for regression so that the callback runs on the application thread.
+        bool                    PendingRegressionCheck;
+        UInt32                  ActiveStartMilliS;
+        UInt32                  MeasurementCount;
+        UInt32                  TimeoutCount;
+        RollingHistogram        Elapsed1To2;
+        RollingHistogram        Elapsed2To1;
+        RollingHistogram        USBRoundTrip;
+        RollingHistogram        Total;
+    };
+    ContinuousState             Continuous;
+    mutable Lock                ContinuousLock;
 
     StringBuffer			    ResultsString;
 	String					    ReturnedResultString;
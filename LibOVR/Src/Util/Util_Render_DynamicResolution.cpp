@@ -0,0 +1,151 @@
+/************************************************************************************
+
+Filename    :   Util_Render_DynamicResolution.cpp
+Content     :   Render scale controller that holds a target frame time.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "Util_Render_DynamicResolution.h"
+
+#include "../Kernel/OVR_Alg.h"
+#include <math.h>
+
+namespace OVR { namespace Util { namespace Render {
+
+
+// Filter weights of a new frame time: rising times are followed within a couple of
+// frames, while falling ones are trusted only after they persist.
+static const float RisingTimeWeight  = 0.5f;
+static const float FallingTimeWeight = 0.1f;
+
+// Number of frames that must stay below the increase threshold before the scale is
+// raised, and the largest relative step taken per frame when raising it.
+static const int   IncreaseDelayFrames = 30;
+static const float MaxIncreaseStep     = 0.02f;
+
+// A frame whose CPU time is this close to its GPU time is considered CPU limited.
+static const float CpuLimitedRatio     = 0.95f;
+
+const float DynamicResolutionController::TargetUtilization = 0.85f;
+
+
+//-----------------------------------------------------------------------------------
+// ***** DynamicResolutionController
+
+DynamicResolutionController::DynamicResolutionController(float targetFrameTime,
+                                                         float minScale, float maxScale)
+  : TargetFrameTime(targetFrameTime),
+    MinScale(minScale), MaxScale(maxScale),
+    DecreaseThreshold(0.92f), IncreaseThreshold(0.75f),
+    Scale(maxScale), FilteredGpuTime(0), FilteredCpuTime(0),
+    HasHistory(false), UnderBudgetFrames(0)
+{
+    OVR_ASSERT(minScale > 0.0f && minScale <= maxScale);
+}
+
+void DynamicResolutionController::SetTargetFrameTime(float seconds)
+{
+    OVR_ASSERT(seconds > 0.0f);
+    TargetFrameTime   = seconds;
+    UnderBudgetFrames = 0;
+}
+
+void DynamicResolutionController::SetScaleRange(float minScale, float maxScale)
+{
+    OVR_ASSERT(minScale > 0.0f && minScale <= maxScale);
+    MinScale = minScale;
+    MaxScale = maxScale;
+
+    float scale = Alg::Clamp(Scale, MinScale, MaxScale);
+    if (HasHistory)
+        FilteredGpuTime *= (scale * scale) / (Scale * Scale);
+    Scale = scale;
+}
+
+void DynamicResolutionController::SetThresholds(float decrease, float increase)
+{
+    OVR_ASSERT(increase < TargetUtilization && TargetUtilization < decrease);
+    DecreaseThreshold = decrease;
+    IncreaseThreshold = increase;
+}
+
+void DynamicResolutionController::Reset(float scale)
+{
+    Scale             = Alg::Clamp(scale, MinScale, MaxScale);
+    FilteredGpuTime   = 0;
+    FilteredCpuTime   = 0;
+    HasHistory        = false;
+    UnderBudgetFrames = 0;
+}
+
+float DynamicResolutionController::Update(float cpuTime, float gpuTime)
+{
+    if (gpuTime <= 0.0f)
+        gpuTime = cpuTime;
+
+    if (!HasHistory)
+    {
+        FilteredGpuTime = gpuTime;
+        FilteredCpuTime = cpuTime;
+        HasHistory      = true;
+    }
+    else
+    {
+        FilteredGpuTime += (gpuTime - FilteredGpuTime) *
+                           ((gpuTime > FilteredGpuTime) ? RisingTimeWeight : FallingTimeWeight);
+        FilteredCpuTime += (cpuTime - FilteredCpuTime) *
+                           ((cpuTime > FilteredCpuTime) ? RisingTimeWeight : FallingTimeWeight);
+    }
+
+    if (FilteredGpuTime <= 0.0f)
+        return Scale;
+
+    // Scale at which the GPU time would land at TargetUtilization of the target.
+    float idealScale = Scale * sqrtf(TargetFrameTime * TargetUtilization / FilteredGpuTime);
+    float newScale   = Scale;
+    bool  cpuLimited = (FilteredCpuTime >= FilteredGpuTime * CpuLimitedRatio);
+
+    if (FilteredGpuTime > TargetFrameTime * DecreaseThreshold)
+    {
+        UnderBudgetFrames = 0;
+        if (!cpuLimited)
+            newScale = Alg::Max(idealScale, MinScale);
+    }
+    else if (FilteredGpuTime < TargetFrameTime * IncreaseThreshold)
+    {
+        if (++UnderBudgetFrames >= IncreaseDelayFrames)
+            newScale = Alg::Min(Alg::Min(idealScale, Scale * (1.0f + MaxIncreaseStep)), MaxScale);
+    }
+    else
+    {
+        UnderBudgetFrames = 0;
+    }
+
+    if (newScale != Scale)
+    {
+        // Predict the GPU time at the new scale, so that the next frames aren't judged
+        // by times measured at the old one.
+        FilteredGpuTime *= (newScale * newScale) / (Scale * Scale);
+        Scale = newScale;
+    }
+    return Scale;
+}
+
+bool DynamicResolutionController::IsOverBudget() const
+{
+    if (!HasHistory)
+        return false;
+    return (Alg::Max(FilteredGpuTime, FilteredCpuTime) > TargetFrameTime * DecreaseThreshold) &&
+           ((Scale <= MinScale) || (FilteredCpuTime >= FilteredGpuTime * CpuLimitedRatio));
+}
+
+
+}}}  // OVR::Util::Render
@@ -0,0 +1,97 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   Util_Render_DynamicResolution.h
+Content     :   Render scale controller that holds a target frame time.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_Render_DynamicResolution_h
+#define OVR_Util_Render_DynamicResolution_h
+
+#include "../Kernel/OVR_Types.h"
+
+namespace OVR { namespace Util { namespace Render {
+
+
+//-----------------------------------------------------------------------------------
+// ***** DynamicResolutionController
+
+// DynamicResolutionController picks the scene render scale for the next frame from
+// the CPU and GPU times of the frames before it, so that frame time stays below the
+// target instead of dropping frames when the content gets heavier.
+//
+// GPU cost is assumed to be proportional to the number of pixels rendered, i.e. to
+// the square of the scale. Rising GPU times are followed quickly and the scale is cut
+// as soon as the filtered time exceeds the upper threshold; the scale is raised again
+// only after frames have stayed below the lower threshold for a while, and then only
+// in small steps. Between the two thresholds the scale is left alone, which keeps it
+// from oscillating. Frames that are limited by the CPU rather than the GPU don't
+// reduce the scale, as rendering fewer pixels wouldn't make them faster.
+//
+// Typical use, once per frame:
+//      pRender->SetSceneRenderScale(controller.Update(cpuSeconds, gpuSeconds));
+
+class DynamicResolutionController
+{
+public:
+    DynamicResolutionController(float targetFrameTime = 1.0f / 60.0f,
+                                float minScale = 0.5f, float maxScale = 1.0f);
+
+    // Frame time to hold, in seconds; usually the display refresh period.
+    void    SetTargetFrameTime(float seconds);
+    float   GetTargetFrameTime() const          { return TargetFrameTime; }
+
+    // Range of scales that Update may return. The current scale is clamped to it.
+    void    SetScaleRange(float minScale, float maxScale);
+    float   GetMinScale() const                 { return MinScale; }
+    float   GetMaxScale() const                 { return MaxScale; }
+
+    // Thresholds are fractions of the target frame time: the scale goes down once the
+    // filtered GPU time is above 'decrease', and up once it stays below 'increase'.
+    // The scale is adjusted so that GPU time lands at TargetUtilization in both cases.
+    void    SetThresholds(float decrease, float increase);
+
+    // Restarts the controller at the given scale with no timing history.
+    void    Reset(float scale);
+
+    // Records the timing of the last frame, in seconds, and returns the scale to use for
+    // the next one. 'gpuTime' is the time the GPU spent on the frame; pass 0 if it isn't
+    // known, in which case the whole of 'cpuTime' is assumed to scale with resolution.
+    float   Update(float cpuTime, float gpuTime);
+
+    float   GetScale() const                    { return Scale; }
+    float   GetFilteredGpuTime() const          { return FilteredGpuTime; }
+    float   GetFilteredCpuTime() const          { return FilteredCpuTime; }
+
+    // Returns true if frames are over budget even at the minimum scale, so that other
+    // measures such as a lower scene detail level are needed.
+    bool    IsOverBudget() const;
+
+    // Fraction of the target frame time that scale changes aim for.
+    static const float TargetUtilization;
+
+private:
+    float   TargetFrameTime;
+    float   MinScale, MaxScale;
+    float   DecreaseThreshold, IncreaseThreshold;
+
+    float   Scale;
+    float   FilteredGpuTime;
+    float   FilteredCpuTime;
+    bool    HasHistory;
+    int     UnderBudgetFrames;
+};
+
+
+}}}  // OVR::Util::Render
+
+#endif // OVR_Util_Render_DynamicResolution_h
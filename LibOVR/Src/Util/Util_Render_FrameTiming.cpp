@@ -0,0 +1,80 @@
+/************************************************************************************
+
+Filename    :   Util_Render_FrameTiming.cpp
+Content     :   Scanout time estimation for per-eye orientation prediction.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "Util_Render_FrameTiming.h"
+
+#include "../Kernel/OVR_Timer.h"
+
+namespace OVR { namespace Util { namespace Render {
+
+
+//-----------------------------------------------------------------------------------
+// ***** FrameTiming
+
+FrameTiming::FrameTiming(float refreshRate)
+    : FrameDelta(1.0 / refreshRate), VSyncTicks(0), FrameScanoutTicks(0)
+{
+    EyeScanoutFraction[0] = 0.25f;
+    EyeScanoutFraction[1] = 0.75f;
+}
+
+void FrameTiming::SetRefreshRate(float refreshRate)
+{
+    OVR_ASSERT(refreshRate > 0.0f);
+    FrameDelta = 1.0 / refreshRate;
+}
+
+void FrameTiming::SetEyeScanoutFractions(float left, float right)
+{
+    EyeScanoutFraction[0] = left;
+    EyeScanoutFraction[1] = right;
+}
+
+void FrameTiming::MarkVSync(UInt64 ticks)
+{
+    VSyncTicks = ticks ? ticks : Timer::GetTicks();
+}
+
+void FrameTiming::BeginFrame(UInt64 ticks)
+{
+    if (ticks == 0)
+        ticks = Timer::GetTicks();
+
+    // Without a recorded vsync the phase is unknown; any phase keeps the eyes
+    // a consistent time apart.
+    if (VSyncTicks == 0)
+        VSyncTicks = ticks;
+
+    double frameDeltaTicks = FrameDelta * Timer::MksPerSecond;
+    double sinceVSync      = (ticks > VSyncTicks) ? double(ticks - VSyncTicks) : 0.0;
+    UInt64 frames          = UInt64(sinceVSync / frameDeltaTicks) + 1;
+
+    FrameScanoutTicks = VSyncTicks + UInt64(frames * frameDeltaTicks);
+}
+
+UInt64 FrameTiming::GetEyeScanoutTicks(StereoEye eye) const
+{
+    float fraction;
+    switch (eye)
+    {
+    case StereoEye_Left:  fraction = EyeScanoutFraction[0]; break;
+    case StereoEye_Right: fraction = EyeScanoutFraction[1]; break;
+    default:              fraction = (EyeScanoutFraction[0] + EyeScanoutFraction[1]) * 0.5f; break;
+    }
+    return FrameScanoutTicks + UInt64(fraction * FrameDelta * Timer::MksPerSecond);
+}
+
+
+}}}  // OVR::Util::Render
@@ -0,0 +1,86 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   Util_Render_FrameTiming.h
+Content     :   Scanout time estimation for per-eye orientation prediction.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_Render_FrameTiming_h
+#define OVR_Util_Render_FrameTiming_h
+
+#include "Util_Render_Stereo.h"
+#include "../OVR_SensorFusion.h"
+
+namespace OVR { namespace Util { namespace Render {
+
+
+//-----------------------------------------------------------------------------------
+// ***** FrameTiming
+
+// FrameTiming estimates when the frame being rendered reaches the display, so that
+// each eye can be rendered with the orientation predicted for the time its half of
+// the panel is scanned out, rather than with a single orientation read at frame start.
+// The panel is scanned out over one refresh period starting at vsync; by default the
+// left eye's half is assumed to be scanned out first, as on a landscape panel scanned
+// from left to right.
+//
+// Typical use:
+//      FrameTiming.BeginFrame();                                   // At frame start.
+//      Quatf orient = FrameTiming.GetPredictedOrientation(SFusion, eye);  // Per eye pass.
+//      ...
+//      pRender->Present();
+//      FrameTiming.MarkVSync();                                    // With vsync enabled.
+
+class FrameTiming
+{
+public:
+    FrameTiming(float refreshRate = 60.0f);
+
+    void    SetRefreshRate(float refreshRate);
+    float   GetRefreshRate() const          { return 1.0f / float(FrameDelta); }
+
+    // Fractions of the refresh period after vsync at which the middle of each eye's
+    // half of the panel is scanned out; 0.25 and 0.75 for the left and right eyes
+    // by default. The center eye uses their average.
+    void    SetEyeScanoutFractions(float left, float right);
+
+    // Records a vsync time, in Timer::GetTicks() units; 0 reads the timer. Calling
+    // this right after a vsync-synchronized Present returns keeps the estimated vsync
+    // phase locked to the display.
+    void    MarkVSync(UInt64 ticks = 0);
+
+    // Starts a new frame at 'ticks'; 0 reads the timer. The frame is assumed to be
+    // scanned out starting at the first vsync after that.
+    void    BeginFrame(UInt64 ticks = 0);
+
+    // Vsync at which the current frame starts scanning out.
+    UInt64  GetFrameScanoutTicks() const    { return FrameScanoutTicks; }
+    // Time at which the middle of the eye's part of the panel is scanned out.
+    UInt64  GetEyeScanoutTicks(StereoEye eye) const;
+
+    // Returns the sensor orientation predicted for the eye's scanout time.
+    Quatf   GetPredictedOrientation(const SensorFusion& sfusion, StereoEye eye) const
+    {
+        return sfusion.GetPredictedOrientationAt(GetEyeScanoutTicks(eye));
+    }
+
+private:
+    double  FrameDelta;             // Refresh period, in seconds.
+    float   EyeScanoutFraction[2];  // Left, right.
+    UInt64  VSyncTicks;
+    UInt64  FrameScanoutTicks;
+};
+
+
+}}}  // OVR::Util::Render
+
+#endif // OVR_Util_Render_FrameTiming_h
@@ -0,0 +1,501 @@
+/************************************************************************************
+
+Filename    :   Util_Render_SoftwareDistortion.cpp
+Content     :   CPU implementation of the lens distortion post-process.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "Util_Render_SoftwareDistortion.h"
+
+#include "../Kernel/OVR_Alg.h"
+#include "../Kernel/OVR_Std.h"
+#include <math.h>
+
+#if defined(OVR_CPU_SSE) && (defined(__SSE2__) || defined(OVR_CPU_X86_64) || defined(OVR_CC_MSVC))
+#define OVR_SOFTWAREDISTORTION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace OVR { namespace Util { namespace Render {
+
+
+//-----------------------------------------------------------------------------------
+// ***** Sampling helpers
+
+// Bilinear filter taps of a scene location, in pixels relative to the eye's scene
+// rectangle. Taps are clamped to the rectangle, so that the other eye never bleeds in.
+struct BilinearTaps
+{
+    const UByte* pRow0;
+    const UByte* pRow1;
+    int          X0, X1;    // Byte offsets within a row.
+    float        FracX, FracY;
+};
+
+static inline void computeTaps(const DistortionImage& scene, int srcX, int srcY, int srcW, int srcH,
+                               float u, float v, BilinearTaps* taps)
+{
+    float fx = floorf(u);
+    float fy = floorf(v);
+    int   x0 = (int)fx;
+    int   y0 = (int)fy;
+
+    taps->FracX = u - fx;
+    taps->FracY = v - fy;
+
+    int x1 = Alg::Clamp(x0 + 1, 0, srcW - 1);
+    int y1 = Alg::Clamp(y0 + 1, 0, srcH - 1);
+    x0     = Alg::Clamp(x0, 0, srcW - 1);
+    y0     = Alg::Clamp(y0, 0, srcH - 1);
+
+    taps->pRow0 = scene.pData + (srcY + y0) * scene.Pitch;
+    taps->pRow1 = scene.pData + (srcY + y1) * scene.Pitch;
+    taps->X0    = (srcX + x0) * 4;
+    taps->X1    = (srcX + x1) * 4;
+}
+
+static inline void sampleBilinear(const BilinearTaps& taps, float result[4])
+{
+    const UByte* a = taps.pRow0 + taps.X0;
+    const UByte* b = taps.pRow0 + taps.X1;
+    const UByte* c = taps.pRow1 + taps.X0;
+    const UByte* d = taps.pRow1 + taps.X1;
+
+    for (int i = 0; i < 4; i++)
+    {
+        float top    = a[i] + (b[i] - a[i]) * taps.FracX;
+        float bottom = c[i] + (d[i] - c[i]) * taps.FracX;
+        result[i]    = top + (bottom - top) * taps.FracY;
+    }
+}
+
+#if defined(OVR_SOFTWAREDISTORTION_SSE2)
+
+static inline __m128 loadTexel(const UByte* p)
+{
+    int texel;
+    memcpy(&texel, p, 4);
+    __m128i zero = _mm_setzero_si128();
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(texel), zero), zero));
+}
+
+static inline __m128 sampleBilinearSSE(const BilinearTaps& taps)
+{
+    __m128 a      = loadTexel(taps.pRow0 + taps.X0);
+    __m128 b      = loadTexel(taps.pRow0 + taps.X1);
+    __m128 c      = loadTexel(taps.pRow1 + taps.X0);
+    __m128 d      = loadTexel(taps.pRow1 + taps.X1);
+    __m128 fx     = _mm_set1_ps(taps.FracX);
+    __m128 top    = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fx));
+    __m128 bottom = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), fx));
+    return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(taps.FracY)));
+}
+
+static inline void storePixelSSE(UByte* dest, __m128 color)
+{
+    __m128i packed = _mm_cvtps_epi32(color);
+    packed = _mm_packs_epi32(packed, packed);
+    packed = _mm_packus_epi16(packed, packed);
+    int pixel = _mm_cvtsi128_si32(packed);
+    memcpy(dest, &pixel, 4);
+}
+
+// Applies a timewarp matrix to four points; points with w <= 0 are moved outside
+// of the [-1,1] range, so that they are cleared.
+static inline void reprojectSSE(const float m[3][3], __m128* x, __m128* y)
+{
+    __m128 w  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2][0]), *x),
+                                      _mm_mul_ps(_mm_set1_ps(m[2][1]), *y)), _mm_set1_ps(m[2][2]));
+    __m128 wx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0][0]), *x),
+                                      _mm_mul_ps(_mm_set1_ps(m[0][1]), *y)), _mm_set1_ps(m[0][2]));
+    __m128 wy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[1][0]), *x),
+                                      _mm_mul_ps(_mm_set1_ps(m[1][1]), *y)), _mm_set1_ps(m[1][2]));
+
+    __m128 behind  = _mm_cmple_ps(w, _mm_setzero_ps());
+    __m128 outside = _mm_set1_ps(2.0f);
+    __m128 invW    = _mm_div_ps(_mm_set1_ps(1.0f), w);
+    *x = _mm_or_ps(_mm_andnot_ps(behind, _mm_mul_ps(wx, invW)), _mm_and_ps(behind, outside));
+    *y = _mm_or_ps(_mm_andnot_ps(behind, _mm_mul_ps(wy, invW)), _mm_and_ps(behind, outside));
+}
+
+#endif // OVR_SOFTWAREDISTORTION_SSE2
+
+
+//-----------------------------------------------------------------------------------
+// ***** SoftwareDistortionRenderer
+
+SoftwareDistortionRenderer::SoftwareDistortionRenderer(int threadCount)
+    : RedScale(1.0f), BlueScale(1.0f), ClearColor(0, 0, 0),
+      NextTile(0), JobGeneration(0), ActiveWorkers(0), RunningWorkers(0), Exiting(false)
+{
+    memset(&Job, 0, sizeof(Job));
+
+    if (threadCount <= 0)
+        threadCount = Thread::GetCPUCount();
+
+    Mutex::Locker lock(&JobLock);
+    for (int i = 1; i < threadCount; i++)
+    {
+        Ptr<Thread> worker = *new Thread(workerThreadFn, this);
+        if (!worker->Start())
+            break;
+        Workers.PushBack(worker);
+        RunningWorkers++;
+    }
+}
+
+SoftwareDistortionRenderer::~SoftwareDistortionRenderer()
+{
+    // Workers reference this object, so wait for all of them to leave workerRun.
+    Mutex::Locker lock(&JobLock);
+    Exiting = true;
+    JobStart.NotifyAll();
+    while (RunningWorkers > 0)
+        JobDone.Wait(&JobLock);
+}
+
+void SoftwareDistortionRenderer::SetChromaticAberration(float redScale, float blueScale)
+{
+    RedScale  = redScale;
+    BlueScale = blueScale;
+}
+
+void SoftwareDistortionRenderer::SetTimewarpMatrix(const Matrix4f& timewarp)
+{
+    TimewarpMatrix = timewarp;
+}
+
+void SoftwareDistortionRenderer::Render(const DistortionImage& scene, const DistortionImage& output,
+                                        const StereoEyeParams& eye)
+{
+    const Viewport& vp = eye.VP;
+
+    Job.pScene  = &scene;
+    Job.pOutput = &output;
+    Job.OutX0   = Alg::Max(vp.x, 0);
+    Job.OutY0   = Alg::Max(vp.y, 0);
+    Job.OutX1   = Alg::Min(vp.x + vp.w, output.Width);
+    Job.OutY1   = Alg::Min(vp.y + vp.h, output.Height);
+    if ((Job.OutX0 >= Job.OutX1) || (Job.OutY0 >= Job.OutY1) || !scene.Width || !scene.Height)
+        return;
+
+    // Output pixel centers map to [-1,1] across the viewport, with +Y up.
+    Job.NdcScaleX  = 2.0f / vp.w;
+    Job.NdcOffsetX = (0.5f - vp.x) * Job.NdcScaleX - 1.0f;
+    Job.NdcScaleY  = -2.0f / vp.h;
+    Job.NdcOffsetY = 1.0f - (0.5f - vp.y) * 2.0f / vp.h;
+    Job.Aspect     = float(vp.w) / float(vp.h);
+
+    if (eye.pDistortion)
+    {
+        const DistortionConfig& distortion = *eye.pDistortion;
+        Job.XCenterOffset = (eye.Eye == StereoEye_Right) ? -distortion.XCenterOffset : distortion.XCenterOffset;
+        Job.InvScale      = 1.0f / distortion.Scale;
+        for (int i = 0; i < 4; i++)
+            Job.K[i] = distortion.K[i];
+    }
+    else
+    {
+        Job.XCenterOffset = 0.0f;
+        Job.InvScale      = 1.0f;
+        Job.K[0]          = 1.0f;
+        Job.K[1] = Job.K[2] = Job.K[3] = 0.0f;
+    }
+
+    // Points are reprojected as (x, y, 0, 1), so the z row and column don't matter.
+    static const int timewarpIndex[3] = { 0, 1, 3 };
+    Job.Timewarp = false;
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++)
+        {
+            float value = TimewarpMatrix.M[timewarpIndex[row]][timewarpIndex[col]];
+            Job.TimewarpM[row][col] = value;
+            if (value != ((row == col) ? 1.0f : 0.0f))
+                Job.Timewarp = true;
+        }
+    }
+
+    // The eye's part of the scene, which can be larger than the output.
+    float sceneScaleX = float(scene.Width) / float(output.Width);
+    float sceneScaleY = float(scene.Height) / float(output.Height);
+    Job.SrcX     = Alg::Clamp((int)(vp.x * sceneScaleX + 0.5f), 0, scene.Width - 1);
+    Job.SrcY     = Alg::Clamp((int)(vp.y * sceneScaleY + 0.5f), 0, scene.Height - 1);
+    Job.SrcW     = Alg::Clamp((int)(vp.w * sceneScaleX + 0.5f), 1, scene.Width - Job.SrcX);
+    Job.SrcH     = Alg::Clamp((int)(vp.h * sceneScaleY + 0.5f), 1, scene.Height - Job.SrcY);
+    Job.SrcHalfW = Job.SrcW * 0.5f;
+    Job.SrcHalfH = Job.SrcH * 0.5f;
+
+    Job.Chromatic = (RedScale != 1.0f) || (BlueScale != 1.0f);
+    Job.RedScale  = RedScale;
+    Job.BlueScale = BlueScale;
+    ClearColor.GetRGBA(&Job.ClearValue[0], &Job.ClearValue[1], &Job.ClearValue[2], &Job.ClearValue[3]);
+    for (int i = 0; i < 4; i++)
+        Job.ClearValue[i] *= 255.0f;
+
+    Job.TileCount = (Job.OutY1 - Job.OutY0 + TileRows - 1) / TileRows;
+    NextTile      = 0;
+
+    if (Workers.GetSize() == 0)
+    {
+        renderTiles();
+        return;
+    }
+
+    {
+        Mutex::Locker lock(&JobLock);
+        ActiveWorkers = (int)Workers.GetSize();
+        JobGeneration++;
+        JobStart.NotifyAll();
+    }
+
+    renderTiles();
+
+    Mutex::Locker lock(&JobLock);
+    while (ActiveWorkers > 0)
+        JobDone.Wait(&JobLock);
+}
+
+void SoftwareDistortionRenderer::renderTiles()
+{
+    for (;;)
+    {
+        int tile = NextTile++;
+        if (tile >= Job.TileCount)
+            break;
+
+        int y0 = Job.OutY0 + tile * TileRows;
+        int y1 = Alg::Min(y0 + TileRows, Job.OutY1);
+        for (int y = y0; y < y1; y++)
+            renderRow(y);
+    }
+}
+
+// Samples the scene at a distorted offset (tx, ty) from the lens center, scaled by
+// 'scale' for chromatic aberration; returns the clear color outside of the eye image.
+void SoftwareDistortionRenderer::sampleScalar(const EyeJob& job,
+                                              float tx, float ty, float scale, float result[4])
+{
+    float sx = job.XCenterOffset + tx * scale;
+    float sy = ty * scale;
+
+    if (job.Timewarp)
+    {
+        const float (*m)[3] = job.TimewarpM;
+        float w  = m[2][0] * sx + m[2][1] * sy + m[2][2];
+        float wx = m[0][0] * sx + m[0][1] * sy + m[0][2];
+        float wy = m[1][0] * sx + m[1][1] * sy + m[1][2];
+        // Points behind the render pose's view can't be reprojected.
+        if (w <= 0.0f)
+        {
+            wx = wy = 2.0f;
+            w  = 1.0f;
+        }
+        sx = wx / w;
+        sy = wy / w;
+    }
+
+    if ((fabs(sx) > 1.0f) || (fabs(sy) > 1.0f))
+    {
+        for (int i = 0; i < 4; i++)
+            result[i] = job.ClearValue[i];
+        return;
+    }
+
+    BilinearTaps taps;
+    computeTaps(*job.pScene, job.SrcX, job.SrcY, job.SrcW, job.SrcH,
+                (sx + 1.0f) * job.SrcHalfW - 0.5f, (1.0f - sy) * job.SrcHalfH - 0.5f, &taps);
+    sampleBilinear(taps, result);
+}
+
+void SoftwareDistortionRenderer::renderRow(int y)
+{
+    // This mirrors DistortionMesh::Generate, evaluated for every pixel:
+    //   theta  = (ndc.x - XCenterOffset, ndc.y / aspect)
+    //   t      = theta * (K0 + K1*r^2 + K2*r^4 + K3*r^6) / Scale,  r = |theta|
+    //   source = (XCenterOffset + t.x, t.y * aspect)
+    const EyeJob& job    = Job;
+    UByte*        dest   = job.pOutput->pData + y * job.pOutput->Pitch + job.OutX0 * 4;
+    float         ndcY   = y * job.NdcScaleY + job.NdcOffsetY;
+    float         thetaY = ndcY / job.Aspect;
+    int           x      = job.OutX0;
+
+#if defined(OVR_SOFTWAREDISTORTION_SSE2)
+    const __m128 ndcScaleX  = _mm_set1_ps(job.NdcScaleX);
+    const __m128 ndcOffsetX = _mm_set1_ps(job.NdcOffsetX - job.XCenterOffset);
+    const __m128 thetaYSq   = _mm_set1_ps(thetaY * thetaY);
+    const __m128 ndcY4      = _mm_set1_ps(ndcY);
+    const __m128 k0         = _mm_set1_ps(job.K[0] * job.InvScale);
+    const __m128 k1         = _mm_set1_ps(job.K[1] * job.InvScale);
+    const __m128 k2         = _mm_set1_ps(job.K[2] * job.InvScale);
+    const __m128 k3         = _mm_set1_ps(job.K[3] * job.InvScale);
+    const __m128 lanes      = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 signMask   = _mm_set1_ps(-0.0f);
+    const __m128 one        = _mm_set1_ps(1.0f);
+    const __m128 xCenter    = _mm_set1_ps(job.XCenterOffset);
+    const __m128 halfW      = _mm_set1_ps(job.SrcHalfW);
+    const __m128 halfH      = _mm_set1_ps(job.SrcHalfH);
+    const __m128 uOffset    = _mm_set1_ps(job.SrcHalfW + 0.5f);
+    const __m128 vOffset    = _mm_set1_ps(job.SrcHalfH + 0.5f);
+    const __m128 zero       = _mm_setzero_ps();
+    const __m128 uLimit     = _mm_set1_ps(float(job.SrcW + 1));
+    const __m128 vLimit     = _mm_set1_ps(float(job.SrcH + 1));
+    const __m128 srcMaxX    = _mm_set1_ps(float(job.SrcW));
+    const __m128 srcMaxY    = _mm_set1_ps(float(job.SrcH));
+    // Remove the one pixel offset while adding the rectangle origin.
+    const __m128i srcX      = _mm_set1_epi32(job.SrcX - 1);
+    const __m128i srcY      = _mm_set1_epi32(job.SrcY - 1);
+    const __m128 clearColor = _mm_loadu_ps(job.ClearValue);
+    const __m128 redMask    = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, 0, 0));
+    const __m128 greenMask  = _mm_castsi128_ps(_mm_setr_epi32(0, -1, 0, -1));
+    const __m128 blueMask   = _mm_castsi128_ps(_mm_setr_epi32(0, 0, -1, 0));
+
+    const int    channelCount     = job.Chromatic ? 3 : 1;
+    const float  channelScales[3] = { 1.0f, job.RedScale, job.BlueScale };
+
+    for (; x + 4 <= job.OutX1; x += 4, dest += 16)
+    {
+        __m128 thetaX = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps(float(x)), lanes), ndcScaleX), ndcOffsetX);
+        __m128 rsq    = _mm_add_ps(_mm_mul_ps(thetaX, thetaX), thetaYSq);
+        __m128 k      = _mm_add_ps(k0, _mm_mul_ps(rsq, _mm_add_ps(k1, _mm_mul_ps(rsq,
+                                   _mm_add_ps(k2, _mm_mul_ps(rsq, k3))))));
+        __m128 tx     = _mm_mul_ps(thetaX, k);
+        __m128 ty     = _mm_mul_ps(ndcY4, k);
+
+        // Bilinear taps for green, then red and blue if chromatic. Coordinates are
+        // offset by one pixel, so that truncation equals floor for every valid sample.
+        int    validMask[3];
+        int    tapX0[3][4], tapX1[3][4], tapY0[3][4], tapY1[3][4];
+        float  fracX[3][4], fracY[3][4];
+
+        for (int c = 0; c < channelCount; c++)
+        {
+            __m128 scale = _mm_set1_ps(channelScales[c]);
+            __m128 sx    = _mm_add_ps(xCenter, _mm_mul_ps(tx, scale));
+            __m128 sy    = _mm_mul_ps(ty, scale);
+            if (job.Timewarp)
+                reprojectSSE(job.TimewarpM, &sx, &sy);
+            __m128 valid = _mm_and_ps(_mm_cmple_ps(_mm_andnot_ps(signMask, sx), one),
+                                      _mm_cmple_ps(_mm_andnot_ps(signMask, sy), one));
+            validMask[c] = _mm_movemask_ps(valid);
+
+            __m128 u      = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(sx, halfW), uOffset), zero), uLimit);
+            __m128 v      = _mm_min_ps(_mm_max_ps(_mm_sub_ps(vOffset, _mm_mul_ps(sy, halfH)), zero), vLimit);
+            __m128 uFloor = _mm_cvtepi32_ps(_mm_cvttps_epi32(u));
+            __m128 vFloor = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+            _mm_storeu_ps(fracX[c], _mm_sub_ps(u, uFloor));
+            _mm_storeu_ps(fracY[c], _mm_sub_ps(v, vFloor));
+
+            // Taps are clamped to the eye's rectangle, [1, SrcW] with the offset.
+            __m128 x0 = _mm_min_ps(_mm_max_ps(uFloor, one), srcMaxX);
+            __m128 x1 = _mm_min_ps(_mm_max_ps(_mm_add_ps(uFloor, one), one), srcMaxX);
+            __m128 y0 = _mm_min_ps(_mm_max_ps(vFloor, one), srcMaxY);
+            __m128 y1 = _mm_min_ps(_mm_max_ps(_mm_add_ps(vFloor, one), one), srcMaxY);
+            _mm_storeu_si128((__m128i*)tapX0[c], _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(x0), srcX), 2));
+            _mm_storeu_si128((__m128i*)tapX1[c], _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(x1), srcX), 2));
+            _mm_storeu_si128((__m128i*)tapY0[c], _mm_add_epi32(_mm_cvttps_epi32(y0), srcY));
+            _mm_storeu_si128((__m128i*)tapY1[c], _mm_add_epi32(_mm_cvttps_epi32(y1), srcY));
+        }
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            __m128 samples[3];
+            for (int c = 0; c < channelCount; c++)
+            {
+                if (validMask[c] & (1 << lane))
+                {
+                    BilinearTaps taps;
+                    taps.pRow0 = job.pScene->pData + tapY0[c][lane] * job.pScene->Pitch;
+                    taps.pRow1 = job.pScene->pData + tapY1[c][lane] * job.pScene->Pitch;
+                    taps.X0    = tapX0[c][lane];
+                    taps.X1    = tapX1[c][lane];
+                    taps.FracX = fracX[c][lane];
+                    taps.FracY = fracY[c][lane];
+                    samples[c] = sampleBilinearSSE(taps);
+                }
+                else
+                {
+                    samples[c] = clearColor;
+                }
+            }
+
+            __m128 color = samples[0];
+            if (job.Chromatic)
+            {
+                color = _mm_or_ps(_mm_or_ps(_mm_and_ps(redMask, samples[1]),
+                                            _mm_and_ps(greenMask, samples[0])),
+                                  _mm_and_ps(blueMask, samples[2]));
+            }
+            storePixelSSE(dest + lane * 4, color);
+        }
+    }
+#endif // OVR_SOFTWAREDISTORTION_SSE2
+
+    for (; x < job.OutX1; x++, dest += 4)
+    {
+        float thetaX = x * job.NdcScaleX + job.NdcOffsetX - job.XCenterOffset;
+        float rsq    = thetaX * thetaX + thetaY * thetaY;
+        float k      = (job.K[0] + rsq * (job.K[1] + rsq * (job.K[2] + rsq * job.K[3]))) * job.InvScale;
+        float tx     = thetaX * k;
+        float ty     = ndcY * k;
+
+        float color[4];
+        sampleScalar(job, tx, ty, 1.0f, color);
+        if (job.Chromatic)
+        {
+            float red[4], blue[4];
+            sampleScalar(job, tx, ty, job.RedScale, red);
+            sampleScalar(job, tx, ty, job.BlueScale, blue);
+            color[0] = red[0];
+            color[2] = blue[2];
+        }
+
+        for (int i = 0; i < 4; i++)
+            dest[i] = (UByte)Alg::Clamp((int)(color[i] + 0.5f), 0, 255);
+    }
+}
+
+int SoftwareDistortionRenderer::workerThreadFn(Thread* thread, void* handle)
+{
+    OVR_UNUSED(thread);
+    return ((SoftwareDistortionRenderer*)handle)->workerRun();
+}
+
+int SoftwareDistortionRenderer::workerRun()
+{
+    UInt32 generation = 0;
+
+    for (;;)
+    {
+        {
+            Mutex::Locker lock(&JobLock);
+            while ((JobGeneration == generation) && !Exiting)
+                JobStart.Wait(&JobLock);
+
+            if (Exiting)
+            {
+                RunningWorkers--;
+                JobDone.NotifyAll();
+                return 0;
+            }
+            generation = JobGeneration;
+        }
+
+        renderTiles();
+
+        Mutex::Locker lock(&JobLock);
+        if (--ActiveWorkers == 0)
+            JobDone.NotifyAll();
+    }
+}
+
+
+}}}  // OVR::Util::Render
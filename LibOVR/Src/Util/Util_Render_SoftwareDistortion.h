@@ -0,0 +1,142 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   Util_Render_SoftwareDistortion.h
+Content     :   CPU implementation of the lens distortion post-process.
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_Render_SoftwareDistortion_h
+#define OVR_Util_Render_SoftwareDistortion_h
+
+#include "Util_Render_Stereo.h"
+#include "../Kernel/OVR_Color.h"
+#include "../Kernel/OVR_Threads.h"
+
+namespace OVR { namespace Util { namespace Render {
+
+
+//-----------------------------------------------------------------------------------
+// ***** DistortionImage
+
+// DistortionImage describes an 8-bit per channel RGBA image in memory, with rows
+// stored top to bottom Pitch bytes apart.
+struct DistortionImage
+{
+    UByte*  pData;
+    int     Width, Height;
+    int     Pitch;
+
+    DistortionImage() : pData(0), Width(0), Height(0), Pitch(0) { }
+    DistortionImage(UByte* data, int width, int height, int pitch = 0)
+        : pData(data), Width(width), Height(height), Pitch(pitch ? pitch : width * 4) { }
+};
+
+
+//-----------------------------------------------------------------------------------
+// ***** SoftwareDistortionRenderer
+
+// SoftwareDistortionRenderer performs the PostProcess_Distortion pass on the CPU,
+// matching the distortion shader of the sample renderer: each output pixel of the
+// eye viewport is mapped through the distortion function and the scene image is
+// sampled there bilinearly, with pixels that map outside of the eye's part of the
+// scene set to the clear color. It serves as a reference for shader output and for
+// producing distorted screenshots without a GPU.
+//
+// Rows are split into tiles that are processed by a pool of worker threads together
+// with the calling thread; pixels are processed four at a time with SSE2 when it
+// is available.
+
+class SoftwareDistortionRenderer
+{
+public:
+    // A threadCount of 0 uses one thread per CPU; 1 renders on the calling thread only.
+    SoftwareDistortionRenderer(int threadCount = 0);
+    ~SoftwareDistortionRenderer();
+
+    // Chromatic aberration correction scales the distorted sample offset from the
+    // lens center for the red and blue channels, relative to green. The default
+    // of 1.0 for both disables it, so that each pixel is sampled only once.
+    void    SetChromaticAberration(float redScale, float blueScale);
+
+    // Sets the color of output pixels that fall outside of the scene image.
+    void    SetClearColor(const Color& clearColor) { ClearColor = clearColor; }
+
+    // Reprojects distorted sample locations with a matrix from
+    // StereoEyeParams::CalculateTimewarpMatrix, as the timewarp shader does.
+    // It applies to following Render calls; identity disables it.
+    void    SetTimewarpMatrix(const Matrix4f& timewarp);
+
+    // Distorts one eye: renders the eye.VP part of 'output' from the matching part of
+    // 'scene'. The scene image covers the same area as the output image, but may be
+    // larger than it by the scene render scale. Eyes without distortion are scaled.
+    void    Render(const DistortionImage& scene, const DistortionImage& output,
+                   const StereoEyeParams& eye);
+
+    int     GetThreadCount() const { return (int)Workers.GetSize() + 1; }
+
+private:
+    // Parameters of the eye being rendered, shared by all threads.
+    struct EyeJob
+    {
+        const DistortionImage* pScene;
+        const DistortionImage* pOutput;
+
+        int     OutX0, OutY0, OutX1, OutY1;  // Output pixel rectangle, exclusive max.
+        float   NdcScaleX, NdcOffsetX;       // Output pixel center to [-1,1] viewport units.
+        float   NdcScaleY, NdcOffsetY;
+        float   XCenterOffset;
+        float   K[4];
+        float   InvScale;
+        float   Aspect;
+        bool    Timewarp;
+        float   TimewarpM[3][3];             // Rows x, y, w; columns x, y, 1.
+        int     SrcX, SrcY, SrcW, SrcH;      // Scene pixel rectangle of the eye.
+        float   SrcHalfW, SrcHalfH;
+        bool    Chromatic;
+        float   RedScale, BlueScale;
+        float   ClearValue[4];               // Clear color in [0,255] range.
+        int     TileCount;
+    };
+
+    enum { TileRows = 16 };
+
+    void    renderTiles();
+    void    renderRow(int y);
+
+    static void sampleScalar(const EyeJob& job, float tx, float ty, float scale, float result[4]);
+
+    static int workerThreadFn(Thread* thread, void* handle);
+    int     workerRun();
+
+    float       RedScale, BlueScale;
+    Color       ClearColor;
+    Matrix4f    TimewarpMatrix;
+
+    EyeJob      Job;
+    AtomicInt<int> NextTile;
+
+    // Workers sleep on JobStart until JobGeneration changes; ActiveWorkers
+    // counts those that still work on the current job.
+    Array<Ptr<Thread> > Workers;
+    Mutex           JobLock;
+    WaitCondition   JobStart;
+    WaitCondition   JobDone;
+    UInt32          JobGeneration;
+    int             ActiveWorkers;
+    int             RunningWorkers;
+    bool            Exiting;
+};
+
+
+}}}  // OVR::Util::Render
+
+#endif // OVR_Util_Render_SoftwareDistortion_h
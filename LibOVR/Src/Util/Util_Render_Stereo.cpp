@@ -14,17 +14,184 @@ otherwise accompanies this software in either electronic or hard copy form.
 *************************************************************************************/
 
 #include "Util_Render_Stereo.h"
+#include "../Kernel/OVR_Alg.h"
+
+#if defined(OVR_CPU_SSE)
+#include <xmmintrin.h>
+#elif defined(OVR_CPU_ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace OVR { namespace Util { namespace Render {
 
 
 //-----------------------------------------------------------------------------------
 
+// Range of r covered by the DistortionFnInverse lookup table.
+static const float DistortionInverseTableMaxR = 10.0f;
+// Newton iterations applied to the interpolated table value; the interpolation is
+// already within ~1e-3, so two iterations reach float precision.
+static const int   DistortionInverseNewtonIterations = 2;
+
 // DistortionFnInverse computes the inverse of the distortion function on an argument.
 float DistortionConfig::DistortionFnInverse(float r)
 {    
     OVR_ASSERT((r <= 10.0f));
 
+    if (!updateInverseTable())
+        return distortionFnInverseSearch(r);
+
+    const float tableStep = DistortionInverseTableMaxR / (InverseTableSize - 1);
+    float       position  = r * (1.0f / tableStep);
+    int         index     = Alg::Clamp(int(position), 0, InverseTableSize - 2);
+    float       fraction  = position - float(index);
+    float       s         = InverseTable[index] + (InverseTable[index + 1] - InverseTable[index]) * fraction;
+
+    for (int i = 0; i < DistortionInverseNewtonIterations; i++)
+        s -= (DistortionFn(s) - r) / DistortionFnDerivative(s);
+    return s;
+}
+
+void DistortionConfig::DistortionFnInverseBatch(const float* in, float* out, UPInt count)
+{
+    if (!updateInverseTable())
+    {
+        for (UPInt i = 0; i < count; i++)
+            out[i] = distortionFnInverseSearch(in[i]);
+        return;
+    }
+
+    UPInt i = 0;
+
+#if defined(OVR_CPU_SSE)
+    const float tableStep = DistortionInverseTableMaxR / (InverseTableSize - 1);
+    const __m128 invStep  = _mm_set1_ps(1.0f / tableStep);
+    const __m128 maxIndex = _mm_set1_ps(float(InverseTableSize - 2));
+    const __m128 k0       = _mm_set1_ps(K[0]);
+    const __m128 k1       = _mm_set1_ps(K[1]);
+    const __m128 k2       = _mm_set1_ps(K[2]);
+    const __m128 k3       = _mm_set1_ps(K[3]);
+    const __m128 dk1      = _mm_set1_ps(3.0f * K[1]);
+    const __m128 dk2      = _mm_set1_ps(5.0f * K[2]);
+    const __m128 dk3      = _mm_set1_ps(7.0f * K[3]);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 r        = _mm_loadu_ps(in + i);
+        __m128 position = _mm_mul_ps(r, invStep);
+        __m128 indexF   = _mm_min_ps(_mm_max_ps(position, _mm_setzero_ps()), maxIndex);
+
+        // Table lookups are scalar; truncation of the clamped position gives the index.
+        float clamped[4];
+        _mm_storeu_ps(clamped, indexF);
+        int    indices[4] = { int(clamped[0]), int(clamped[1]), int(clamped[2]), int(clamped[3]) };
+        __m128 fraction   = _mm_sub_ps(position, _mm_setr_ps(float(indices[0]), float(indices[1]),
+                                                             float(indices[2]), float(indices[3])));
+        __m128 s0 = _mm_setr_ps(InverseTable[indices[0]],     InverseTable[indices[1]],
+                                InverseTable[indices[2]],     InverseTable[indices[3]]);
+        __m128 s1 = _mm_setr_ps(InverseTable[indices[0] + 1], InverseTable[indices[1] + 1],
+                                InverseTable[indices[2] + 1], InverseTable[indices[3] + 1]);
+        __m128 s  = _mm_add_ps(s0, _mm_mul_ps(_mm_sub_ps(s1, s0), fraction));
+
+        for (int j = 0; j < DistortionInverseNewtonIterations; j++)
+        {
+            __m128 ssq = _mm_mul_ps(s, s);
+            __m128 fn  = _mm_mul_ps(s, _mm_add_ps(k0, _mm_mul_ps(ssq,
+                                       _mm_add_ps(k1, _mm_mul_ps(ssq,
+                                       _mm_add_ps(k2, _mm_mul_ps(ssq, k3)))))));
+            __m128 dfn = _mm_add_ps(k0, _mm_mul_ps(ssq,
+                                    _mm_add_ps(dk1, _mm_mul_ps(ssq,
+                                    _mm_add_ps(dk2, _mm_mul_ps(ssq, dk3))))));
+            s = _mm_sub_ps(s, _mm_div_ps(_mm_sub_ps(fn, r), dfn));
+        }
+
+        _mm_storeu_ps(out + i, s);
+    }
+
+#elif defined(OVR_CPU_ARM_NEON)
+    const float       tableStep = DistortionInverseTableMaxR / (InverseTableSize - 1);
+    const float32x4_t invStep   = vdupq_n_f32(1.0f / tableStep);
+    const float32x4_t maxIndex  = vdupq_n_f32(float(InverseTableSize - 2));
+    const float32x4_t k0        = vdupq_n_f32(K[0]);
+    const float32x4_t k1        = vdupq_n_f32(K[1]);
+    const float32x4_t k2        = vdupq_n_f32(K[2]);
+    const float32x4_t k3        = vdupq_n_f32(K[3]);
+    const float32x4_t dk1       = vdupq_n_f32(3.0f * K[1]);
+    const float32x4_t dk2       = vdupq_n_f32(5.0f * K[2]);
+    const float32x4_t dk3       = vdupq_n_f32(7.0f * K[3]);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t r        = vld1q_f32(in + i);
+        float32x4_t position = vmulq_f32(r, invStep);
+        float32x4_t indexF   = vminq_f32(vmaxq_f32(position, vdupq_n_f32(0.0f)), maxIndex);
+        int32x4_t   index    = vcvtq_s32_f32(indexF);
+        float32x4_t fraction = vsubq_f32(position, vcvtq_f32_s32(index));
+
+        int indices[4];
+        vst1q_s32(indices, index);
+        float lo[4], hi[4];
+        for (int j = 0; j < 4; j++)
+        {
+            lo[j] = InverseTable[indices[j]];
+            hi[j] = InverseTable[indices[j] + 1];
+        }
+        float32x4_t s0 = vld1q_f32(lo);
+        float32x4_t s  = vmlaq_f32(s0, vsubq_f32(vld1q_f32(hi), s0), fraction);
+
+        for (int j = 0; j < DistortionInverseNewtonIterations; j++)
+        {
+            float32x4_t ssq = vmulq_f32(s, s);
+            float32x4_t fn  = vmulq_f32(s, vmlaq_f32(k0, ssq, vmlaq_f32(k1, ssq, vmlaq_f32(k2, ssq, k3))));
+            float32x4_t dfn = vmlaq_f32(k0, ssq, vmlaq_f32(dk1, ssq, vmlaq_f32(dk2, ssq, dk3)));
+            // NEON has no divide; refine the reciprocal estimate twice.
+            float32x4_t rcp = vrecpeq_f32(dfn);
+            rcp = vmulq_f32(rcp, vrecpsq_f32(dfn, rcp));
+            rcp = vmulq_f32(rcp, vrecpsq_f32(dfn, rcp));
+            s   = vmlsq_f32(s, vsubq_f32(fn, r), rcp);
+        }
+
+        vst1q_f32(out + i, s);
+    }
+#endif
+
+    for (; i < count; i++)
+        out[i] = DistortionFnInverse(in[i]);
+}
+
+bool DistortionConfig::updateInverseTable()
+{
+    if ((InverseTableState != InverseTable_Stale) &&
+        (InverseTableK[0] == K[0]) && (InverseTableK[1] == K[1]) &&
+        (InverseTableK[2] == K[2]) && (InverseTableK[3] == K[3]))
+    {
+        return InverseTableState == InverseTable_Valid;
+    }
+
+    for (int i = 0; i < 4; i++)
+        InverseTableK[i] = K[i];
+
+    // Newton iterations are only safe if DistortionFn is strictly increasing over
+    // the covered range; otherwise keep using the search.
+    const float tableStep = DistortionInverseTableMaxR / (InverseTableSize - 1);
+    InverseTableState = InverseTable_Valid;
+
+    for (int i = 0; i < InverseTableSize; i++)
+    {
+        InverseTable[i] = distortionFnInverseSearch(i * tableStep);
+
+        if ((DistortionFnDerivative(InverseTable[i]) <= 0.0f) ||
+            ((i > 0) && (InverseTable[i] <= InverseTable[i - 1])))
+        {
+            InverseTableState = InverseTable_NotMonotonic;
+            return false;
+        }
+    }
+    return true;
+}
+
+float DistortionConfig::distortionFnInverseSearch(float r) const
+{
     float s, d;
     float delta = r * 0.25f;
 
@@ -58,15 +225,137 @@ float DistortionConfig::DistortionFnInverse(float r)
 }
 
 
+//-----------------------------------------------------------------------------------
+// **** DistortionMesh Implementation
+
+void DistortionMesh::Generate(const DistortionConfig& distortion, StereoEye eye, float aspect,
+                              int gridWidth, int gridHeight)
+{
+    OVR_ASSERT((gridWidth > 0) && (gridHeight > 0));
+    OVR_ASSERT((gridWidth + 1) * (gridHeight + 1) <= 65536);
+
+    // The mesh reproduces the distortion post-process shader, in eye viewport units.
+    // For an output point p, with the lens center at (XCenterOffset, 0):
+    //   theta  = (p.x - XCenterOffset, p.y / aspect)
+    //   theta1 = theta * (K0 + K1*r^2 + K2*r^4 + K3*r^6),  r = |theta|
+    //   source = (XCenterOffset + theta1.x / Scale, theta1.y * aspect / Scale)
+    float xCenterOffset = (eye == StereoEye_Right) ? -distortion.XCenterOffset : distortion.XCenterOffset;
+    float invScale      = 1.0f / distortion.Scale;
+    float invAspect     = 1.0f / aspect;
+    int   stride        = gridWidth + 1;
+
+    GridWidth  = gridWidth;
+    GridHeight = gridHeight;
+    Vertices.Resize(stride * (gridHeight + 1));
+    Indices.Resize(gridWidth * gridHeight * 6);
+
+    for (int y = 0; y <= gridHeight; y++)
+    {
+        float screenY = 1.0f - 2.0f * float(y) / float(gridHeight);
+
+        for (int x = 0; x <= gridWidth; x++)
+        {
+            DistortionMeshVertex& v = Vertices[y * stride + x];
+
+            v.ScreenPosX = 2.0f * float(x) / float(gridWidth) - 1.0f;
+            v.ScreenPosY = screenY;
+
+            float thetaX   = v.ScreenPosX - xCenterOffset;
+            float thetaY   = v.ScreenPosY * invAspect;
+            float r        = sqrt(thetaX * thetaX + thetaY * thetaY);
+            // DistortionFn(r)/r is the radial scale; at the center it tends to K[0].
+            float rScale   = (r > 0.0f) ? (distortion.DistortionFn(r) / r) : distortion.K[0];
+            float sourceX  = xCenterOffset + thetaX * rScale * invScale;
+            float sourceY  = thetaY * rScale * aspect * invScale;
+
+            v.Shade = ((fabs(sourceX) <= 1.0f) && (fabs(sourceY) <= 1.0f)) ? 1.0f : 0.0f;
+            v.TexU  = Alg::Clamp(0.5f * (sourceX + 1.0f), 0.0f, 1.0f);
+            v.TexV  = Alg::Clamp(0.5f * (1.0f - sourceY), 0.0f, 1.0f);
+        }
+    }
+
+    UInt16* index = &Indices[0];
+    for (int y = 0; y < gridHeight; y++)
+    {
+        for (int x = 0; x < gridWidth; x++)
+        {
+            UInt16 topLeft = UInt16(y * stride + x);
+
+            // Split cells along alternating diagonals so the triangulation stays
+            // symmetric around the lens center.
+            if ((x < gridWidth / 2) == (y < gridHeight / 2))
+            {
+                index[0] = topLeft;
+                index[1] = UInt16(topLeft + 1);
+                index[2] = UInt16(topLeft + stride + 1);
+                index[3] = topLeft;
+                index[4] = UInt16(topLeft + stride + 1);
+                index[5] = UInt16(topLeft + stride);
+            }
+            else
+            {
+                index[0] = topLeft;
+                index[1] = UInt16(topLeft + 1);
+                index[2] = UInt16(topLeft + stride);
+                index[3] = UInt16(topLeft + 1);
+                index[4] = UInt16(topLeft + stride + 1);
+                index[5] = UInt16(topLeft + stride);
+            }
+            index += 6;
+        }
+    }
+
+    Version++;
+}
+
+void DistortionMesh::Clear()
+{
+    if (IsEmpty())
+        return;
+
+    Vertices.Clear();
+    Indices.Clear();
+    GridWidth  = 0;
+    GridHeight = 0;
+    Version++;
+}
+
+
+//-----------------------------------------------------------------------------------
+// **** StereoEyeParams Implementation
+
+Matrix4f StereoEyeParams::CalculateTimewarpMatrix(const Quatf& renderOrientation,
+                                                  const Quatf& displayOrientation) const
+{
+    // Rotates view directions of the display pose into view space of the render pose.
+    Matrix4f delta = renderOrientation.Inverted() * displayOrientation;
+
+    // Directions have w = 0, so the projection of a direction to homogeneous viewport
+    // coordinates (x, y, w) only uses the upper left 3 columns of the x, y and w rows.
+    const Matrix4f& p = Projection;
+    Matrix4f project(p.M[0][0], p.M[0][1], p.M[0][2],
+                     p.M[1][0], p.M[1][1], p.M[1][2],
+                     p.M[3][0], p.M[3][1], p.M[3][2]);
+
+    Matrix4f h = project * delta * project.Inverted();
+
+    // Points are passed as (x, y, 0, 1), so move the homogeneous coordinate to w.
+    return Matrix4f(h.M[0][0], h.M[0][1], 0, h.M[0][2],
+                    h.M[1][0], h.M[1][1], 0, h.M[1][2],
+                    0,         0,         1, 0,
+                    h.M[2][0], h.M[2][1], 0, h.M[2][2]);
+}
+
+
 //-----------------------------------------------------------------------------------
 // **** StereoConfig Implementation
 
 StereoConfig::StereoConfig(StereoMode mode, const Viewport& vp)
     : Mode(mode),
       InterpupillaryDistance(0.064f), AspectMultiplier(1.0f),
-      FullView(vp), DirtyFlag(true),
+      FullView(vp), MeshGridWidth(32), MeshGridHeight(32), DirtyFlag(true),
       YFov(0), Aspect(vp.w / float(vp.h)), ProjectionCenterOffset(0),
-      OrthoPixelOffset(0)
+      OrthoPixelOffset(0), SnapshotVersion(0)
 {
     // And default distortion for it.
     Distortion.SetCoefficients(1.0f, 0.22f, 0.24f);
@@ -93,6 +382,13 @@ StereoConfig::StereoConfig(StereoMode mode, const Viewport& vp)
     Set2DAreaFov(DegreeToRad(85.0f));
 }
 
+StereoConfig::~StereoConfig()
+{
+    StereoSnapshot* pending = PendingSnapshot.Exchange_Sync(0);
+    if (pending)
+        pending->Release();
+}
+
 void StereoConfig::SetFullViewport(const Viewport& vp)
 {
     if (vp != FullView)
@@ -132,6 +428,23 @@ void StereoConfig::Set2DAreaFov(float fovRadians)
     DirtyFlag = true;
 }
 
+void StereoConfig::SetDistortionMeshResolution(int gridWidth, int gridHeight)
+{
+    if ((gridWidth <= 0) || (gridHeight <= 0))
+    {
+        gridWidth  = 0;
+        gridHeight = 0;
+    }
+    OVR_ASSERT((gridWidth + 1) * (gridHeight + 1) <= 65536);
+
+    if ((gridWidth != MeshGridWidth) || (gridHeight != MeshGridHeight))
+    {
+        MeshGridWidth  = gridWidth;
+        MeshGridHeight = gridHeight;
+        DirtyFlag      = true;
+    }
+}
+
 
 const StereoEyeParams& StereoConfig::GetEyeRenderParams(StereoEye eye)
 {
@@ -142,6 +455,79 @@ const StereoEyeParams& StereoConfig::GetEyeRenderParams(StereoEye eye)
     return EyeRenderParams[eyeParamIndices[eye]];
 }
 
+const StereoEyeParams& StereoSnapshot::GetEyeRenderParams(StereoEye eye) const
+{
+    static const UByte eyeParamIndices[3] = { 0, 0, 1 };
+
+    OVR_ASSERT(eye < sizeof(eyeParamIndices));
+    return EyeRenderParams[eyeParamIndices[eye]];
+}
+
+const DistortionMesh& StereoSnapshot::GetDistortionMesh(StereoEye eye) const
+{
+    static const UByte eyeMeshIndices[3] = { 0, 0, 1 };
+
+    OVR_ASSERT(eye < sizeof(eyeMeshIndices));
+    return EyeDistortionMesh[eyeMeshIndices[eye]];
+}
+
+const DistortionMesh& StereoConfig::GetDistortionMesh(StereoEye eye)
+{
+    static const UByte eyeMeshIndices[3] = { 0, 0, 1 };
+
+    updateIfDirty();
+    OVR_ASSERT(eye < sizeof(eyeMeshIndices));
+    return EyeDistortionMesh[eyeMeshIndices[eye]];
+}
+
+
+Ptr<StereoSnapshot> StereoConfig::Commit()
+{
+    updateIfDirty();
+
+    Ptr<StereoSnapshot> snapshot = *new StereoSnapshot;
+    snapshot->Version                = ++SnapshotVersion;
+    snapshot->Mode                   = Mode;
+    snapshot->HMD                    = HMD;
+    snapshot->InterpupillaryDistance = InterpupillaryDistance;
+    snapshot->FullView               = FullView;
+    snapshot->Aspect                 = Aspect;
+    snapshot->YFov                   = YFov;
+    snapshot->ProjectionCenterOffset = ProjectionCenterOffset;
+    snapshot->Distortion             = Distortion;
+    snapshot->Unit2DPixel            = Get2DUnitPixel();
+    snapshot->OrthoCenter            = OrthoCenter;
+    snapshot->OrthoPixelOffset       = OrthoPixelOffset;
+
+    // Redirect eye parameters to the snapshot's own copies.
+    for (int i = 0; i < 2; i++)
+    {
+        snapshot->EyeDistortionMesh[i] = EyeDistortionMesh[i];
+        snapshot->EyeRenderParams[i]   = EyeRenderParams[i];
+        if (EyeRenderParams[i].pDistortion)
+            snapshot->EyeRenderParams[i].pDistortion = &snapshot->Distortion;
+        if (EyeRenderParams[i].pDistortionMesh)
+            snapshot->EyeRenderParams[i].pDistortionMesh = &snapshot->EyeDistortionMesh[i];
+    }
+
+    // The pending slot owns a reference; a snapshot that was replaced before
+    // the reader picked it up was never seen by it, so it can be released here.
+    snapshot->AddRef();
+    StereoSnapshot* replaced = PendingSnapshot.Exchange_Sync(snapshot);
+    if (replaced)
+        replaced->Release();
+
+    return snapshot;
+}
+
+Ptr<StereoSnapshot> StereoConfig::GetLatestSnapshot()
+{
+    StereoSnapshot* pending = PendingSnapshot.Exchange_Sync(0);
+    if (pending)
+        LatestSnapshot = *pending; // Adopts the pending reference.
+    return LatestSnapshot;
+}
+
 
 void StereoConfig::updateComputedState()
 {
@@ -151,6 +537,7 @@ void StereoConfig::updateComputedState()
     //   - Projection offsets for 3D
     //   - Distortion XCenterOffset
     //   - Update 2D
+    //   - Distortion meshes
     //   - Initialize EyeRenderParams
 
     // Compute aspect ratio. Stereo mode cuts width in half.
@@ -189,6 +576,7 @@ void StereoConfig::updateComputedState()
     
     updateProjectionOffset();
     update2D();
+    updateDistortionMeshes();
     updateEyeParams();
 
     DirtyFlag = false;
@@ -285,6 +673,21 @@ void StereoConfig::update2D()
     OrthoPixelOffset = orthoPixelOffset * 2.0f / FovPixels;
 }
 
+void StereoConfig::updateDistortionMeshes()
+{
+    if ((Mode == Stereo_None) || (MeshGridWidth == 0))
+    {
+        EyeDistortionMesh[0].Clear();
+        EyeDistortionMesh[1].Clear();
+        return;
+    }
+
+    // Both eyes get half of the full viewport.
+    float eyeAspect = 0.5f * float(FullView.w) / float(FullView.h);
+    EyeDistortionMesh[0].Generate(Distortion, StereoEye_Left,  eyeAspect, MeshGridWidth, MeshGridHeight);
+    EyeDistortionMesh[1].Generate(Distortion, StereoEye_Right, eyeAspect, MeshGridWidth, MeshGridHeight);
+}
+
 void StereoConfig::updateEyeParams()
 {
     // Projection matrix for the center eye, which the left/right matrices are based on.
@@ -307,12 +710,12 @@ void StereoConfig::updateEyeParams()
                 Viewport(FullView.x, FullView.y, FullView.w/2, FullView.h),
                          +InterpupillaryDistance * 0.5f,  // World view shift.                       
                          projLeft, OrthoCenter * Matrix4f::Translation(OrthoPixelOffset, 0, 0),
-                         &Distortion);
+                         &Distortion, EyeDistortionMesh[0].IsEmpty() ? 0 : &EyeDistortionMesh[0]);
             EyeRenderParams[1].Init(StereoEye_Right,
                 Viewport(FullView.x + FullView.w/2, FullView.y, FullView.w/2, FullView.h),
                          -InterpupillaryDistance * 0.5f,                         
                          projRight, OrthoCenter * Matrix4f::Translation(-OrthoPixelOffset, 0, 0),
-                         &Distortion);
+                         &Distortion, EyeDistortionMesh[1].IsEmpty() ? 0 : &EyeDistortionMesh[1]);
         }
         break;
     }
@@ -78,7 +78,7 @@ class DistortionConfig
 {
 public:
     DistortionConfig(float k0 = 1.0f, float k1 = 0.0f, float k2 = 0.0f, float k3 = 0.0f)
-        : XCenterOffset(0), YCenterOffset(0), Scale(1.0f)
+        : XCenterOffset(0), YCenterOffset(0), Scale(1.0f), InverseTableState(InverseTable_Stale)
     { SetCoefficients(k0, k1, k2, k3); }
 
     void SetCoefficients(float k0, float k1 = 0.0f, float k2 = 0.0f, float k3 = 0.0f)
@@ -94,16 +94,95 @@ public:
         return scale;
     }
 
+    // DistortionFnDerivative returns the slope of DistortionFn at r.
+    float  DistortionFnDerivative(float r) const
+    {
+        float rsq = r * r;
+        return K[0] + rsq * (3.0f * K[1] + rsq * (5.0f * K[2] + rsq * 7.0f * K[3]));
+    }
+
     // DistortionFnInverse computes the inverse of the distortion function on an argument.
+    // The result is interpolated from a lookup table and refined with Newton iterations;
+    // the table is rebuilt on the first call after K changes.
     float DistortionFnInverse(float r);    
 
+    // DistortionFnInverseBatch computes DistortionFnInverse for 'count' values of 'in'
+    // and stores them in 'out', four at a time where SIMD is available.
+    // 'in' and 'out' may point to the same array.
+    void  DistortionFnInverseBatch(const float* in, float* out, UPInt count);
+
     float   K[4];
     float   XCenterOffset, YCenterOffset;
     float   Scale;
+
+private:
+    enum InverseTableStateType
+    {
+        InverseTable_Stale,
+        InverseTable_Valid,
+        InverseTable_NotMonotonic   // DistortionFn can't be inverted by Newton iterations.
+    };
+    enum { InverseTableSize = 64 };
+
+    // Returns true if the lookup table can be used for the current K.
+    bool  updateInverseTable();
+    // Slow search-based inverse, used to build the table and for unusual coefficients.
+    float distortionFnInverseSearch(float r) const;
+
+    // The table samples the inverse at evenly spaced r over [0, 10], the range
+    // DistortionFnInverse supports, for coefficients InverseTableK.
+    InverseTableStateType InverseTableState;
+    float   InverseTableK[4];
+    float   InverseTable[InverseTableSize];
 };
 
 
 
+//-----------------------------------------------------------------------------------
+// ***** DistortionMesh
+
+// DistortionMeshVertex is a single vertex of the distortion mesh for one eye.
+struct DistortionMeshVertex
+{
+    // Position within the eye viewport, in [-1,1] range with +Y up.
+    float   ScreenPosX, ScreenPosY;
+    // Location in the eye's rendered (pre-distortion) image to sample, in [0,1] range
+    // with (0,0) at its top-left corner. Clamped to that range.
+    float   TexU, TexV;
+    // 1 if the sampled location lies within the rendered image, 0 if it falls outside
+    // of it and the distortion clear color should be shown instead.
+    float   Shade;
+};
+
+// DistortionMesh is a regular grid covering one eye viewport, with each vertex
+// carrying the source coordinates the distortion shader would compute for it.
+// Drawing the mesh with a plain bilinear texture lookup approximates the
+// distortion post-process, evaluating the distortion polynomial once per vertex
+// instead of once per pixel. Indices describe a triangle list.
+class DistortionMesh
+{
+public:
+    DistortionMesh() : GridWidth(0), GridHeight(0), Version(0) { }
+
+    // Builds the mesh for an eye with gridWidth x gridHeight cells. 'aspect' is the
+    // eye viewport width over height. For the right eye distortion.XCenterOffset is
+    // mirrored, so the same DistortionConfig can be passed for both eyes.
+    // The grid must fit 16-bit indices: (gridWidth+1) * (gridHeight+1) <= 65536.
+    void    Generate(const DistortionConfig& distortion, StereoEye eye, float aspect,
+                     int gridWidth, int gridHeight);
+    void    Clear();
+
+    bool    IsEmpty() const { return Indices.GetSize() == 0; }
+
+    Array<DistortionMeshVertex> Vertices;
+    Array<UInt16>               Indices;
+    int                         GridWidth, GridHeight;
+    // Incremented every time the mesh is regenerated, so that renderers
+    // can tell when their copy of it needs to be updated.
+    UInt32                      Version;
+};
+
+
 //-----------------------------------------------------------------------------------
 // ***** StereoEyeParams
 
@@ -115,6 +194,7 @@ public:
     StereoEye                Eye;
     Viewport                 VP;               // Viewport that we are rendering to        
     const DistortionConfig*  pDistortion;
+    const DistortionMesh*    pDistortionMesh;  // Null if distortion mesh generation is disabled.
 
     Matrix4f                 ViewAdjust;       // Translation to be applied to view matrix.
     Matrix4f                 Projection;       // Projection matrix used with this eye.
@@ -122,7 +202,8 @@ public:
 
     void Init(StereoEye eye, const Viewport &vp, float vofs,
               const Matrix4f& proj, const Matrix4f& orthoProj,
-              const DistortionConfig* distortion = 0)
+              const DistortionConfig* distortion = 0,
+              const DistortionMesh* distortionMesh = 0)
     {
         Eye                    = eye;
         VP                     = vp;
@@ -130,7 +211,76 @@ public:
         Projection             = proj;
         OrthoProjection        = orthoProj;
         pDistortion            = distortion;        
+        pDistortionMesh        = distortionMesh;
     }
+
+    // Returns the reprojection (timewarp) applied to distorted sample locations when
+    // the head orientation has changed from 'renderOrientation', used to render the
+    // scene, to 'displayOrientation' by the time the distortion pass runs. It maps
+    // [-1,1] viewport coordinates of the scene (+Y up) seen from the display pose to
+    // those of the rendered scene image; points are transformed as (x, y, 0, 1), and
+    // the result is divided by w. Only rotation is corrected; since Projection maps
+    // directions to the image, this is exact for an image of infinitely far content.
+    Matrix4f CalculateTimewarpMatrix(const Quatf& renderOrientation,
+                                     const Quatf& displayOrientation) const;
+};
+
+
+//-----------------------------------------------------------------------------------
+// *****  StereoSnapshot
+
+// StereoSnapshot is an immutable copy of the computed StereoConfig state, created by
+// StereoConfig::Commit. Since none of its functions modify it, a snapshot can be used
+// by any number of threads while the StereoConfig it came from keeps changing.
+// Eye parameters point to the distortion configuration and meshes of the snapshot
+// itself, so they stay valid for as long as the snapshot is referenced.
+
+class StereoSnapshot : public RefCountBase<StereoSnapshot>
+{
+    friend class StereoConfig;
+public:
+    // Incremented by every Commit of the StereoConfig this snapshot came from.
+    UInt32                  GetVersion() const                  { return Version; }
+
+    StereoMode              GetStereoMode() const               { return Mode; }
+    const HMDInfo&          GetHMDInfo() const                  { return HMD; }
+    float                   GetIPD() const                      { return InterpupillaryDistance; }
+    const Viewport&         GetFullViewport() const             { return FullView; }
+
+    float                   GetAspect() const                   { return Aspect; }
+    float                   GetYFOVRadians() const              { return YFov; }
+    float                   GetYFOVDegrees() const              { return RadToDegree(YFov); }
+    float                   GetProjectionCenterOffset() const   { return ProjectionCenterOffset; }
+
+    const DistortionConfig& GetDistortionConfig() const         { return Distortion; }
+    float                   GetDistortionScale() const          { return Distortion.Scale; }
+
+    // 2D rendering setup; the per-eye orthographic projections are part of the
+    // eye parameters.
+    float                   Get2DUnitPixel() const              { return Unit2DPixel; }
+    const Matrix4f&         GetOrthoCenter() const              { return OrthoCenter; }
+    float                   GetOrthoPixelOffset() const         { return OrthoPixelOffset; }
+
+    const StereoEyeParams&  GetEyeRenderParams(StereoEye eye) const;
+    const DistortionMesh&   GetDistortionMesh(StereoEye eye) const;
+
+private:
+    StereoSnapshot() { }
+
+    UInt32              Version;
+    StereoMode          Mode;
+    HMDInfo             HMD;
+    float               InterpupillaryDistance;
+    Viewport            FullView;
+    float               Aspect;
+    float               YFov;
+    float               ProjectionCenterOffset;
+    DistortionConfig    Distortion;
+    float               Unit2DPixel;
+    Matrix4f            OrthoCenter;
+    float               OrthoPixelOffset;
+    StereoEyeParams     EyeRenderParams[2];
+    DistortionMesh      EyeDistortionMesh[2];
 };
 
 
@@ -156,6 +306,7 @@ public:
 
     StereoConfig(StereoMode mode = Stereo_LeftRight_Multipass,
                  const Viewport& fullViewport = Viewport(0,0, 1280,800));
+    ~StereoConfig();
  
 
     // *** Modifiable State Access
@@ -211,6 +362,12 @@ public:
     // Sets the fieldOfView that the 2D coordinate area stretches to.
     void        Set2DAreaFov(float fovRadians);
 
+    // Sets the number of cells of the per-eye distortion mesh grid; 0 disables mesh
+    // generation. Meshes are regenerated together with the rest of the computed state.
+    void        SetDistortionMeshResolution(int gridWidth, int gridHeight);
+    int         GetDistortionMeshGridWidth() const  { return MeshGridWidth; }
+    int         GetDistortionMeshGridHeight() const { return MeshGridHeight; }
+
 
     // *** Computed State
 
@@ -238,6 +395,26 @@ public:
 
     // Returns full set of Stereo rendering parameters for the specified eye.
     const StereoEyeParams& GetEyeRenderParams(StereoEye eye);
+
+    // Returns the distortion mesh for the specified eye; empty for Stereo_None or
+    // when mesh generation is disabled.
+    const DistortionMesh&  GetDistortionMesh(StereoEye eye);
+
+
+    // *** Snapshots
+
+    // StereoConfig itself is not thread-safe, since even its getters update the computed
+    // state. Commit captures the current state into a new StereoSnapshot, returns it,
+    // and publishes it for GetLatestSnapshot. It must be called on the thread that
+    // modifies the configuration.
+    Ptr<StereoSnapshot>    Commit();
+
+    // GetLatestSnapshot returns the most recently committed snapshot, or null before the
+    // first Commit. It doesn't lock or touch any other StereoConfig state, so a rendering
+    // thread can call it every frame while another thread modifies and commits the
+    // configuration. Snapshots are handed over from Commit to a single reading thread,
+    // so only one thread should call it.
+    Ptr<StereoSnapshot>    GetLatestSnapshot();
    
 private:    
 
@@ -248,6 +425,7 @@ private:
     void updateProjectionOffset();
     void update2D();
     void updateEyeParams();
+    void updateDistortionMeshes();
 
 
     // *** Modifiable State
@@ -261,6 +439,7 @@ private:
     Viewport           FullView;                       // Entire window viewport.
 
     float              Area2DFov;                      // FOV range mapping to [-1, 1] 2D area.
+    int                MeshGridWidth, MeshGridHeight;  // Distortion mesh cells; 0 disables it.
  
     // *** Computed State
  
@@ -269,6 +448,7 @@ private:
     float              Aspect;      // Aspect ratio: (w/h)*AspectMultiplier.
     float              ProjectionCenterOffset;
     StereoEyeParams    EyeRenderParams[2];
+    DistortionMesh     EyeDistortionMesh[2];
 
   
     // ** 2D Rendering
@@ -277,6 +457,15 @@ private:
     float              FovPixels;
     Matrix4f           OrthoCenter;
     float              OrthoPixelOffset;
+
+
+    // ** Snapshots
+
+    UInt32                      SnapshotVersion;
+    // Committed snapshot not yet picked up by the reader; holds a reference.
+    AtomicPtr<StereoSnapshot>   PendingSnapshot;
+    // Only accessed by the GetLatestSnapshot thread.
+    Ptr<StereoSnapshot>         LatestSnapshot;
 };
 
 
@@ -0,0 +1,491 @@
+/************************************************************************************
+
+Filename    :   Render_BinarySceneLoader.cpp
+Content     :   Compiled binary scene format, loaded by mapping the file
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "Render_BinarySceneLoader.h"
+#include <Kernel/OVR_SysFile.h>
+#include <Kernel/OVR_Log.h>
+
+#if defined(OVR_OS_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace OVR { namespace Render {
+
+//-----------------------------------------------------------------------------------
+// ***** Shared with XmlHandler
+
+ShaderFill* CreateSceneFill(RenderDevice* pRender, Texture* diffuse, Texture* lightmap)
+{
+    ShaderFill* fill = new ShaderFill(*pRender->CreateShaderSet());
+    fill->GetShaders()->SetShader(pRender->LoadBuiltinShader(Shader_Vertex, VShader_MVP));
+    if (diffuse)
+    {
+        fill->SetTexture(0, diffuse);
+        if (lightmap)
+        {
+            fill->GetShaders()->SetShader(pRender->LoadBuiltinShader(Shader_Fragment, FShader_MultiTexture));
+            fill->SetTexture(1, lightmap);
+        }
+        else
+        {
+            fill->GetShaders()->SetShader(pRender->LoadBuiltinShader(Shader_Fragment, FShader_Texture));
+        }
+    }
+    else
+    {
+        fill->GetShaders()->SetShader(pRender->LoadBuiltinShader(Shader_Fragment, FShader_LitGouraud));
+    }
+    return fill;
+}
+
+Texture* LoadSceneTexture(RenderDevice* pRender, const char* fileName)
+{
+    TextureImage image;
+    if (!DecodeTextureFile(fileName, &image))
+    {
+        return NULL;
+    }
+    return CreateTextureFromImage(pRender, image);
+}
+
+void BindSceneFill(TextureLoader* pTextureLoader, ShaderFill* fill, int diffuse, int lightmap)
+{
+    // CreateSceneFill only uses the lightmap along with a diffuse texture.
+    if (diffuse >= 0)
+    {
+        pTextureLoader->SetFillTexture(diffuse, fill, 0);
+        if (lightmap >= 0)
+        {
+            pTextureLoader->SetFillTexture(lightmap, fill, 1);
+        }
+    }
+}
+
+ShaderFill* SceneFillCache::GetFill(int diffuse, int lightmap)
+{
+    // The lightmap is only used along with a diffuse texture.
+    if (diffuse < 0)
+    {
+        lightmap = -1;
+    }
+
+    for (UPInt i = 0; i < Fills.GetSize(); i++)
+    {
+        if ((Fills[i].Diffuse == diffuse) && (Fills[i].Lightmap == lightmap))
+        {
+            return Fills[i].Fill;
+        }
+    }
+
+    Entry entry;
+    entry.Diffuse  = diffuse;
+    entry.Lightmap = lightmap;
+    entry.Fill     = *CreateSceneFill(pRender,
+                                      (diffuse >= 0) ? Textures[diffuse].GetPtr() : NULL,
+                                      (lightmap >= 0) ? Textures[lightmap].GetPtr() : NULL);
+    if (pTextureLoader)
+    {
+        BindSceneFill(pTextureLoader, entry.Fill,
+                      (diffuse >= 0) ? TextureLoads[diffuse] : -1,
+                      (lightmap >= 0) ? TextureLoads[lightmap] : -1);
+    }
+    Fills.PushBack(entry);
+    return entry.Fill;
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Writing
+
+// Appends 'size' bytes to 'buffer' at the next 16 byte boundary, returning their offset.
+static UInt32 appendSceneData(Array<UByte>& buffer, const void* data, UPInt size)
+{
+    while (buffer.GetSize() & 15)
+        buffer.PushBack(0);
+
+    UPInt offset = buffer.GetSize();
+    buffer.Resize(offset + size);
+    if (size)
+        memcpy(&buffer[offset], data, size);
+    return (UInt32)offset;
+}
+
+static UInt32 appendCollisionModels(Array<UByte>& buffer, const Array<Ptr<CollisionModel> >& models)
+{
+    Array<BinarySceneCollisionModel> entries;
+    for (UPInt i = 0; i < models.GetSize(); i++)
+    {
+        const Array<Planef>& planes = models[i]->GetPlanes();
+        Array<float>         values;
+        for (UPInt p = 0; p < planes.GetSize(); p++)
+        {
+            values.PushBack(planes[p].N.x);
+            values.PushBack(planes[p].N.y);
+            values.PushBack(planes[p].N.z);
+            values.PushBack(planes[p].D);
+        }
+
+        BinarySceneCollisionModel entry;
+        entry.PlaneCount  = (UInt32)planes.GetSize();
+        entry.PlaneOffset = appendSceneData(buffer, values.GetSize() ? &values[0] : NULL,
+                                            values.GetSize() * sizeof(float));
+        entries.PushBack(entry);
+    }
+    return appendSceneData(buffer, entries.GetSize() ? &entries[0] : NULL,
+                           entries.GetSize() * sizeof(BinarySceneCollisionModel));
+}
+
+bool WriteBinaryScene(const char* fileName, const FileStat& source,
+                      const Array<String>& textureNames,
+                      const Array<Ptr<Model> >& models,
+                      const Array<int>& diffuseTextures, const Array<int>& lightmapTextures,
+                      const Array<Ptr<CollisionModel> >& collisions,
+                      const Array<Ptr<CollisionModel> >& groundCollisions)
+{
+    OVR_ASSERT((diffuseTextures.GetSize() == models.GetSize()) &&
+               (lightmapTextures.GetSize() == models.GetSize()));
+
+    // The file is built in memory, and the header filled in last.
+    Array<UByte>      buffer;
+    BinarySceneHeader header;
+    memset(&header, 0, sizeof(header));
+    appendSceneData(buffer, &header, sizeof(header));
+
+    Array<BinarySceneTexture> textures;
+    for (UPInt i = 0; i < textureNames.GetSize(); i++)
+    {
+        BinarySceneTexture entry;
+        entry.NameLength = (UInt32)textureNames[i].GetSize();
+        entry.NameOffset = appendSceneData(buffer, textureNames[i].ToCStr(), entry.NameLength + 1);
+        textures.PushBack(entry);
+    }
+
+    Array<BinarySceneModel> modelEntries;
+    for (UPInt i = 0; i < models.GetSize(); i++)
+    {
+        const Model* model = models[i];
+        if (model->Type != Prim_Triangles)
+            return false;
+
+        BinarySceneModel entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.Flags           = model->IsCollisionModel ? BinarySceneModel::Flag_Collision : 0;
+        entry.DiffuseTexture  = diffuseTextures[i];
+        entry.LightmapTexture = lightmapTextures[i];
+        entry.VertexCount     = (UInt32)model->Vertices.GetSize();
+        entry.VertexOffset    = appendSceneData(buffer, entry.VertexCount ? &model->Vertices[0] : NULL,
+                                                entry.VertexCount * sizeof(Vertex));
+        entry.IndexCount      = (UInt32)model->Indices.GetSize();
+        entry.IndexOffset     = appendSceneData(buffer, entry.IndexCount ? &model->Indices[0] : NULL,
+                                                entry.IndexCount * sizeof(UInt32));
+        modelEntries.PushBack(entry);
+    }
+
+    header.Magic                       = BinarySceneMagic;
+    header.Version                     = BinarySceneVersion;
+    header.VertexSize                  = sizeof(Vertex);
+    header.TextureCount                = (UInt32)textures.GetSize();
+    header.ModelCount                  = (UInt32)modelEntries.GetSize();
+    header.CollisionModelCount         = (UInt32)collisions.GetSize();
+    header.GroundCollisionModelCount   = (UInt32)groundCollisions.GetSize();
+    header.SourceSize                  = (UInt64)source.FileSize;
+    header.SourceModifyTime            = source.ModifyTime;
+    header.TexturesOffset              = appendSceneData(buffer, textures.GetSize() ? &textures[0] : NULL,
+                                                         textures.GetSize() * sizeof(BinarySceneTexture));
+    header.ModelsOffset                = appendSceneData(buffer, modelEntries.GetSize() ? &modelEntries[0] : NULL,
+                                                         modelEntries.GetSize() * sizeof(BinarySceneModel));
+    header.CollisionModelsOffset       = appendCollisionModels(buffer, collisions);
+    header.GroundCollisionModelsOffset = appendCollisionModels(buffer, groundCollisions);
+
+    // Offsets are 32 bits.
+    if (buffer.GetSize() > 0xffffffffu)
+        return false;
+    memcpy(&buffer[0], &header, sizeof(header));
+
+    SysFile file;
+    if (!file.Open(fileName, File::Open_Write | File::Open_Create | File::Open_Truncate))
+        return false;
+    int written = file.Write(&buffer[0], (int)buffer.GetSize());
+    return file.Close() && (written == (int)buffer.GetSize());
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Reading
+
+// Read-only view of a whole file, mapped into memory rather than read, so that only
+// the pages used are loaded.
+class MappedSceneFile
+{
+public:
+    MappedSceneFile() : pData(NULL), Size(0)
+#if defined(OVR_OS_WIN32)
+        , hFile(INVALID_HANDLE_VALUE), hMapping(NULL)
+#endif
+    { }
+    ~MappedSceneFile() { Close(); }
+
+    bool Open(const char* fileName);
+    void Close();
+
+    const UByte* GetData() const { return pData; }
+    UPInt        GetSize() const { return Size; }
+
+private:
+    const UByte* pData;
+    UPInt        Size;
+#if defined(OVR_OS_WIN32)
+    HANDLE       hFile;
+    HANDLE       hMapping;
+#endif
+};
+
+bool MappedSceneFile::Open(const char* fileName)
+{
+    Close();
+#if defined(OVR_OS_WIN32)
+    hFile = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size) || (size.QuadPart == 0) || (UInt64(size.QuadPart) > UInt64(~UPInt(0))))
+    {
+        Close();
+        return false;
+    }
+    hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMapping)
+        pData = (const UByte*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!pData)
+    {
+        Close();
+        return false;
+    }
+    Size = (UPInt)size.QuadPart;
+#else
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if ((fstat(fd, &info) == 0) && (info.st_size > 0))
+    {
+        void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            pData = (const UByte*)data;
+            Size  = (UPInt)info.st_size;
+        }
+    }
+    // The mapping stays valid once the file is closed.
+    close(fd);
+    if (!pData)
+        return false;
+#endif
+    return true;
+}
+
+void MappedSceneFile::Close()
+{
+#if defined(OVR_OS_WIN32)
+    if (pData)
+        UnmapViewOfFile(pData);
+    if (hMapping)
+        CloseHandle(hMapping);
+    if (hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(hFile);
+    hMapping = NULL;
+    hFile    = INVALID_HANDLE_VALUE;
+#else
+    if (pData)
+        munmap((void*)pData, Size);
+#endif
+    pData = NULL;
+    Size  = 0;
+}
+
+// Returns whether 'count' elements of 'elementSize' bytes at 'offset' lie within the file.
+static bool isInSceneFile(UPInt fileSize, UInt32 offset, UInt32 count, UPInt elementSize)
+{
+    return (offset <= fileSize) && (UPInt(count) <= (fileSize - offset) / elementSize);
+}
+
+static bool isValidCollisionModels(const UByte* data, UPInt size, UInt32 offset, UInt32 count)
+{
+    if (!isInSceneFile(size, offset, count, sizeof(BinarySceneCollisionModel)))
+        return false;
+
+    const BinarySceneCollisionModel* entries = (const BinarySceneCollisionModel*)(data + offset);
+    for (UInt32 i = 0; i < count; i++)
+    {
+        if (!isInSceneFile(size, entries[i].PlaneOffset, entries[i].PlaneCount, 4 * sizeof(float)))
+            return false;
+    }
+    return true;
+}
+
+static void readCollisionModels(const UByte* data, UInt32 offset, UInt32 count,
+                                Array<Ptr<CollisionModel> >* pCollisions)
+{
+    const BinarySceneCollisionModel* entries = (const BinarySceneCollisionModel*)(data + offset);
+    for (UInt32 i = 0; i < count; i++)
+    {
+        Ptr<CollisionModel> cm     = *new CollisionModel();
+        const float*        values = (const float*)(data + entries[i].PlaneOffset);
+        for (UInt32 p = 0; p < entries[i].PlaneCount; p++, values += 4)
+            cm->Add(Planef(values[0], values[1], values[2], values[3]));
+        pCollisions->PushBack(cm);
+    }
+}
+
+bool BinarySceneLoader::ReadFile(const char* fileName, RenderDevice* pRender, Scene* pScene,
+                                 Array<Ptr<CollisionModel> >* pCollisions,
+                                 Array<Ptr<CollisionModel> >* pGroundCollisions,
+                                 const FileStat* source, TextureLoader* pTextureLoader)
+{
+    MappedSceneFile file;
+    if (!file.Open(fileName))
+        return false;
+
+    const UByte* data = file.GetData();
+    UPInt        size = file.GetSize();
+    if (size < sizeof(BinarySceneHeader))
+        return false;
+
+    const BinarySceneHeader& header = *(const BinarySceneHeader*)data;
+    if ((header.Magic != BinarySceneMagic) || (header.Version != BinarySceneVersion) ||
+        (header.VertexSize != sizeof(Vertex)))
+    {
+        OVR_DEBUG_LOG(("%s is not a compiled scene of this version.", fileName));
+        return false;
+    }
+    if (source && ((header.SourceSize != (UInt64)source->FileSize) ||
+                   (header.SourceModifyTime != source->ModifyTime)))
+    {
+        OVR_DEBUG_LOG(("%s is out of date.", fileName));
+        return false;
+    }
+
+    // Everything is checked before anything is created, so that a damaged file leaves
+    // the scene as it was.
+    if (!isInSceneFile(size, header.TexturesOffset, header.TextureCount, sizeof(BinarySceneTexture)) ||
+        !isInSceneFile(size, header.ModelsOffset, header.ModelCount, sizeof(BinarySceneModel)) ||
+        !isValidCollisionModels(data, size, header.CollisionModelsOffset, header.CollisionModelCount) ||
+        !isValidCollisionModels(data, size, header.GroundCollisionModelsOffset, header.GroundCollisionModelCount))
+    {
+        return false;
+    }
+
+    const BinarySceneTexture* textureEntries = (const BinarySceneTexture*)(data + header.TexturesOffset);
+    for (UInt32 i = 0; i < header.TextureCount; i++)
+    {
+        const BinarySceneTexture& entry = textureEntries[i];
+        if ((entry.NameLength >= size) || !isInSceneFile(size, entry.NameOffset, entry.NameLength + 1, 1) ||
+            data[entry.NameOffset + entry.NameLength])
+        {
+            return false;
+        }
+    }
+
+    const BinarySceneModel* modelEntries = (const BinarySceneModel*)(data + header.ModelsOffset);
+    for (UInt32 i = 0; i < header.ModelCount; i++)
+    {
+        const BinarySceneModel& entry = modelEntries[i];
+        if (!isInSceneFile(size, entry.VertexOffset, entry.VertexCount, sizeof(Vertex)) ||
+            !isInSceneFile(size, entry.IndexOffset, entry.IndexCount, sizeof(UInt32)) ||
+            (entry.DiffuseTexture >= (SInt32)header.TextureCount) ||
+            (entry.LightmapTexture >= (SInt32)header.TextureCount))
+        {
+            return false;
+        }
+
+        const UInt32* indices = (const UInt32*)(data + entry.IndexOffset);
+        for (UInt32 j = 0; j < entry.IndexCount; j++)
+        {
+            if (indices[j] >= entry.VertexCount)
+                return false;
+        }
+    }
+
+    // Texture names are relative to the scene file.
+    String                path = String(fileName).GetPath();
+    Array<Ptr<Texture> >  textures;
+    Array<int>            textureLoads;
+    for (UInt32 i = 0; i < header.TextureCount; i++)
+    {
+        String       textureName = path + (const char*)(data + textureEntries[i].NameOffset);
+        Ptr<Texture> texture;
+        if (pTextureLoader)
+        {
+            textureLoads.PushBack(pTextureLoader->Load(textureName));
+            texture = pTextureLoader->GetPlaceholder(pRender);
+        }
+        else
+        {
+            Texture* loaded = LoadSceneTexture(pRender, textureName.ToCStr());
+            if (loaded)
+                texture = *loaded;
+        }
+        textures.PushBack(texture);
+    }
+
+    SceneFillCache fills(pRender, textures, pTextureLoader, textureLoads);
+    for (UInt32 i = 0; i < header.ModelCount; i++)
+    {
+        const BinarySceneModel& entry = modelEntries[i];
+        Ptr<Model>              model = *new Model(Prim_Triangles);
+
+        model->IsCollisionModel = (entry.Flags & BinarySceneModel::Flag_Collision) != 0;
+        model->Visible          = !model->IsCollisionModel;
+
+        model->Fill = fills.GetFill(entry.DiffuseTexture, entry.LightmapTexture);
+
+        const Vertex* vertices = (const Vertex*)(data + entry.VertexOffset);
+        model->Vertices.Reserve(entry.VertexCount);
+        for (UInt32 v = 0; v < entry.VertexCount; v++)
+            model->Vertices.PushBack(vertices[v]);
+        model->Indices.Resize(entry.IndexCount);
+        if (entry.IndexCount)
+            memcpy(&model->Indices[0], data + entry.IndexOffset, entry.IndexCount * sizeof(UInt32));
+
+        // The second UV set is only needed for lightmaps.
+        model->SetCompactFormat(entry.LightmapTexture >= 0);
+        model->UpdateBounds();
+        pScene->World.Add(model);
+        pScene->Models.PushBack(model);
+    }
+
+    readCollisionModels(data, header.CollisionModelsOffset, header.CollisionModelCount, pCollisions);
+    readCollisionModels(data, header.GroundCollisionModelsOffset, header.GroundCollisionModelCount,
+                        pGroundCollisions);
+    return true;
+}
+
+}}
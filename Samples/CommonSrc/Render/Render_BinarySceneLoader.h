@@ -0,0 +1,169 @@
+/************************************************************************************
+
+Filename    :   Render_BinarySceneLoader.h
+Content     :   Compiled binary scene format, loaded by mapping the file
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef INC_Render_BinarySceneLoader_h
+#define INC_Render_BinarySceneLoader_h
+
+#include "Render_Device.h"
+#include "Render_TextureLoader.h"
+#include <Kernel/OVR_String.h>
+#include <Kernel/OVR_SysFile.h>
+
+namespace OVR { namespace Render {
+
+// A compiled scene holds what XmlHandler reads from the XML scene, laid out so that
+// the loader can map the file and copy vertices and indices straight into models:
+//
+//  - BinarySceneHeader, at the start of the file.
+//  - BinarySceneTexture entries, naming texture files relative to the scene file.
+//  - BinarySceneModel entries, each with its textures, and its Vertex and UInt32
+//    index arrays stored as Model holds them.
+//  - BinarySceneCollisionModel entries for the wall and ground collision models,
+//    each with its planes stored as four floats: the normal, then D.
+//
+// All offsets are in bytes from the start of the file; arrays start on 16 byte
+// boundaries. The file is written in the byte order of the machine writing it, and
+// is rejected by a loader that disagrees on the magic value or on sizeof(Vertex).
+
+enum
+{
+    BinarySceneMagic   = 0x5352564F,    // "OVRS"
+    BinarySceneVersion = 2
+};
+
+struct BinarySceneHeader
+{
+    UInt32  Magic;
+    UInt32  Version;
+    UInt32  VertexSize;
+    UInt32  TextureCount;
+    UInt32  ModelCount;
+    UInt32  CollisionModelCount;
+    UInt32  GroundCollisionModelCount;
+    UInt32  TexturesOffset;
+    UInt32  ModelsOffset;
+    UInt32  CollisionModelsOffset;
+    UInt32  GroundCollisionModelsOffset;
+    UInt32  Pad;
+    // Size and modification time of the scene file this one was compiled from, so that
+    // a stale compiled file can be told apart.
+    UInt64  SourceSize;
+    SInt64  SourceModifyTime;
+};
+
+struct BinarySceneTexture
+{
+    UInt32  NameOffset;     // Null terminated.
+    UInt32  NameLength;
+};
+
+struct BinarySceneModel
+{
+    enum { Flag_Collision = 0x01 };
+
+    UInt32  Flags;
+    SInt32  DiffuseTexture;     // -1 if none.
+    SInt32  LightmapTexture;    // -1 if none.
+    UInt32  VertexCount;
+    UInt32  VertexOffset;
+    UInt32  IndexCount;
+    UInt32  IndexOffset;
+    UInt32  Pad;
+};
+
+struct BinarySceneCollisionModel
+{
+    UInt32  PlaneCount;
+    UInt32  PlaneOffset;
+};
+
+
+// Creates the fill scene models use for their textures; either may be null.
+ShaderFill* CreateSceneFill(RenderDevice* pRender, Texture* diffuse, Texture* lightmap);
+
+// Loads a texture file, by its extension as DDS or TGA. Returns null on failure.
+Texture*    LoadSceneTexture(RenderDevice* pRender, const char* fileName);
+
+// Has the loader set the textures of a fill made by CreateSceneFill once they are
+// created; the indices are those returned by TextureLoader::Load, or -1.
+void        BindSceneFill(TextureLoader* pTextureLoader, ShaderFill* fill, int diffuse, int lightmap);
+
+// Hands out one fill per pair of diffuse and lightmap textures of a scene, so that
+// models using the same textures share a fill and Scene::BuildBatches can merge them.
+// 'textures' holds the scene's textures; with a TextureLoader, 'textureLoads' holds
+// the indices it returned for them, and each fill is bound to the loader once.
+class SceneFillCache
+{
+public:
+    SceneFillCache(RenderDevice* render, const Array<Ptr<Texture> >& textures,
+                   TextureLoader* textureLoader, const Array<int>& textureLoads)
+        : pRender(render), Textures(textures), pTextureLoader(textureLoader),
+          TextureLoads(textureLoads) { }
+
+    // Texture indices are into 'textures', or -1.
+    ShaderFill* GetFill(int diffuse, int lightmap);
+
+private:
+    struct Entry
+    {
+        int             Diffuse, Lightmap;
+        Ptr<ShaderFill> Fill;
+    };
+
+    RenderDevice*               pRender;
+    const Array<Ptr<Texture> >& Textures;
+    TextureLoader*              pTextureLoader;
+    const Array<int>&           TextureLoads;
+    Array<Entry>                Fills;
+};
+
+// Writes a compiled scene. 'diffuseTextures' and 'lightmapTextures' give the texture
+// indices of each model, or -1. The size and modification time of 'source', the scene
+// file it was compiled from, are stored for ReadFile to check.
+bool WriteBinaryScene(const char* fileName, const FileStat& source,
+                      const Array<String>& textureNames,
+                      const Array<Ptr<Model> >& models,
+                      const Array<int>& diffuseTextures, const Array<int>& lightmapTextures,
+                      const Array<Ptr<CollisionModel> >& collisions,
+                      const Array<Ptr<CollisionModel> >& groundCollisions);
+
+
+// Loads a compiled scene the way XmlHandler loads an XML one. The models are assumed
+// to have been optimized when the scene was compiled.
+class BinarySceneLoader
+{
+public:
+    BinarySceneLoader() { }
+
+    // Returns false if the file can't be read or is invalid, or if 'source' is given
+    // and its size or modification time differs from those recorded in the file.
+    // Textures are queued on 'pTextureLoader' if it is given, as by XmlHandler::ReadFile.
+    bool ReadFile(const char* fileName, RenderDevice* pRender, Scene* pScene,
+                  Array<Ptr<CollisionModel> >* pCollisions,
+                  Array<Ptr<CollisionModel> >* pGroundCollisions,
+                  const FileStat* source = NULL, TextureLoader* pTextureLoader = NULL);
+};
+
+}}
+
+#endif
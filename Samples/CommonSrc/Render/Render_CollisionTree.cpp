@@ -0,0 +1,358 @@
+/************************************************************************************
+
+Filename    :   Render_CollisionTree.cpp
+Content     :   Bounding volume hierarchy for collision queries
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "Render_CollisionTree.h"
+#include "Kernel/OVR_Alg.h"
+
+namespace OVR { namespace Render {
+
+const float CollisionTree::HitMargin = 0.05f;
+
+// Clips the ray against the box; returns false if the ray misses it within 'len'.
+// 'invNorm' holds the reciprocals of the ray direction.
+static bool testRayBox(const Vector3f& min, const Vector3f& max, const Vector3f& origin,
+                       const Vector3f& invNorm, float len)
+{
+    float t0 = (min.x - origin.x) * invNorm.x, t1 = (max.x - origin.x) * invNorm.x;
+    float tNear = Alg::Min(t0, t1), tFar = Alg::Max(t0, t1);
+
+    t0 = (min.y - origin.y) * invNorm.y; t1 = (max.y - origin.y) * invNorm.y;
+    tNear = Alg::Max(tNear, Alg::Min(t0, t1)); tFar = Alg::Min(tFar, Alg::Max(t0, t1));
+
+    t0 = (min.z - origin.z) * invNorm.z; t1 = (max.z - origin.z) * invNorm.z;
+    tNear = Alg::Max(tNear, Alg::Min(t0, t1)); tFar = Alg::Min(tFar, Alg::Max(t0, t1));
+
+    return (tNear <= tFar) && (tFar >= 0) && (tNear <= len);
+}
+
+static float getAxis(const Vector3f& v, int axis)
+{
+    return (axis == 0) ? v.x : ((axis == 1) ? v.y : v.z);
+}
+
+static bool testPointBox(const Vector3f& min, const Vector3f& max, const Vector3f& p)
+{
+    return (p.x >= min.x) && (p.x <= max.x) && (p.y >= min.y) && (p.y <= max.y) &&
+           (p.z >= min.z) && (p.z <= max.z);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** CollisionTree
+
+void CollisionTree::Clear()
+{
+    Models.Clear();
+    ModelOrder.Clear();
+    Nodes.Clear();
+    Unbounded.Clear();
+}
+
+void CollisionTree::Build(const Array<Ptr<CollisionModel> >& models)
+{
+    Clear();
+
+    Array<Bounds> modelBounds;
+    for (UPInt i = 0; i < models.GetSize(); i++)
+    {
+        // Models without planes have no surface to hit.
+        if (models[i]->GetPlanes().GetSize() == 0)
+            continue;
+
+        UInt32 index = (UInt32)Models.GetSize();
+        Models.PushBack(models[i]);
+
+        Bounds b;
+        if (models[i]->GetBounds(&b))
+            ModelOrder.PushBack(index);
+        else
+            Unbounded.PushBack(index);
+        // Centers are kept for splitting.
+        b.Center = (b.Min + b.Max) * 0.5f;
+        modelBounds.PushBack(b);
+    }
+
+    if (ModelOrder.GetSize())
+    {
+        Node root;
+        Nodes.PushBack(root);
+        buildNode(0, 0, (UInt32)ModelOrder.GetSize(), modelBounds);
+    }
+}
+
+// Fills in Nodes[node] for the models ModelOrder[first, first + count), splitting them
+// at the median along the longest axis of their centers.
+void CollisionTree::buildNode(UInt32 node, UInt32 first, UInt32 count, const Array<Bounds>& modelBounds)
+{
+    Bounds box, centers;
+    for (UInt32 i = first; i < first + count; i++)
+    {
+        const Bounds& b = modelBounds[ModelOrder[i]];
+        box.AddPoint(b.Min);
+        box.AddPoint(b.Max);
+        centers.AddPoint(b.Center);
+    }
+    Nodes[node].Min = box.Min;
+    Nodes[node].Max = box.Max;
+
+    if (count <= LeafSize)
+    {
+        Nodes[node].First = first;
+        Nodes[node].Count = count;
+        return;
+    }
+
+    Vector3f extent = centers.Max - centers.Min;
+    int      axis   = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+
+    // Insertion sort keeps this simple; trees are built once, over few models.
+    for (UInt32 i = first + 1; i < first + count; i++)
+    {
+        UInt32 model = ModelOrder[i];
+        float  key   = getAxis(modelBounds[model].Center, axis);
+        UInt32 j     = i;
+        for (; (j > first) && (getAxis(modelBounds[ModelOrder[j - 1]].Center, axis) > key); j--)
+            ModelOrder[j] = ModelOrder[j - 1];
+        ModelOrder[j] = model;
+    }
+
+    UInt32 children = (UInt32)Nodes.GetSize();
+    Node   child;
+    Nodes.PushBack(child);
+    Nodes.PushBack(child);
+    Nodes[node].First = children;
+    Nodes[node].Count = 0;
+
+    UInt32 half = count / 2;
+    buildNode(children,     first,        half,         modelBounds);
+    buildNode(children + 1, first + half, count - half, modelBounds);
+}
+
+// Keeps a model's hit at 't' on 'plane' if it is the nearest so far.
+static void keepNearestHit(const CollisionModel* model, float t, int plane, bool& hit, float& len, Planef* ph)
+{
+    float hitLen = Alg::Max(t - CollisionTree::HitMargin, 0.0f);
+    if (hit && (hitLen >= len))
+        return;
+
+    hit = true;
+    len = hitLen;
+    if (ph)
+        *ph = model->GetPlanes()[(plane < 0) ? 0 : plane];
+}
+
+// Tests one model, keeping its hit if it is the nearest so far. Once there is a hit,
+// models are tested with the margin added back, so that a nearer hit isn't lost to
+// the distance taken off the farther one.
+void CollisionTree::testNearest(UInt32 model, const Vector3f& origin, const Vector3f& norm,
+                                bool& hit, float& len, Planef* ph) const
+{
+    float t;
+    int   plane;
+    if (Models[model]->ClipRay(origin, norm, hit ? len + HitMargin : len, t, plane))
+        keepNearestHit(Models[model], t, plane, hit, len, ph);
+}
+
+// testNearest for a packet of up to PacketSize rays.
+void CollisionTree::testNearest(UInt32 model, CollisionRay* rays, int count, bool* hits, Planef* planes) const
+{
+    CollisionRay clipRays[PacketSize];
+    float        ts[PacketSize];
+    int          hitPlanes[PacketSize];
+    for (int i = 0; i < count; i++)
+    {
+        clipRays[i]     = rays[i];
+        clipRays[i].Len = hits[i] ? rays[i].Len + HitMargin : rays[i].Len;
+    }
+
+    Models[model]->ClipRays(clipRays, count, ts, hitPlanes);
+    for (int i = 0; i < count; i++)
+    {
+        if (ts[i] >= 0)
+            keepNearestHit(Models[model], ts[i], hitPlanes[i], hits[i], rays[i].Len, planes ? planes + i : NULL);
+    }
+}
+
+bool CollisionTree::TestRay(const Vector3f& origin, const Vector3f& norm, float& len, Planef* ph) const
+{
+    bool hit = false;
+    for (UPInt i = 0; i < Unbounded.GetSize(); i++)
+        testNearest(Unbounded[i], origin, norm, hit, len, ph);
+    if (Nodes.GetSize() == 0)
+        return hit;
+
+    // Axes the ray runs parallel to get a large reciprocal rather than an infinite one,
+    // which would make NaNs at the box faces.
+    Vector3f invNorm((norm.x != 0) ? 1.0f / norm.x : Math<float>::MaxValue,
+                     (norm.y != 0) ? 1.0f / norm.y : Math<float>::MaxValue,
+                     (norm.z != 0) ? 1.0f / norm.z : Math<float>::MaxValue);
+    UInt32   stack[MaxStackDepth];
+    int      stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = Nodes[stack[--stackSize]];
+        if (!testRayBox(node.Min, node.Max, origin, invNorm, hit ? len + HitMargin : len))
+            continue;
+
+        if (node.Count > 0)
+        {
+            for (UInt32 i = node.First; i < node.First + node.Count; i++)
+                testNearest(ModelOrder[i], origin, norm, hit, len, ph);
+        }
+        else
+        {
+            // The nearer child is visited first, so farther ones are mostly rejected by
+            // the shortened ray.
+            const Node& a = Nodes[node.First];
+            const Node& b = Nodes[node.First + 1];
+            Vector3f    centerA = a.Min + a.Max, centerB = b.Min + b.Max;
+            bool        aFirst  = ((centerB - centerA) * norm) >= 0;
+
+            OVR_ASSERT(stackSize + 2 <= MaxStackDepth);
+            stack[stackSize++] = node.First + (aFirst ? 1 : 0);
+            stack[stackSize++] = node.First + (aFirst ? 0 : 1);
+        }
+    }
+    return hit;
+}
+
+void CollisionTree::TestRays(CollisionRay* rays, int count, bool* hits, Planef* planes) const
+{
+    for (int first = 0; first < count; first += PacketSize)
+    {
+        testPacket(rays + first, Alg::Min(count - first, (int)PacketSize), hits + first,
+                   planes ? planes + first : NULL);
+    }
+}
+
+// Walks the tree once for the whole packet; a node is entered if any ray reaches it.
+void CollisionTree::testPacket(CollisionRay* rays, int count, bool* hits, Planef* planes) const
+{
+    for (int i = 0; i < count; i++)
+        hits[i] = false;
+    for (UPInt i = 0; i < Unbounded.GetSize(); i++)
+        testNearest(Unbounded[i], rays, count, hits, planes);
+    if (Nodes.GetSize() == 0)
+        return;
+
+    Vector3f invNorms[PacketSize];
+    for (int i = 0; i < count; i++)
+    {
+        const Vector3f& norm = rays[i].Norm;
+        invNorms[i] = Vector3f((norm.x != 0) ? 1.0f / norm.x : Math<float>::MaxValue,
+                               (norm.y != 0) ? 1.0f / norm.y : Math<float>::MaxValue,
+                               (norm.z != 0) ? 1.0f / norm.z : Math<float>::MaxValue);
+    }
+
+    UInt32 stack[MaxStackDepth];
+    int    stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = Nodes[stack[--stackSize]];
+        bool        reached = false;
+        for (int i = 0; (i < count) && !reached; i++)
+        {
+            reached = testRayBox(node.Min, node.Max, rays[i].Origin, invNorms[i],
+                                 hits[i] ? rays[i].Len + HitMargin : rays[i].Len);
+        }
+        if (!reached)
+            continue;
+
+        if (node.Count > 0)
+        {
+            for (UInt32 i = node.First; i < node.First + node.Count; i++)
+                testNearest(ModelOrder[i], rays, count, hits, planes);
+        }
+        else
+        {
+            // Children are ordered along the first ray.
+            const Node& a = Nodes[node.First];
+            const Node& b = Nodes[node.First + 1];
+            bool        aFirst = (((b.Min + b.Max) - (a.Min + a.Max)) * rays[0].Norm) >= 0;
+
+            OVR_ASSERT(stackSize + 2 <= MaxStackDepth);
+            stack[stackSize++] = node.First + (aFirst ? 1 : 0);
+            stack[stackSize++] = node.First + (aFirst ? 0 : 1);
+        }
+    }
+}
+
+bool CollisionTree::TestSegment(const Vector3f& start, const Vector3f& end, float& fraction, Planef* ph) const
+{
+    Vector3f delta  = end - start;
+    float    length = delta.Length();
+    if (length <= 0)
+    {
+        fraction = 0;
+        return TestPoint(start);
+    }
+
+    float len = length;
+    if (!TestRay(start, delta / length, len, ph))
+        return false;
+    fraction = len / length;
+    return true;
+}
+
+bool CollisionTree::TestPoint(const Vector3f& p) const
+{
+    for (UPInt i = 0; i < Unbounded.GetSize(); i++)
+    {
+        if (Models[Unbounded[i]]->TestPoint(p))
+            return true;
+    }
+    if (Nodes.GetSize() == 0)
+        return false;
+
+    UInt32 stack[MaxStackDepth];
+    int    stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = Nodes[stack[--stackSize]];
+        if (!testPointBox(node.Min, node.Max, p))
+            continue;
+
+        if (node.Count > 0)
+        {
+            for (UInt32 i = node.First; i < node.First + node.Count; i++)
+            {
+                if (Models[ModelOrder[i]]->TestPoint(p))
+                    return true;
+            }
+        }
+        else
+        {
+            stack[stackSize++] = node.First;
+            stack[stackSize++] = node.First + 1;
+        }
+    }
+    return false;
+}
+
+}}
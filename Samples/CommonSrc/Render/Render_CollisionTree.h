@@ -0,0 +1,91 @@
+/************************************************************************************
+
+Filename    :   Render_CollisionTree.h
+Content     :   Bounding volume hierarchy for collision queries
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef INC_Render_CollisionTree_h
+#define INC_Render_CollisionTree_h
+
+#include "Render_Device.h"
+
+namespace OVR { namespace Render {
+
+// CollisionTree answers ray and point queries against a set of convex collision models
+// without testing each of them: the models' boxes are kept in a bounding volume
+// hierarchy, built once after loading, and queries only visit the nodes they touch.
+// Models that aren't closed, and so have no finite box, are tested by every query.
+class CollisionTree
+{
+public:
+    // Ray hits are moved back towards the origin by this distance, as with
+    // CollisionModel::TestRay, so that the result stays just outside the model.
+    static const float HitMargin;
+
+    CollisionTree() { }
+
+    // Builds the tree over 'models', replacing any earlier contents.
+    void Build(const Array<Ptr<CollisionModel> >& models);
+    void Clear();
+
+    // Finds the nearest model crossed by the ray from 'origin' along the unit vector
+    // 'norm' within 'len'. On a hit, 'len' is set to the distance to it less HitMargin,
+    // and 'ph' to the plane that was crossed. An origin inside a model hits at 0.
+    bool TestRay(const Vector3f& origin, const Vector3f& norm, float& len, Planef* ph = NULL) const;
+
+    // TestRay for several rays, which walk the tree together and are clipped against
+    // each model as a packet. Each ray's Len is updated as 'len' is by TestRay; 'hits'
+    // and 'planes' receive the results per ray.
+    void TestRays(CollisionRay* rays, int count, bool* hits, Planef* planes = NULL) const;
+
+    // Same as TestRay for the segment from 'start' to 'end'; 'fraction' is set to the
+    // fraction of the segment before the hit.
+    bool TestSegment(const Vector3f& start, const Vector3f& end, float& fraction, Planef* ph = NULL) const;
+
+    // Returns whether 'p' is inside any model.
+    bool TestPoint(const Vector3f& p) const;
+
+private:
+    // Leaves have Count models starting at First in ModelOrder; inner nodes have
+    // Count 0, and their children are at First and First + 1.
+    struct Node
+    {
+        Vector3f Min, Max;
+        UInt32   First;
+        UInt32   Count;
+    };
+
+    enum { LeafSize = 2, MaxStackDepth = 64, PacketSize = 4 };
+
+    void   buildNode(UInt32 node, UInt32 first, UInt32 count, const Array<Bounds>& modelBounds);
+    void   testNearest(UInt32 model, const Vector3f& origin, const Vector3f& norm,
+                       bool& hit, float& len, Planef* ph) const;
+    void   testNearest(UInt32 model, CollisionRay* rays, int count, bool* hits, Planef* planes) const;
+    void   testPacket(CollisionRay* rays, int count, bool* hits, Planef* planes) const;
+
+    Array<Ptr<CollisionModel> > Models;
+    Array<UInt32>               ModelOrder;
+    Array<Node>                 Nodes;
+    Array<UInt32>               Unbounded;
+};
+
+}}
+
+#endif
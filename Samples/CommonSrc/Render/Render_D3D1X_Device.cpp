@@ -43,6 +43,107 @@ static D3D1x_(INPUT_ELEMENT_DESC) ModelVertexDesc[] =
     {"Normal",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, Norm),  D3D1x_(INPUT_PER_VERTEX_DATA), 0},
 };
 
+static D3D1x_(INPUT_ELEMENT_DESC) CompactVertexDesc[] =
+{
+    {"Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(CompactVertex, Pos),  D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+    {"Color",    0, DXGI_FORMAT_R8G8B8A8_UNORM,  0, offsetof(CompactVertex, C),    D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+    {"TexCoord", 0, DXGI_FORMAT_R16G16_FLOAT,    0, offsetof(CompactVertex, UV),   D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+    {"Normal",   0, DXGI_FORMAT_R16G16_SNORM,    0, offsetof(CompactVertex, Norm), D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+};
+
+static D3D1x_(INPUT_ELEMENT_DESC) CompactVertexUV2Desc[] =
+{
+    {"Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(CompactVertexUV2, Pos),  D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+    {"Color",    0, DXGI_FORMAT_R8G8B8A8_UNORM,  0, offsetof(CompactVertexUV2, C),    D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+    {"TexCoord", 0, DXGI_FORMAT_R16G16_FLOAT,    0, offsetof(CompactVertexUV2, UV),   D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+    {"TexCoord", 1, DXGI_FORMAT_R16G16_FLOAT,    0, offsetof(CompactVertexUV2, UV2),  D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+    {"Normal",   0, DXGI_FORMAT_R16G16_SNORM,    0, offsetof(CompactVertexUV2, Norm), D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+};
+
+static D3D1x_(INPUT_ELEMENT_DESC) DepthVertexDesc[] =
+{
+    {"Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D1x_(INPUT_PER_VERTEX_DATA), 0},
+};
+
+static const struct
+{
+    const D3D1x_(INPUT_ELEMENT_DESC)* Desc;
+    UINT                              Count;
+} ModelVertexLayouts[VertexFormat_Count] =
+{
+    { ModelVertexDesc,      sizeof(ModelVertexDesc) / sizeof(ModelVertexDesc[0]) },
+    { CompactVertexDesc,    sizeof(CompactVertexDesc) / sizeof(CompactVertexDesc[0]) },
+    { CompactVertexUV2Desc, sizeof(CompactVertexUV2Desc) / sizeof(CompactVertexUV2Desc[0]) },
+    { DepthVertexDesc,      sizeof(DepthVertexDesc) / sizeof(DepthVertexDesc[0]) }
+};
+
+
+// Model vertex shaders are compiled once for each VertexFormat, prefixed with its
+// ModelVertex input and the DecodeVertex function that expands it.
+#define OCT_NORMAL_DECODE                                       \
+    "float3 DecodeOctNormal(float2 e)\n"                        \
+    "{\n"                                                       \
+    "   float3 n = float3(e, 1 - abs(e.x) - abs(e.y));\n"       \
+    "   if (n.z < 0)\n"                                         \
+    "       n.xy = (1 - abs(n.yx)) * (n.xy >= 0 ? 1 : -1);\n"   \
+    "   return normalize(n);\n"                                 \
+    "}\n"
+
+static const char* ModelVertexSrcs[VertexFormat_Count] =
+{
+    // VertexFormat_Standard
+    "struct ModelVertex\n"
+    "{\n"
+    "   float4 Position  : POSITION;\n"
+    "   float4 Color     : COLOR0;\n"
+    "   float2 TexCoord  : TEXCOORD0;\n"
+    "   float2 TexCoord1 : TEXCOORD1;\n"
+    "   float3 Normal    : NORMAL;\n"
+    "};\n"
+    "void DecodeVertex(ModelVertex v, out float4 color, out float2 tc, out float2 tc1, out float3 normal)\n"
+    "{\n"
+    "   color = v.Color; tc = v.TexCoord; tc1 = v.TexCoord1; normal = v.Normal;\n"
+    "}\n",
+
+    // VertexFormat_Compact
+    OCT_NORMAL_DECODE
+    "struct ModelVertex\n"
+    "{\n"
+    "   float4 Position  : POSITION;\n"
+    "   float4 Color     : COLOR0;\n"
+    "   float2 TexCoord  : TEXCOORD0;\n"
+    "   float2 Normal    : NORMAL;\n"
+    "};\n"
+    "void DecodeVertex(ModelVertex v, out float4 color, out float2 tc, out float2 tc1, out float3 normal)\n"
+    "{\n"
+    "   color = v.Color; tc = v.TexCoord; tc1 = v.TexCoord; normal = DecodeOctNormal(v.Normal);\n"
+    "}\n",
+
+    // VertexFormat_CompactUV2
+    OCT_NORMAL_DECODE
+    "struct ModelVertex\n"
+    "{\n"
+    "   float4 Position  : POSITION;\n"
+    "   float4 Color     : COLOR0;\n"
+    "   float2 TexCoord  : TEXCOORD0;\n"
+    "   float2 TexCoord1 : TEXCOORD1;\n"
+    "   float2 Normal    : NORMAL;\n"
+    "};\n"
+    "void DecodeVertex(ModelVertex v, out float4 color, out float2 tc, out float2 tc1, out float3 normal)\n"
+    "{\n"
+    "   color = v.Color; tc = v.TexCoord; tc1 = v.TexCoord1; normal = DecodeOctNormal(v.Normal);\n"
+    "}\n",
+
+    // VertexFormat_Depth
+    "struct ModelVertex\n"
+    "{\n"
+    "   float4 Position  : POSITION;\n"
+    "};\n"
+    "void DecodeVertex(ModelVertex v, out float4 color, out float2 tc, out float2 tc1, out float3 normal)\n"
+    "{\n"
+    "   color = float4(1,1,1,1); tc = float2(0,0); tc1 = float2(0,0); normal = float3(0,0,1);\n"
+    "}\n"
+};
 
 static const char* StdVertexShaderSrc =
     "float4x4 Proj;\n"
@@ -56,26 +157,23 @@ static const char* StdVertexShaderSrc =
     "   float3 Normal   : NORMAL;\n"
     "   float3 VPos     : TEXCOORD4;\n"
     "};\n"
-    "void main(in float4 Position : POSITION, in float4 Color : COLOR0, in float2 TexCoord : TEXCOORD0, in float2 TexCoord1 : TEXCOORD1, in float3 Normal : NORMAL,\n"
-    "          out Varyings ov)\n"
+    "void main(in ModelVertex v, out Varyings ov)\n"
     "{\n"
-    "   ov.Position = mul(Proj, mul(View, Position));\n"
+    "   float3 Normal;\n"
+    "   DecodeVertex(v, ov.Color, ov.TexCoord, ov.TexCoord1, Normal);\n"
+    "   ov.Position = mul(Proj, mul(View, v.Position));\n"
     "   ov.Normal = mul(View, Normal);\n"
-    "   ov.VPos = mul(View, Position);\n"
-    "   ov.TexCoord = TexCoord;\n"
-    "   ov.TexCoord1 = TexCoord1;\n"
-    "   ov.Color = Color;\n"
+    "   ov.VPos = mul(View, v.Position);\n"
     "}\n";
 
 static const char* DirectVertexShaderSrc =
     "float4x4 View : register(c4);\n"
-    "void main(in float4 Position : POSITION, in float4 Color : COLOR0, in float2 TexCoord : TEXCOORD0, in float2 TexCoord1 : TEXCOORD1, in float3 Normal : NORMAL,\n"
+    "void main(in ModelVertex v,\n"
     "          out float4 oPosition : SV_Position, out float4 oColor : COLOR, out float2 oTexCoord : TEXCOORD0, out float2 oTexCoord1 : TEXCOORD1, out float3 oNormal : NORMAL)\n"
     "{\n"
-    "   oPosition = mul(View, Position);\n"
-    "   oTexCoord = TexCoord;\n"
-    "   oTexCoord1 = TexCoord1;\n"
-    "   oColor = Color;\n"
+    "   float3 Normal;\n"
+    "   DecodeVertex(v, oColor, oTexCoord, oTexCoord1, Normal);\n"
+    "   oPosition = mul(View, v.Position);\n"
     "   oNormal = mul(View, Normal);\n"
     "}\n";
 
@@ -223,9 +321,11 @@ static const char* PostProcessPixelShaderSrc =
     "SamplerState Linear : register(s0);\n"
     "float2 LensCenter;\n"
     "float2 ScreenCenter;\n"
+    "float2 ScreenHalfSize;\n"
     "float2 Scale;\n"
     "float2 ScaleIn;\n"
     "float4 HmdWarpParam;\n"
+    "float4x4 Timewarp;\n"
     "\n"
 
     // Scales input texture coordinates for distortion.
@@ -244,8 +344,32 @@ static const char* PostProcessPixelShaderSrc =
     " in float2 oTexCoord : TEXCOORD0) : SV_Target\n"
     "{\n"
     "   float2 tc = HmdWarp(oTexCoord);\n"
-    "   if (any(clamp(tc, ScreenCenter-float2(0.25,0.5), ScreenCenter+float2(0.25, 0.5)) - tc))\n"
+    // Timewarp moves the sample to where the head pointed when the scene was rendered.
+    "   float4 tw = mul(Timewarp, float4(tc,0,1));\n"
+    "   if (tw.w <= 0)\n"
     "       return 0;\n"
+    "   tc = tw.xy / tw.w;\n"
+    "   if (any(clamp(tc, ScreenCenter-ScreenHalfSize, ScreenCenter+ScreenHalfSize) - tc))\n"
+    "       return 0;\n"
+    "   return Texture.Sample(Linear, tc);\n"
+    "}\n";
+
+// Distortion mesh counterpart of PostProcessPixelShaderSrc: texture coordinates are
+// already distorted, with alpha of 0 outside of the eye's image.
+static const char* PostProcessMeshPixelShaderSrc =
+    "Texture2D Texture : register(t0);\n"
+    "SamplerState Linear : register(s0);\n"
+    "float2 ScreenCenter;\n"
+    "float2 ScreenHalfSize;\n"
+    "float4x4 Timewarp;\n"
+    "float4 main(in float4 oPosition : SV_Position, in float4 oColor : COLOR,\n"
+    " in float2 oTexCoord : TEXCOORD0) : SV_Target\n"
+    "{\n"
+    "   float4 tw = mul(Timewarp, float4(oTexCoord,0,1));\n"
+    "   float2 tc = tw.xy / tw.w;\n"
+    "   if (oColor.a <= 0.4 || tw.w <= 0 ||\n"
+    "       any(clamp(tc, ScreenCenter-ScreenHalfSize, ScreenCenter+ScreenHalfSize) - tc))\n"
+    "       discard;\n"
     "   return Texture.Sample(Linear, tc);\n"
     "}\n";
 
@@ -266,7 +390,8 @@ static const char* FShaderSrcs[FShader_Count] =
     PostProcessPixelShaderSrc,
     LitSolidPixelShaderSrc,
     LitTexturePixelShaderSrc,
-    MultiTexturePixelShaderSrc
+    MultiTexturePixelShaderSrc,
+    PostProcessMeshPixelShaderSrc
 };
 
 RenderDevice::RenderDevice(const RendererParams& p, HWND window)
@@ -279,6 +404,12 @@ RenderDevice::RenderDevice(const RendererParams& p, HWND window)
     WindowHeight = height;
     Window = window;
 
+    for(int i = 0; i < GPUFrameTimer_Count; i++)
+        GPUFrameTimers[i].Pending = false;
+    CurGPUFrameTimer    = 0;
+    GPUFrameTimerActive = false;
+    GPUFrameTime        = -1.0f;
+
     Params = p;
     HRESULT hr = CreateDXGIFactory(__uuidof(IDXGIFactory), (void**)(&DXGIFactory.GetRawRef()));
     if (FAILED(hr))    
@@ -339,11 +470,32 @@ RenderDevice::RenderDevice(const RendererParams& p, HWND window)
         MaxTextureSet[i] = 0;
     }
 
-    ID3D10Blob* vsData = CompileShader("vs_4_0", DirectVertexShaderSrc);
-    VertexShaders[VShader_MV] = *new VertexShader(this, vsData);
-    for(int i = 1; i < VShader_Count; i++)
+    // Each vertex format gets its own model vertex shaders and input layout; the layout
+    // is checked against the MV shader, which takes the same inputs as the MVP one.
+    for(int f = 0; f < VertexFormat_Count; f++)
+    {
+        for(int i = VShader_MV; i < ModelVShader_Count; i++)
+        {
+            String src = ModelVertexSrcs[f];
+            src += VShaderSrcs[i];
+            ID3D10Blob* vsData = CompileShader("vs_4_0", src.ToCStr());
+            ModelVertexShaders[f][i] = *new VertexShader(this, vsData);
+
+            if (i == VShader_MV)
+            {
+                HRESULT validate = Device->CreateInputLayout(ModelVertexLayouts[f].Desc, ModelVertexLayouts[f].Count,
+                                                             vsData->GetBufferPointer(), vsData->GetBufferSize(),
+                                                             &ModelVertexIL[f].GetRawRef());
+                OVR_UNUSED(validate);
+            }
+        }
+    }
+    for(int i = 0; i < VShader_Count; i++)
     {
-        VertexShaders[i] = *new VertexShader(this, CompileShader("vs_4_0", VShaderSrcs[i]));
+        if (i < ModelVShader_Count)
+            VertexShaders[i] = ModelVertexShaders[VertexFormat_Standard][i];
+        else
+            VertexShaders[i] = *new VertexShader(this, CompileShader("vs_4_0", VShaderSrcs[i]));
     }
 
     for(int i = 0; i < FShader_Count; i++)
@@ -351,13 +503,6 @@ RenderDevice::RenderDevice(const RendererParams& p, HWND window)
         PixelShaders[i] = *new PixelShader(this, CompileShader("ps_4_0", FShaderSrcs[i]));
     }
 
-    SPInt bufferSize = vsData->GetBufferSize();
-    const void* buffer = vsData->GetBufferPointer();
-    ID3D1xInputLayout** objRef = &ModelVertexIL.GetRawRef();
-
-    HRESULT validate = Device->CreateInputLayout(ModelVertexDesc, 5, buffer, bufferSize, objRef);
-    OVR_UNUSED(validate);
-
     Ptr<ShaderSet> gouraudShaders = *new ShaderSet();
     gouraudShaders->SetShader(VertexShaders[VShader_MVP]);
     gouraudShaders->SetShader(PixelShaders[FShader_Gouraud]);
@@ -728,7 +873,7 @@ void RenderDevice::Clear(float r, float g, float b, float a, float depth)
 
         SetDepthMode(true, true, Compare_Always);
 
-        Context->IASetInputLayout(ModelVertexIL);
+        Context->IASetInputLayout(ModelVertexIL[VertexFormat_Standard]);
 #if (OVR_D3D_VERSION == 10)
         Context->GSSetShader(NULL);
 #else
@@ -1467,7 +1612,7 @@ Texture* RenderDevice::CreateTexture(int format, int width, int height, const vo
         D3D1x_(TEXTURE2D_DESC) dsDesc;
         dsDesc.Width     = width;
         dsDesc.Height    = height;
-        dsDesc.MipLevels = (format == (Texture_RGBA | Texture_GenMipmaps) && data) ? GetNumMipLevels(width, height) : 1;
+        dsDesc.MipLevels = (format == (Texture_RGBA | Texture_GenMipmaps) && data) ? GetNumMipLevels(width, height) : mipcount;
         dsDesc.ArraySize = 1;
         dsDesc.Format    = d3dformat;
         dsDesc.SampleDesc.Count = samples;
@@ -1539,6 +1684,19 @@ Texture* RenderDevice::CreateTexture(int format, int width, int height, const vo
                     OVR_FREE(mipmaps);
                 }
             }
+            else
+            {
+                // Levels after the first follow it in 'data'.
+                const UByte* mipData = (const UByte*)data + width * height * bpp;
+                int          mipw    = width, miph = height;
+                for (int level = 1; level < mipcount; level++)
+                {
+                    mipw = Alg::Max(mipw >> 1, 1);
+                    miph = Alg::Max(miph >> 1, 1);
+                    Context->UpdateSubresource(NewTex->Tex, level, NULL, mipData, mipw * bpp, mipw * miph * bpp);
+                    mipData += mipw * miph * bpp;
+                }
+            }
         }
 
         if (format & Texture_RenderTarget)
@@ -1607,54 +1765,118 @@ void RenderDevice::SetWorldUniforms(const Matrix4f& proj)
 }
 
 
-void RenderDevice::Render(const Matrix4f& matrix, Model* model)
+void RenderDevice::initModelBuffers(Model* model)
 {
     // Store data in buffers if not already
     if (!model->VertexBuffer)
     {
         Ptr<Buffer> vb = *CreateBuffer();
-        vb->Data(Buffer_Vertex, &model->Vertices[0], model->Vertices.GetSize() * sizeof(Vertex));
+        if (model->Format == VertexFormat_Standard)
+        {
+            vb->Data(Buffer_Vertex, &model->Vertices[0], model->Vertices.GetSize() * sizeof(Vertex));
+        }
+        else
+        {
+            UPInt size = model->Vertices.GetSize() * GetVertexSize(model->Format);
+            void* data = OVR_ALLOC(size);
+            ConvertVertices(model->Format, &model->Vertices[0], model->Vertices.GetSize(), data);
+            vb->Data(Buffer_Vertex, data, size);
+            OVR_FREE(data);
+        }
         model->VertexBuffer = vb;
     }
     if (!model->IndexBuffer)
     {
         Ptr<Buffer> ib = *CreateBuffer();
-        ib->Data(Buffer_Index, &model->Indices[0], model->Indices.GetSize() * 2);
+        if (model->GetIndexSize() == sizeof(UInt32))
+        {
+            ib->Data(Buffer_Index, &model->Indices[0], model->Indices.GetSize() * sizeof(UInt32));
+        }
+        else
+        {
+            Array<UInt16> indices;
+            indices.Resize(model->Indices.GetSize());
+            for (UPInt i = 0; i < indices.GetSize(); i++)
+            {
+                indices[i] = (UInt16)model->Indices[i];
+            }
+            ib->Data(Buffer_Index, &indices[0], indices.GetSize() * sizeof(UInt16));
+        }
         model->IndexBuffer = ib;
     }
+}
 
-    Render(model->Fill ? model->Fill : DefaultFill,
-           model->VertexBuffer, model->IndexBuffer,
-           matrix, 0, (unsigned)model->Indices.GetSize(), model->GetPrimType());
+void RenderDevice::Render(const Matrix4f& matrix, Model* model)
+{
+    IndexRange all = { 0, (int)model->Indices.GetSize() };
+    Render(matrix, model, &all, 1);
 }
 
-void RenderDevice::Render(const Fill* fill, Render::Buffer* vertices, Render::Buffer* indices,
-                          const Matrix4f& matrix, int offset, int count, PrimitiveType rprim)
+void RenderDevice::Render(const Matrix4f& matrix, Model* model, const IndexRange* ranges, int rangeCount)
+{
+    initModelBuffers(model);
+
+    const Fill* fill = model->Fill ? model->Fill : DefaultFill;
+    if (!setDrawState(fill, model->VertexBuffer, model->IndexBuffer, (int)model->GetIndexSize(),
+                      0, model->GetPrimType(), model->Format))
+    {
+        return;
+    }
+    setViewUniforms(fill, matrix, model->Format);
+
+    for (int i = 0; i < rangeCount; i++)
+    {
+        Context->DrawIndexed(ranges[i].Count, ranges[i].Start, 0);
+    }
+}
+
+void RenderDevice::RenderStereo(const Matrix4f& world, Model* model)
+{
+    IndexRange all = { 0, (int)model->Indices.GetSize() };
+    RenderStereo(world, model, &all, 1);
+}
+
+void RenderDevice::RenderStereo(const Matrix4f& world, Model* model, const IndexRange* ranges, int rangeCount)
+{
+    initModelBuffers(model);
+
+    // Buffers, shaders and the fill's uniforms and textures are the same for both
+    // eyes; only the viewport, the matrices and the lighting change between draws.
+    const Fill* fill = model->Fill ? model->Fill : DefaultFill;
+    if (!setDrawState(fill, model->VertexBuffer, model->IndexBuffer, (int)model->GetIndexSize(),
+                      0, model->GetPrimType(), model->Format))
+    {
+        return;
+    }
+
+    for (int eye = 0; eye < 2; eye++)
+    {
+        applyStereoView(eye);
+        setViewUniforms(fill, StereoViews[eye].View * world, model->Format);
+        for (int i = 0; i < rangeCount; i++)
+        {
+            Context->DrawIndexed(ranges[i].Count, ranges[i].Start, 0);
+        }
+    }
+}
+
+bool RenderDevice::setDrawState(const Fill* fill, Render::Buffer* vertices, Render::Buffer* indices, int indexSize,
+                                int offset, PrimitiveType rprim, VertexFormat format)
 {
-    Context->IASetInputLayout(ModelVertexIL);
+    Context->IASetInputLayout(ModelVertexIL[format]);
     if (indices)
     {
-        Context->IASetIndexBuffer(((Buffer*)indices)->GetBuffer(), DXGI_FORMAT_R16_UINT, 0);
+        Context->IASetIndexBuffer(((Buffer*)indices)->GetBuffer(),
+                                  (indexSize == sizeof(UInt32)) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
     }
 
     ID3D1xBuffer* vertexBuffer = ((Buffer*)vertices)->GetBuffer();
-    UINT vertexStride = sizeof(Vertex);
+    UINT vertexStride = (UINT)GetVertexSize(format);
     UINT vertexOffset = offset;
     Context->IASetVertexBuffers(0, 1, &vertexBuffer, &vertexStride, &vertexOffset);
 
     ShaderSet* shaders = ((ShaderFill*)fill)->GetShaders();
 
-    ShaderBase* vshader = ((ShaderBase*)shaders->GetShader(Shader_Vertex));
-    unsigned char* vertexData = vshader->UniformData;
-    if (vertexData)
-    {
-        StandardUniformData* stdUniforms = (StandardUniformData*) vertexData;
-        stdUniforms->View = matrix.Transposed();
-        stdUniforms->Proj = StdUniforms.Proj;
-        UniformBuffers[Shader_Vertex]->Data(Buffer_Uniform, vertexData, vshader->UniformsSize);
-        vshader->SetUniformBuffer(UniformBuffers[Shader_Vertex]);
-    }
-
     for(int i = Shader_Vertex + 1; i < Shader_Count; i++)
         if (shaders->GetShader(i))
         {
@@ -1676,15 +1898,64 @@ void RenderDevice::Render(const Fill* fill, Render::Buffer* vertices, Render::Bu
         break;
     default:
         assert(0);
-        return;
+        return false;
     }
     Context->IASetPrimitiveTopology(prim);
 
     fill->Set(rprim);
+    if (format != VertexFormat_Standard)
+    {
+        getVertexShader(fill, format)->Set(rprim);
+    }
     if (ExtraShaders)
     {
         ExtraShaders->Set(rprim);
     }
+    return true;
+}
+
+ShaderBase* RenderDevice::getVertexShader(const Fill* fill, VertexFormat format)
+{
+    ShaderBase* vshader = (ShaderBase*)((ShaderFill*)fill)->GetShaders()->GetShader(Shader_Vertex);
+    if (format == VertexFormat_Standard)
+    {
+        return vshader;
+    }
+
+    for (int i = VShader_MV; i < ModelVShader_Count; i++)
+    {
+        if (vshader == ModelVertexShaders[VertexFormat_Standard][i])
+        {
+            return ModelVertexShaders[format][i];
+        }
+    }
+    // Other vertex shaders only take the standard format.
+    OVR_ASSERT(0);
+    return vshader;
+}
+
+void RenderDevice::setViewUniforms(const Fill* fill, const Matrix4f& matrix, VertexFormat format)
+{
+    ShaderBase* vshader = getVertexShader(fill, format);
+    unsigned char* vertexData = vshader->UniformData;
+    if (vertexData)
+    {
+        StandardUniformData* stdUniforms = (StandardUniformData*) vertexData;
+        stdUniforms->View = matrix.Transposed();
+        stdUniforms->Proj = StdUniforms.Proj;
+        UniformBuffers[Shader_Vertex]->Data(Buffer_Uniform, vertexData, vshader->UniformsSize);
+        vshader->SetUniformBuffer(UniformBuffers[Shader_Vertex]);
+    }
+}
+
+void RenderDevice::Render(const Fill* fill, Render::Buffer* vertices, Render::Buffer* indices,
+                          const Matrix4f& matrix, int offset, int count, PrimitiveType rprim)
+{
+    if (!setDrawState(fill, vertices, indices, sizeof(UInt16), offset, rprim, VertexFormat_Standard))
+    {
+        return;
+    }
+    setViewUniforms(fill, matrix, VertexFormat_Standard);
 
     if (indices)
     {
@@ -1738,6 +2009,126 @@ void RenderDevice::ForceFlushGPU()
     }
 }
 
+// Frame timing uses a TIMESTAMP query at either end of the frame, inside a
+// TIMESTAMP_DISJOINT query that gives the tick frequency and tells whether the
+// counter stayed valid in between. Results are polled without flushing, so the
+// GPU is never waited on.
+void RenderDevice::BeginGPUFrameTimer()
+{
+    readGPUFrameTimers();
+
+    // If the GPU hasn't finished the frame that last used this set, that frame
+    // goes on being timed and this one isn't.
+    GPUFrameTimer& timer = GPUFrameTimers[CurGPUFrameTimer];
+    if (timer.Pending)
+        return;
+
+    if (!timer.Disjoint)
+    {
+        D3D1x_QUERY_DESC disjointDesc  = { D3D1x_(QUERY_TIMESTAMP_DISJOINT), 0 };
+        D3D1x_QUERY_DESC timestampDesc = { D3D1x_(QUERY_TIMESTAMP), 0 };
+
+        if (FAILED(Device->CreateQuery(&disjointDesc, &timer.Disjoint.GetRawRef())) ||
+            FAILED(Device->CreateQuery(&timestampDesc, &timer.Start.GetRawRef())) ||
+            FAILED(Device->CreateQuery(&timestampDesc, &timer.End.GetRawRef())))
+        {
+            timer.Disjoint = NULL;
+            timer.Start    = NULL;
+            timer.End      = NULL;
+            return;
+        }
+    }
+
+#if (OVR_D3D_VERSION == 10)
+    timer.Disjoint->Begin();
+    // Begin() not used for TIMESTAMP query.
+    timer.Start->End();
+#else
+    Context->Begin(timer.Disjoint);
+    Context->End(timer.Start);
+#endif
+    GPUFrameTimerActive = true;
+}
+
+void RenderDevice::EndGPUFrameTimer()
+{
+    if (!GPUFrameTimerActive)
+        return;
+
+    GPUFrameTimer& timer = GPUFrameTimers[CurGPUFrameTimer];
+#if (OVR_D3D_VERSION == 10)
+    timer.End->End();
+    timer.Disjoint->End();
+#else
+    Context->End(timer.End);
+    Context->End(timer.Disjoint);
+#endif
+    timer.Pending       = true;
+    GPUFrameTimerActive = false;
+    CurGPUFrameTimer    = (CurGPUFrameTimer + 1) % GPUFrameTimer_Count;
+}
+
+float RenderDevice::GetGPUFrameTime()
+{
+    readGPUFrameTimers();
+    return GPUFrameTime;
+}
+
+// Collects the results of the sets the GPU is done with, oldest first; the
+// newest of them becomes GPUFrameTime.
+void RenderDevice::readGPUFrameTimers()
+{
+    for(int i = 0; i < GPUFrameTimer_Count; i++)
+    {
+        GPUFrameTimer& timer = GPUFrameTimers[(CurGPUFrameTimer + i) % GPUFrameTimer_Count];
+        if (!timer.Pending)
+            continue;
+
+        D3D1x_(QUERY_DATA_TIMESTAMP_DISJOINT) disjoint;
+        UINT64                                start, end;
+        UINT                                  flags = D3D1x_(ASYNC_GETDATA_DONOTFLUSH);
+
+#if (OVR_D3D_VERSION == 10)
+        if (timer.Disjoint->GetData(&disjoint, sizeof(disjoint), flags) != S_OK ||
+            timer.Start->GetData(&start, sizeof(start), flags) != S_OK ||
+            timer.End->GetData(&end, sizeof(end), flags) != S_OK)
+            break;
+#else
+        if (Context->GetData(timer.Disjoint, &disjoint, sizeof(disjoint), flags) != S_OK ||
+            Context->GetData(timer.Start, &start, sizeof(start), flags) != S_OK ||
+            Context->GetData(timer.End, &end, sizeof(end), flags) != S_OK)
+            break;
+#endif
+        timer.Pending = false;
+
+        // Timestamps are meaningless if the clock changed during the frame, e.g.
+        // because of a power state change.
+        if (!disjoint.Disjoint && disjoint.Frequency > 0 && end >= start)
+            GPUFrameTime = float(double(end - start) / double(disjoint.Frequency));
+    }
+}
+
+float RenderDevice::GetRefreshRate()
+{
+    Ptr<IDXGIOutput> output;
+    if (!SwapChain || FAILED(SwapChain->GetContainingOutput(&output.GetRawRef())))
+        return 0;
+
+    DXGI_OUTPUT_DESC desc;
+    if (FAILED(output->GetDesc(&desc)))
+        return 0;
+
+    DEVMODEW mode;
+    memset(&mode, 0, sizeof(mode));
+    mode.dmSize = sizeof(mode);
+    // Frequencies of 0 and 1 stand for the hardware's default rate.
+    if (!EnumDisplaySettingsW(desc.DeviceName, ENUM_CURRENT_SETTINGS, &mode) ||
+        mode.dmDisplayFrequency <= 1)
+        return 0;
+
+    return float(mode.dmDisplayFrequency);
+}
+
 
 void RenderDevice::FillRect(float left, float top, float right, float bottom, Color c)
 {
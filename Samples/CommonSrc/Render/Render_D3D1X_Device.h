@@ -256,7 +256,7 @@ public:
 
     Ptr<ID3D1xDepthStencilState> DepthStates[1 + 2 * Compare_Count];
     Ptr<ID3D1xDepthStencilState> CurDepthState;
-    Ptr<ID3D1xInputLayout>      ModelVertexIL;
+    Ptr<ID3D1xInputLayout>      ModelVertexIL[VertexFormat_Count];
 
     Ptr<ID3D1xSamplerState>     SamplerStates[Sample_Count];
 
@@ -269,6 +269,10 @@ public:
     int                      MaxTextureSet[Shader_Count];
 
     Ptr<VertexShader>        VertexShaders[VShader_Count];
+    // Variants of the MV and MVP shaders for each vertex format; those of the
+    // standard format are the ones in VertexShaders.
+    enum { ModelVShader_Count = VShader_MVP + 1 };
+    Ptr<VertexShader>        ModelVertexShaders[VertexFormat_Count][ModelVShader_Count];
     Ptr<PixelShader>         PixelShaders[FShader_Count];
     Ptr<GeomShader>          pStereoShaders[Prim_Count];
     Ptr<Buffer>              CommonUniforms[8];
@@ -279,6 +283,32 @@ public:
 
     Array<Ptr<Texture> >     DepthBuffers;
 
+    // Timestamp queries of the frames in flight; a set is read back once the GPU
+    // has passed it, which can take a few frames.
+    enum { GPUFrameTimer_Count = 4 };
+    struct GPUFrameTimer
+    {
+        Ptr<ID3D1xQuery>     Disjoint;
+        Ptr<ID3D1xQuery>     Start;
+        Ptr<ID3D1xQuery>     End;
+        bool                 Pending;
+    };
+    GPUFrameTimer            GPUFrameTimers[GPUFrameTimer_Count];
+    int                      CurGPUFrameTimer;
+    bool                     GPUFrameTimerActive;
+    float                    GPUFrameTime;
+
+    void readGPUFrameTimers();
+
+    void initModelBuffers(Model* model);
+    // Binds the buffers, shaders and fill uniforms of a draw; false if the
+    // primitive type isn't supported.
+    bool setDrawState(const Fill* fill, Render::Buffer* vertices, Render::Buffer* indices, int indexSize,
+                      int offset, PrimitiveType prim, VertexFormat format);
+    // Vertex shader of the fill, or its variant for the format.
+    ShaderBase* getVertexShader(const Fill* fill, VertexFormat format);
+    void setViewUniforms(const Fill* fill, const Matrix4f& matrix, VertexFormat format);
+
 public:
     RenderDevice(const RendererParams& p, HWND window);
     ~RenderDevice();
@@ -296,6 +326,11 @@ public:
     virtual void Present();
     virtual void ForceFlushGPU();
 
+    virtual void  BeginGPUFrameTimer();
+    virtual void  EndGPUFrameTimer();
+    virtual float GetGPUFrameTime();
+    virtual float GetRefreshRate();
+
     virtual bool SetFullscreen(DisplayMode fullscreen);
 	virtual UPInt QueryGPUMemorySize();
 
@@ -333,6 +368,9 @@ public:
 	virtual void RenderText(const struct Font* font, const char* str, float x, float y, float size, Color c);
 
     virtual void Render(const Matrix4f& matrix, Model* model);
+    virtual void Render(const Matrix4f& matrix, Model* model, const IndexRange* ranges, int rangeCount);
+    virtual void RenderStereo(const Matrix4f& world, Model* model);
+    virtual void RenderStereo(const Matrix4f& world, Model* model, const IndexRange* ranges, int rangeCount);
     virtual void Render(const Fill* fill, Render::Buffer* vertices, Render::Buffer* indices,
                         const Matrix4f& matrix, int offset, int count, PrimitiveType prim = Prim_Triangles);
 
@@ -25,27 +25,467 @@ limitations under the License.
 #include "../Render/Render_Font.h"
 
 #include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Profiler.h"
+
+// Frustum and CollisionModel test four planes at a time with SSE.
+#if defined(OVR_CPU_SSE) && (defined(__SSE__) || defined(OVR_CPU_X86_64) || defined(OVR_CC_MSVC))
+#define OVR_RENDER_SSE
+#include <xmmintrin.h>
+#endif
 
 namespace OVR { namespace Render {
 
+//-----------------------------------------------------------------------------------
+// ***** Bounds
+
+// Column k of the upper 3x3 of 'm', which is where local axis k ends up.
+static Vector3f GetMatrixAxis(const Matrix4f& m, int k)
+{
+    return Vector3f(m.M[0][k], m.M[1][k], m.M[2][k]);
+}
+
+// Largest factor by which 'm' scales a length.
+static float GetMatrixMaxScale(const Matrix4f& m)
+{
+    float s = Alg::Max(GetMatrixAxis(m, 0).LengthSq(),
+                       Alg::Max(GetMatrixAxis(m, 1).LengthSq(), GetMatrixAxis(m, 2).LengthSq()));
+    return sqrt(s);
+}
+
+void Bounds::AddBox(const Bounds& b, const Matrix4f& m)
+{
+    if (b.IsEmpty())
+        return;
+
+    // Extent of the transformed box along each parent axis.
+    Vector3f c = m.Transform((b.Min + b.Max) * 0.5f);
+    Vector3f h = (b.Max - b.Min) * 0.5f;
+    Vector3f e(fabs(m.M[0][0]) * h.x + fabs(m.M[0][1]) * h.y + fabs(m.M[0][2]) * h.z,
+               fabs(m.M[1][0]) * h.x + fabs(m.M[1][1]) * h.y + fabs(m.M[1][2]) * h.z,
+               fabs(m.M[2][0]) * h.x + fabs(m.M[2][1]) * h.y + fabs(m.M[2][2]) * h.z);
+    AddPoint(c - e);
+    AddPoint(c + e);
+}
+
+void Bounds::BeginSphere()
+{
+    if (IsEmpty())
+        return;
+    Center = (Min + Max) * 0.5f;
+    Radius = 0.0f;
+}
+
+void Bounds::EnclosePoint(const Vector3f& p)
+{
+    Radius = Alg::Max(Radius, (p - Center).Length());
+}
+
+void Bounds::EncloseSphere(const Bounds& b, const Matrix4f& m)
+{
+    if (b.IsEmpty() || IsEmpty())
+        return;
+    float r = (m.Transform(b.Center) - Center).Length() + b.Radius * GetMatrixMaxScale(m);
+    Radius  = Alg::Min(Alg::Max(Radius, r), ((Max - Min) * 0.5f).Length());
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Frustum
+
+void Frustum::Set(const Matrix4f& viewProj)
+{
+    const Matrix4f& m = viewProj;
+
+    // Each plane is row 3 plus or minus another row; clip space z is in [0,1], so the
+    // near plane is row 2 alone. The last two planes are padding that contains every point.
+    static const int   rowIndex[GroupCount * 4] = { 0, 0, 1, 1, 2, 2, 0, 0 };
+    static const float rowSign[GroupCount * 4]  = { 1, -1, 1, -1, 1, -1, 0, 0 };
+    static const float row3[GroupCount * 4]     = { 1, 1, 1, 1, 0, 1, 0, 0 };
+
+    for (int i = 0; i < GroupCount * 4; i++)
+    {
+        float p[4];
+        for (int j = 0; j < 4; j++)
+            p[j] = row3[i] * m.M[3][j] + rowSign[i] * m.M[rowIndex[i]][j];
+
+        // An orthographic projection with row 2 zero has no depth planes.
+        float len = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (len < 1e-6f)
+        {
+            PlaneX[i] = PlaneY[i] = PlaneZ[i] = 0.0f;
+            PlaneW[i] = 1.0f;
+        }
+        else
+        {
+            PlaneX[i] = p[0] / len;
+            PlaneY[i] = p[1] / len;
+            PlaneZ[i] = p[2] / len;
+            PlaneW[i] = p[3] / len;
+        }
+    }
+}
+
+bool Frustum::TestBounds(const Bounds& b, const Matrix4f& m) const
+{
+    if (b.IsEmpty())
+        return false;
+
+    Vector3f c      = m.Transform(b.Center);
+    float    radius = b.Radius * GetMatrixMaxScale(m);
+    // Half extents of the box along its transformed axes; the box and sphere share their center.
+    Vector3f h      = (b.Max - b.Min) * 0.5f;
+    Vector3f ax     = GetMatrixAxis(m, 0) * h.x;
+    Vector3f ay     = GetMatrixAxis(m, 1) * h.y;
+    Vector3f az     = GetMatrixAxis(m, 2) * h.z;
+
+#ifdef OVR_RENDER_SSE
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 r        = _mm_set1_ps(radius);
+    const __m128 negR     = _mm_set1_ps(-radius);
+
+    for (int g = 0; g < GroupCount; g++)
+    {
+        __m128 px = _mm_loadu_ps(PlaneX + g * 4);
+        __m128 py = _mm_loadu_ps(PlaneY + g * 4);
+        __m128 pz = _mm_loadu_ps(PlaneZ + g * 4);
+        __m128 d  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(c.x)),
+                                          _mm_mul_ps(py, _mm_set1_ps(c.y))),
+                               _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(c.z)),
+                                          _mm_loadu_ps(PlaneW + g * 4)));
+
+        if (_mm_movemask_ps(_mm_cmplt_ps(d, negR)))
+            return false;
+        if (!_mm_movemask_ps(_mm_cmplt_ps(d, r)))
+            continue;
+
+        // The sphere crosses a plane; the box may still be entirely behind it.
+        __m128 dx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(ax.x)), _mm_mul_ps(py, _mm_set1_ps(ax.y))),
+                               _mm_mul_ps(pz, _mm_set1_ps(ax.z)));
+        __m128 dy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(ay.x)), _mm_mul_ps(py, _mm_set1_ps(ay.y))),
+                               _mm_mul_ps(pz, _mm_set1_ps(ay.z)));
+        __m128 dz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(az.x)), _mm_mul_ps(py, _mm_set1_ps(az.y))),
+                               _mm_mul_ps(pz, _mm_set1_ps(az.z)));
+        __m128 boxR = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, dx), _mm_andnot_ps(signMask, dy)),
+                                 _mm_andnot_ps(signMask, dz));
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, boxR), _mm_setzero_ps())))
+            return false;
+    }
+#else
+    for (int i = 0; i < PlaneCount; i++)
+    {
+        Vector3f n(PlaneX[i], PlaneY[i], PlaneZ[i]);
+        float    d = n * c + PlaneW[i];
+
+        if (d < -radius)
+            return false;
+        if (d >= radius)
+            continue;
+
+        float boxR = fabs(n * ax) + fabs(n * ay) + fabs(n * az);
+        if (d + boxR < 0.0f)
+            return false;
+    }
+#endif
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------
+// ***** Vertex formats
+
+UInt16 FloatToHalf(float f)
+{
+    union { float f; UInt32 u; } bits;
+    bits.f = f;
+
+    UInt32 sign     = (bits.u >> 16) & 0x8000;
+    int    exponent = int((bits.u >> 23) & 0xff) - 127 + 15;
+    UInt32 mantissa = bits.u & 0x7fffff;
+
+    if (((bits.u >> 23) & 0xff) == 0xff)
+        return UInt16(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return UInt16(sign | 0x7c00);
+    if (exponent <= 0)
+    {
+        // Denormal, or too small even for that.
+        if (exponent < -10)
+            return UInt16(sign);
+        mantissa |= 0x800000;
+        UInt32 shift = UInt32(14 - exponent);
+        UInt32 half  = (mantissa >> shift) + ((mantissa >> (shift - 1)) & 1);
+        return UInt16(sign | half);
+    }
+
+    // Rounds to nearest; a carry out of the mantissa correctly increments the exponent.
+    UInt32 half = sign | (UInt32(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+        half++;
+    return UInt16(half);
+}
+
+void EncodeOctNormal(const Vector3f& n, SInt16 encoded[2])
+{
+    float x = 0, y = 0;
+    float l1 = fabs(n.x) + fabs(n.y) + fabs(n.z);
+    if (l1 > 0)
+    {
+        x = n.x / l1;
+        y = n.y / l1;
+    }
+    // The lower hemisphere is folded over the diagonals.
+    if (n.z < 0)
+    {
+        float ox = x;
+        x = (1.0f - fabs(y))  * ((ox >= 0) ? 1.0f : -1.0f);
+        y = (1.0f - fabs(ox)) * ((y >= 0)  ? 1.0f : -1.0f);
+    }
+    encoded[0] = (SInt16)floor(Alg::Clamp(x, -1.0f, 1.0f) * 32767.0f + 0.5f);
+    encoded[1] = (SInt16)floor(Alg::Clamp(y, -1.0f, 1.0f) * 32767.0f + 0.5f);
+}
+
+UPInt GetVertexSize(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat_Compact:    return sizeof(CompactVertex);
+    case VertexFormat_CompactUV2: return sizeof(CompactVertexUV2);
+    case VertexFormat_Depth:      return sizeof(Vector3f);
+    default:                      return sizeof(Vertex);
+    }
+}
+
+void ConvertVertices(VertexFormat format, const Vertex* vertices, UPInt count, void* dest)
+{
+    for (UPInt i = 0; i < count; i++)
+    {
+        const Vertex& v = vertices[i];
+        switch (format)
+        {
+        case VertexFormat_Compact:
+            {
+                CompactVertex& c = ((CompactVertex*)dest)[i];
+                c.Pos   = v.Pos;
+                c.C     = v.C;
+                c.UV[0] = FloatToHalf(v.U);
+                c.UV[1] = FloatToHalf(v.V);
+                EncodeOctNormal(v.Norm, c.Norm);
+            }
+            break;
+        case VertexFormat_CompactUV2:
+            {
+                CompactVertexUV2& c = ((CompactVertexUV2*)dest)[i];
+                c.Pos    = v.Pos;
+                c.C      = v.C;
+                c.UV[0]  = FloatToHalf(v.U);
+                c.UV[1]  = FloatToHalf(v.V);
+                EncodeOctNormal(v.Norm, c.Norm);
+                c.UV2[0] = FloatToHalf(v.U2);
+                c.UV2[1] = FloatToHalf(v.V2);
+            }
+            break;
+        case VertexFormat_Depth:
+            ((Vector3f*)dest)[i] = v.Pos;
+            break;
+        default:
+            ((Vertex*)dest)[i] = v;
+            break;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------------
+
+bool Model::SetCompactFormat(bool secondUVs)
+{
+    assert(!VertexBuffer);
+
+    for (UPInt i = 0; i < Vertices.GetSize(); i++)
+    {
+        const Vertex& v = Vertices[i];
+        if ((fabs(v.U) > 2.0f) || (fabs(v.V) > 2.0f))
+            return false;
+        if (secondUVs && ((fabs(v.U2) > 2.0f) || (fabs(v.V2) > 2.0f)))
+            return false;
+    }
+    Format = secondUVs ? VertexFormat_CompactUV2 : VertexFormat_Compact;
+    return true;
+}
+
+void Model::UpdateBounds()
+{
+    ModelBounds.Clear();
+    for (UPInt i = 0; i < Vertices.GetSize(); i++)
+        ModelBounds.AddPoint(Vertices[i].Pos);
+
+    ModelBounds.BeginSphere();
+    for (UPInt i = 0; i < Vertices.GetSize(); i++)
+        ModelBounds.EnclosePoint(Vertices[i].Pos);
+    BoundsValid = true;
+}
+
 void Model::Render(const Matrix4f& ltw, RenderDevice* ren)
 {
     if(Visible)
     {
     Matrix4f m = ltw * GetMatrix();
+    const Frustum* frustum = ren->GetCullFrustum();
+    if (frustum && !frustum->TestBounds(*GetBounds(), m))
+        return;
     ren->Render(m, this);
     }
 }
 
+void Model::RenderStereo(const Matrix4f& ltw, RenderDevice* ren)
+{
+    if(Visible)
+    {
+        Matrix4f m = ltw * GetMatrix();
+        if (ren->IsStereoVisible(*GetBounds(), m))
+            ren->RenderStereo(m, this);
+    }
+}
+
+void ModelBatch::AddModel(const Model* model)
+{
+    OVR_ASSERT(CanAdd(model));
+
+    // Normals are transformed by the inverse transpose, which is correct for scaled models too.
+    const Matrix4f& m            = model->GetMatrix();
+    Matrix4f        normalMatrix = m.Inverted().Transposed();
+    UInt32          base         = GetNextVertexIndex();
+
+    Range range;
+    range.Indices.Start = (int)Indices.GetSize();
+    range.Indices.Count = (int)model->Indices.GetSize();
+
+    for (UPInt i = 0; i < model->Vertices.GetSize(); i++)
+    {
+        Vertex v = model->Vertices[i];
+        v.Pos    = m.Transform(v.Pos);
+        v.Norm   = normalMatrix.Transform(v.Norm);
+        if (v.Norm.LengthSq() > 0.0f)
+            v.Norm.Normalize();
+        AddVertex(v);
+        range.RangeBounds.AddPoint(v.Pos);
+    }
+    range.RangeBounds.BeginSphere();
+    for (UPInt i = base; i < Vertices.GetSize(); i++)
+        range.RangeBounds.EnclosePoint(Vertices[i].Pos);
+
+    for (UPInt i = 0; i < model->Indices.GetSize(); i++)
+        Indices.PushBack(base + model->Indices[i]);
+
+    Ranges.PushBack(range);
+}
+
+void ModelBatch::cullRanges(const Matrix4f& m, RenderDevice* ren, bool stereo)
+{
+    const Frustum* frustum = ren->GetCullFrustum();
+    VisibleRanges.Clear();
+
+    for (UPInt i = 0; i < Ranges.GetSize(); i++)
+    {
+        const Range& range = Ranges[i];
+        bool visible = stereo ? ren->IsStereoVisible(range.RangeBounds, m) :
+                       (!frustum || frustum->TestBounds(range.RangeBounds, m));
+        if (!visible)
+            continue;
+
+        UPInt n = VisibleRanges.GetSize();
+        if (n && (VisibleRanges[n - 1].Start + VisibleRanges[n - 1].Count == range.Indices.Start))
+            VisibleRanges[n - 1].Count += range.Indices.Count;
+        else
+            VisibleRanges.PushBack(range.Indices);
+    }
+}
+
+void ModelBatch::Render(const Matrix4f& ltw, RenderDevice* ren)
+{
+    if (!Visible)
+        return;
+
+    Matrix4f m = ltw * GetMatrix();
+    const Frustum* frustum = ren->GetCullFrustum();
+    if (frustum && !frustum->TestBounds(*GetBounds(), m))
+        return;
+
+    cullRanges(m, ren, false);
+    if (VisibleRanges.GetSize())
+        ren->Render(m, this, &VisibleRanges[0], (int)VisibleRanges.GetSize());
+}
+
+void ModelBatch::RenderStereo(const Matrix4f& ltw, RenderDevice* ren)
+{
+    if (!Visible)
+        return;
+
+    Matrix4f m = ltw * GetMatrix();
+    if (!ren->IsStereoVisible(*GetBounds(), m))
+        return;
+
+    cullRanges(m, ren, true);
+    if (VisibleRanges.GetSize())
+        ren->RenderStereo(m, this, &VisibleRanges[0], (int)VisibleRanges.GetSize());
+}
+
+const Bounds* Container::GetBounds()
+{
+    if (BoundsState == Bounds_Invalid)
+    {
+        BoundsState = Bounds_Valid;
+        ContainerBounds.Clear();
+        for (UPInt i = 0; i < Nodes.GetSize(); i++)
+        {
+            const Bounds* b = Nodes[i]->GetBounds();
+            if (!b)
+            {
+                BoundsState = Bounds_Unknown;
+                break;
+            }
+            ContainerBounds.AddBox(*b, Nodes[i]->GetMatrix());
+        }
+
+        if (BoundsState == Bounds_Valid)
+        {
+            ContainerBounds.BeginSphere();
+            for (UPInt i = 0; i < Nodes.GetSize(); i++)
+                ContainerBounds.EncloseSphere(*Nodes[i]->GetBounds(), Nodes[i]->GetMatrix());
+        }
+    }
+    return (BoundsState == Bounds_Valid) ? &ContainerBounds : NULL;
+}
+
 void Container::Render(const Matrix4f& ltw, RenderDevice* ren)
 {
     Matrix4f m = ltw * GetMatrix();
+    const Frustum* frustum = ren->GetCullFrustum();
+    const Bounds*  bounds  = frustum ? GetBounds() : NULL;
+    if (bounds && !frustum->TestBounds(*bounds, m))
+        return;
+
     for(unsigned i = 0; i < Nodes.GetSize(); i++)
     {
         Nodes[i]->Render(m, ren);
     }
 }
 
+void Container::RenderStereo(const Matrix4f& ltw, RenderDevice* ren)
+{
+    Matrix4f      m      = ltw * GetMatrix();
+    const Bounds* bounds = GetBounds();
+    if (bounds && !ren->IsStereoVisible(*bounds, m))
+        return;
+
+    for(unsigned i = 0; i < Nodes.GetSize(); i++)
+    {
+        Nodes[i]->RenderStereo(m, ren);
+    }
+}
+
 Matrix4f SceneView::GetViewMatrix() const
 {
     Matrix4f view = Matrix4f(GetOrientation().Conj()) * Matrix4f::Translation(GetPosition());
@@ -63,11 +503,94 @@ void LightingParams::Update(const Matrix4f& view, const Vector4f* SceneLightPos)
 
 void Scene::Render(RenderDevice* ren, const Matrix4f& view)
 {
+    OVR_PROFILE_SCOPE("Scene::Render");
+
     Lighting.Update(view, LightPos);
 
     ren->SetLighting(&Lighting);
 
+    // Nodes are rendered with view space matrices, so they are culled against the
+    // projection alone.
+    Frustum frustum(ren->GetProjection());
+    ren->SetCullFrustum(&frustum);
     World.Render(view, ren);
+    ren->SetCullFrustum(NULL);
+}
+
+void Scene::BuildBatches()
+{
+    Array<Ptr<Node> >       nodes;
+    Array<Ptr<ModelBatch> > batches;
+
+    for (UPInt i = 0; i < World.Nodes.GetSize(); i++)
+    {
+        Node* node = World.Nodes[i];
+        if (node->GetType() != Node::Node_Model)
+        {
+            nodes.PushBack(node);
+            continue;
+        }
+
+        Model* model = (Model*)node;
+        if (!model->Visible || model->IsCollisionModel || (model->Type == Prim_TriangleStrip) ||
+            model->Indices.IsEmpty() || (model->GetIndexSize() > sizeof(UInt16)) ||
+            (model->Fill && model->Fill->IsBlended()))
+        {
+            nodes.PushBack(node);
+            continue;
+        }
+
+        // Models sharing a fill go to the last batch that still has room for them.
+        ModelBatch* batch = NULL;
+        for (UPInt j = batches.GetSize(); j > 0; j--)
+        {
+            ModelBatch* b = batches[j - 1];
+            if ((b->Fill == model->Fill) && (b->Type == model->Type) && (b->Format == model->Format) &&
+                b->CanAdd(model))
+            {
+                batch = b;
+                break;
+            }
+        }
+        if (!batch)
+        {
+            batch         = new ModelBatch(model->Type);
+            batch->Fill   = model->Fill;
+            batch->Format = model->Format;
+            batches.PushBack(*batch);
+            nodes.PushBack(batch);
+        }
+        batch->AddModel(model);
+    }
+
+    OVR_DEBUG_LOG(("Scene: %d nodes batched into %d.", (int)World.Nodes.GetSize(), (int)nodes.GetSize()));
+
+    World.Clear();
+    for (UPInt i = 0; i < nodes.GetSize(); i++)
+        World.Add(nodes[i]);
+}
+
+void Scene::Render(RenderDevice* ren, SceneViewCallback* viewCallback, StereoEye eye)
+{
+    Render(ren, viewCallback->GetEyeView(eye));
+}
+
+void Scene::RenderStereo(RenderDevice* ren, SceneViewCallback* viewCallback,
+                         const StereoEyeParams& left, const StereoEyeParams& right)
+{
+    OVR_PROFILE_SCOPE("Scene::RenderStereo");
+
+    Matrix4f views[2] = { viewCallback->GetEyeView(left.Eye),
+                          viewCallback->GetEyeView(right.Eye) };
+
+    // Light positions are in view space, so each eye gets its own copy.
+    LightingParams eyeLighting[2] = { Lighting, Lighting };
+    eyeLighting[0].Update(views[0], LightPos);
+    eyeLighting[1].Update(views[1], LightPos);
+    const LightingParams* lighting[2] = { &eyeLighting[0], &eyeLighting[1] };
+
+    ren->SetStereoViews(left, right, views, lighting);
+    World.RenderStereo(Matrix4f(), ren);
 }
 
 
@@ -122,7 +645,7 @@ Model* Model::CreateAxisFaceColorBox(float x1, float x2, Color xcolor,
 
     Model* box = new Model();
 
-    UInt16 startIndex = 0;
+    UInt32 startIndex = 0;
     // Cube
     startIndex =
         box->AddVertex(Vector3f(x1, y2, z1), ycolor);
@@ -233,7 +756,7 @@ void Model::AddSolidColorBox(float x1, float y1, float z1,
     };
 
 
-    UInt16 startIndex = GetNextVertexIndex();
+    UInt32 startIndex = GetNextVertexIndex();
 
     enum
     {
@@ -398,11 +921,13 @@ void ShaderFill::Set(PrimitiveType prim) const
 RenderDevice::RenderDevice()
     : CurPostProcess(PostProcess_None),
       SceneColorTexW(0), SceneColorTexH(0),
-      SceneRenderScale(1),
+      SceneRenderScale(1), SceneRenderScaleMax(1),
       
       Distortion(1.0f, 0.18f, 0.115f),            
       DistortionClearColor(0, 0, 0),
-      TotalTextureMemoryUsage(0)
+      pDistortionMesh(0), DistortionMeshEye(0),
+      TotalTextureMemoryUsage(0),
+      pCullFrustum(NULL)
 {
 }
 
@@ -411,8 +936,9 @@ Fill* RenderDevice::CreateTextureFill(Render::Texture* t, bool useAlpha)
     ShaderSet* shaders = CreateShaderSet();
     shaders->SetShader(LoadBuiltinShader(Shader_Vertex, VShader_MVP));
     shaders->SetShader(LoadBuiltinShader(Shader_Fragment, useAlpha ? FShader_AlphaTexture : FShader_Texture));
-    Fill* f = new ShaderFill(*shaders);
+    ShaderFill* f = new ShaderFill(*shaders);
     f->SetTexture(0, t);
+    f->SetBlended(useAlpha);
     return f;
 }
 
@@ -433,6 +959,57 @@ void RenderDevice::SetLighting(const LightingParams* lt)
     SetCommonUniformBuffer(1, LightingBuffer);
 }
 
+void RenderDevice::SetStereoViews(const StereoEyeParams& left, const StereoEyeParams& right,
+                                  const Matrix4f views[2], const LightingParams* lighting[2])
+{
+    const StereoEyeParams* params[2] = { &left, &right };
+
+    for (int eye = 0; eye < 2; eye++)
+    {
+        StereoView& sv = StereoViews[eye];
+        sv.VP         = params[eye]->VP;
+        sv.Projection = params[eye]->Projection;
+        sv.View       = views[eye];
+        sv.CullFrustum.Set(sv.Projection * sv.View);
+
+        if (!sv.LightingBuffer)
+            sv.LightingBuffer = *CreateBuffer();
+        sv.LightingBuffer->Data(Buffer_Uniform, lighting[eye], sizeof(LightingParams));
+    }
+}
+
+void RenderDevice::applyStereoView(int eye)
+{
+    const StereoView& sv = StereoViews[eye];
+    SetViewport(sv.VP);
+    SetProjection(sv.Projection);
+    SetCommonUniformBuffer(1, sv.LightingBuffer);
+}
+
+bool RenderDevice::IsStereoVisible(const Bounds& b, const Matrix4f& world) const
+{
+    return StereoViews[0].CullFrustum.TestBounds(b, world) ||
+           StereoViews[1].CullFrustum.TestBounds(b, world);
+}
+
+void RenderDevice::RenderStereo(const Matrix4f& world, Model* model)
+{
+    for (int eye = 0; eye < 2; eye++)
+    {
+        applyStereoView(eye);
+        Render(StereoViews[eye].View * world, model);
+    }
+}
+
+void RenderDevice::RenderStereo(const Matrix4f& world, Model* model, const IndexRange* ranges, int rangeCount)
+{
+    for (int eye = 0; eye < 2; eye++)
+    {
+        applyStereoView(eye);
+        Render(StereoViews[eye].View * world, model, ranges, rangeCount);
+    }
+}
+
 float RenderDevice::MeasureText(const Font* font, const char* str, float size, float* strsize)
 {
     UPInt length = strlen(str);
@@ -608,7 +1185,21 @@ void RenderDevice::GetStereoViewports(const Viewport& in, Viewport* out) const
 void RenderDevice::SetSceneRenderScale(float ss)
 {
     SceneRenderScale = ss;
-    pSceneColorTex = NULL;
+    if (ss > SceneRenderScaleMax)
+    {
+        SceneRenderScaleMax = ss;
+        pSceneColorTex = NULL;
+    }
+}
+
+void RenderDevice::SetMaxSceneRenderScale(float ss)
+{
+    if (ss != SceneRenderScaleMax)
+    {
+        SceneRenderScaleMax = ss;
+        pSceneColorTex = NULL;
+    }
+    SceneRenderScale = Alg::Min(SceneRenderScale, ss);
 }
 
 void RenderDevice::SetViewport(const Viewport& vp)
@@ -638,8 +1229,8 @@ bool RenderDevice::initPostProcessSupport(PostProcessType pptype)
         return true;
     }
 
-    int texw = (int)ceil(SceneRenderScale * WindowWidth),
-        texh = (int)ceil(SceneRenderScale * WindowHeight);
+    int texw = (int)ceil(SceneRenderScaleMax * WindowWidth),
+        texh = (int)ceil(SceneRenderScaleMax * WindowHeight);
 
     // If pSceneColorTex is already created and is of correct size, we are done.
     // It's important to check width/height in case window size changed.
@@ -667,6 +1258,16 @@ bool RenderDevice::initPostProcessSupport(PostProcessType pptype)
     pPostProcessShader->SetShader(ppfs);
     }
 
+    if (!pDistortionMeshShader)
+    {
+        // Mesh vertices carry pre-distorted texture coordinates, so only the timewarp
+        // is left to the pixel shader; the alpha of vertices that fall outside of the
+        // eye's image is 0, making the shader discard them.
+        pDistortionMeshShader = *CreateShaderSet();
+        pDistortionMeshShader->SetShader(LoadBuiltinShader(Shader_Vertex, VShader_PostProcess));
+        pDistortionMeshShader->SetShader(LoadBuiltinShader(Shader_Fragment, FShader_PostProcessMesh));
+    }
+
     if(!pFullScreenVertexBuffer)
     {
         pFullScreenVertexBuffer = *CreateBuffer();
@@ -717,6 +1318,8 @@ void RenderDevice::BeginScene(PostProcessType pptype)
 
 void RenderDevice::FinishScene()
 {
+    OVR_PROFILE_SCOPE("FinishScene");
+
     SetExtraShaders(0);
     if(CurPostProcess == PostProcess_None)
     {
@@ -738,10 +1341,15 @@ void RenderDevice::FinishScene1()
     DistortionClearColor.GetRGBA(&r, &g, &b, &a);
     Clear(r, g, b, a);
 
-    float w = float(VP.w) / float(WindowWidth),
-          h = float(VP.h) / float(WindowHeight),
-          x = float(VP.x) / float(WindowWidth),
-          y = float(VP.y) / float(WindowHeight);
+    // The scene was rendered into the part of the texture that the current render
+    // scale covers, which is all of it only at SceneRenderScaleMax.
+    float usedW = SceneRenderScale * float(WindowWidth)  / float(SceneColorTexW),
+          usedH = SceneRenderScale * float(WindowHeight) / float(SceneColorTexH);
+
+    float w = usedW * float(VP.w) / float(WindowWidth),
+          h = usedH * float(VP.h) / float(WindowHeight),
+          x = usedW * float(VP.x) / float(WindowWidth),
+          y = usedH * float(VP.y) / float(WindowHeight);
 
     float as = float(VP.w) / float(VP.h);
 
@@ -750,6 +1358,7 @@ void RenderDevice::FinishScene1()
     pPostProcessShader->SetUniform2f("LensCenter",
                                      x + (w + Distortion.XCenterOffset * 0.5f)*0.5f, y + h*0.5f);
     pPostProcessShader->SetUniform2f("ScreenCenter", x + w*0.5f, y + h*0.5f);
+    pPostProcessShader->SetUniform2f("ScreenHalfSize", w*0.5f, h*0.5f);
 
     // MA: This is more correct but we would need higher-res texture vertically; we should adopt this
     // once we have asymmetric input texture scale.
@@ -766,6 +1375,35 @@ void RenderDevice::FinishScene1()
                   0, 0, 0, 1);
     pPostProcessShader->SetUniform4x4f("Texm", texm);
 
+    // The timewarp matrix works in [-1,1] coordinates of the eye, +Y up; shaders
+    // apply it to texture coordinates.
+    Matrix4f eyeToTex(w*0.5f, 0,       0, x + w*0.5f,
+                      0,      -h*0.5f, 0, y + h*0.5f,
+                      0,      0,       1, 0,
+                      0,      0,       0, 1);
+    Matrix4f timewarp = eyeToTex * TimewarpMatrix * eyeToTex.Inverted();
+    pPostProcessShader->SetUniform4x4f("Timewarp", timewarp);
+
+    if (pDistortionMesh && !pDistortionMesh->IsEmpty())
+    {
+        DistortionMeshBuffers& buffers = DistortionMeshCache[DistortionMeshEye];
+        if (!buffers.pVertices || (buffers.pSource != pDistortionMesh) ||
+            (buffers.Version != pDistortionMesh->Version))
+        {
+            updateDistortionMeshBuffers(buffers, *pDistortionMesh);
+        }
+
+        // Mesh positions are already in [-1,1] viewport coordinates.
+        pDistortionMeshShader->SetUniform4x4f("Texm", texm);
+        pDistortionMeshShader->SetUniform4x4f("Timewarp", timewarp);
+        pDistortionMeshShader->SetUniform2f("ScreenCenter", x + w*0.5f, y + h*0.5f);
+        pDistortionMeshShader->SetUniform2f("ScreenHalfSize", w*0.5f, h*0.5f);
+        ShaderFill meshFill(pDistortionMeshShader);
+        meshFill.SetTexture(0, pSceneColorTex);
+        Render(&meshFill, buffers.pVertices, buffers.pIndices, Matrix4f(), 0, buffers.IndexCount);
+        return;
+    }
+
     Matrix4f view(2, 0, 0, -1,
                   0, 2, 0, -1,
                    0, 0, 0, 0,
@@ -776,13 +1414,71 @@ void RenderDevice::FinishScene1()
     Render(&fill, pFullScreenVertexBuffer, NULL, view, 0, 4, Prim_TriangleStrip);
 }
 
+void RenderDevice::updateDistortionMeshBuffers(DistortionMeshBuffers& buffers, const DistortionMesh& mesh)
+{
+    Array<Vertex> vertices;
+    vertices.Reserve(mesh.Vertices.GetSize());
+    for (UPInt i = 0; i < mesh.Vertices.GetSize(); i++)
+    {
+        const DistortionMeshVertex& mv = mesh.Vertices[i];
+        vertices.PushBack(Vertex(Vector3f(mv.ScreenPosX, mv.ScreenPosY, 0),
+                                 Color(255, 255, 255, UByte(mv.Shade * 255.0f)), mv.TexU, mv.TexV));
+    }
+
+    if (!buffers.pVertices)
+    {
+        buffers.pVertices = *CreateBuffer();
+        buffers.pIndices  = *CreateBuffer();
+    }
+    buffers.pVertices->Data(Buffer_Vertex, &vertices[0], vertices.GetSize() * sizeof(Vertex));
+    buffers.pIndices->Data(Buffer_Index, &mesh.Indices[0], mesh.Indices.GetSize() * sizeof(UInt16));
+
+    buffers.pSource    = &mesh;
+    buffers.Version    = mesh.Version;
+    buffers.IndexCount = (int)mesh.Indices.GetSize();
+}
+
+void CollisionModel::Add(const Planef& p)
+{
+    // Padding planes face nowhere and keep every point inside.
+    UPInt count = Planes.GetSize();
+    if ((count & 3) == 0)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            PlaneX.PushBack(0.0f);
+            PlaneY.PushBack(0.0f);
+            PlaneZ.PushBack(0.0f);
+            PlaneW.PushBack(-1.0f);
+        }
+    }
+    Planes.PushBack(p);
+    PlaneX[count] = p.N.x;
+    PlaneY[count] = p.N.y;
+    PlaneZ[count] = p.N.z;
+    PlaneW[count] = p.D;
+}
+
 bool CollisionModel::TestPoint(const Vector3f& p) const
 {
+#ifdef OVR_RENDER_SSE
+    const __m128 x = _mm_set1_ps(p.x), y = _mm_set1_ps(p.y), z = _mm_set1_ps(p.z);
+    for (UPInt g = 0; g < PlaneX.GetSize(); g += 4)
+    {
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&PlaneX[g]), x),
+                                         _mm_mul_ps(_mm_loadu_ps(&PlaneY[g]), y)),
+                              _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&PlaneZ[g]), z),
+                                         _mm_loadu_ps(&PlaneW[g])));
+        if (_mm_movemask_ps(_mm_cmpgt_ps(d, _mm_setzero_ps())))
+            return 0;
+    }
+#else
     for(unsigned i = 0; i < Planes.GetSize(); i++)
         if(Planes[i].TestSide(p) > 0)
         {
             return 0;
         }
+#endif
 
     return 1;
 }
@@ -792,7 +1488,10 @@ bool CollisionModel::TestRay(const Vector3f& origin, const Vector3f& norm, float
     if(TestPoint(origin))
     {
         len = 0;
-        *ph = Planes[0];
+        if(ph)
+        {
+            *ph = Planes[0];
+        }
         return true;
     }
     Vector3f fullMove = origin + norm * len;
@@ -800,34 +1499,60 @@ bool CollisionModel::TestRay(const Vector3f& origin, const Vector3f& norm, float
     int crossing = -1;
     float cdot1 = 0, cdot2 = 0;
 
-    for(unsigned i = 0; i < Planes.GetSize(); ++i)
+    for(unsigned g = 0; g < PlaneX.GetSize(); g += 4)
     {
-        float dot2 = Planes[i].TestSide(fullMove);
-        if(dot2 > 0)
+        float dot1[4], dot2[4];
+        int   crossed;
+#ifdef OVR_RENDER_SSE
+        __m128 px = _mm_loadu_ps(&PlaneX[g]), py = _mm_loadu_ps(&PlaneY[g]);
+        __m128 pz = _mm_loadu_ps(&PlaneZ[g]), pw = _mm_loadu_ps(&PlaneW[g]);
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(fullMove.x)),
+                                          _mm_mul_ps(py, _mm_set1_ps(fullMove.y))),
+                               _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(fullMove.z)), pw));
+        if(_mm_movemask_ps(_mm_cmpgt_ps(d2, _mm_setzero_ps())))
         {
             return false;
         }
-        float dot1 = Planes[i].TestSide(origin);
-        if(dot1 > 0)
+        __m128 d1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(origin.x)),
+                                          _mm_mul_ps(py, _mm_set1_ps(origin.y))),
+                               _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(origin.z)), pw));
+        crossed = _mm_movemask_ps(_mm_cmpgt_ps(d1, _mm_setzero_ps()));
+        if(!crossed)
+        {
+            continue;
+        }
+        _mm_storeu_ps(dot1, d1);
+        _mm_storeu_ps(dot2, d2);
+#else
+        crossed = 0;
+        for(int k = 0; k < 4; k++)
+        {
+            Vector3f n(PlaneX[g + k], PlaneY[g + k], PlaneZ[g + k]);
+            dot2[k] = n * fullMove + PlaneW[g + k];
+            if(dot2[k] > 0)
+            {
+                return false;
+            }
+            dot1[k] = n * origin + PlaneW[g + k];
+            if(dot1[k] > 0)
+            {
+                crossed |= 1 << k;
+            }
+        }
+#endif
+
+        // Of the planes the ray crosses, the one it ends up nearest to is kept.
+        for(int k = 0; k < 4; k++)
         {
-            if(dot2 <= 0)
+            if(!(crossed & (1 << k)))
+            {
+                continue;
+            }
+            if(crossing == -1 || dot2[k] > cdot2)
             {
-                //assert(crossing==-1);
-				if(crossing == -1)
-				{
-					crossing = i;
-					cdot2 = dot2;
-					cdot1 = dot1;
-				}
-				else
-				{
-					if(dot2 > cdot2)
-					{
-						crossing = i;
-						cdot2 = dot2;
-						cdot1 = dot1;
-					}
-				}
+                crossing = g + k;
+                cdot2 = dot2[k];
+                cdot1 = dot1[k];
             }
         }
     }
@@ -855,6 +1580,214 @@ bool CollisionModel::TestRay(const Vector3f& origin, const Vector3f& norm, float
     return true;
 }
 
+// The ray enters the hull at the last plane it crosses inwards, 'tEnter', and leaves
+// it at the first it crosses outwards, 'tExit'.
+static bool finishClipRay(float tEnter, float tExit, int enterPlane, float len, float& t, int& plane)
+{
+    if (tEnter > tExit)
+        return false;
+
+    // The origin is inside when no plane is crossed on the way in after it.
+    if ((enterPlane < 0) || (tEnter <= 0))
+    {
+        if (tExit < 0)
+            return false;
+        t     = 0;
+        plane = -1;
+        return true;
+    }
+    if (tEnter > len)
+        return false;
+
+    t     = tEnter;
+    plane = enterPlane;
+    return true;
+}
+
+bool CollisionModel::ClipRay(const Vector3f& origin, const Vector3f& norm, float len, float& t, int& plane) const
+{
+    float tEnter = -Math<float>::MaxValue, tExit = Math<float>::MaxValue;
+    int   enterPlane = -1;
+
+#ifdef OVR_RENDER_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+    const __m128 nx = _mm_set1_ps(norm.x), ny = _mm_set1_ps(norm.y), nz = _mm_set1_ps(norm.z);
+    __m128 enter4 = _mm_set1_ps(-Math<float>::MaxValue), exit4 = _mm_set1_ps(Math<float>::MaxValue);
+    __m128 plane4 = _mm_set1_ps(-1.0f), index4 = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    // Each lane keeps its own entry and exit over every fourth plane.
+    for (UPInt g = 0; g < PlaneX.GetSize(); g += 4)
+    {
+        __m128 px = _mm_loadu_ps(&PlaneX[g]), py = _mm_loadu_ps(&PlaneY[g]), pz = _mm_loadu_ps(&PlaneZ[g]);
+        __m128 dist  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, ox), _mm_mul_ps(py, oy)),
+                                  _mm_add_ps(_mm_mul_ps(pz, oz), _mm_loadu_ps(&PlaneW[g])));
+        __m128 speed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, nx), _mm_mul_ps(py, ny)), _mm_mul_ps(pz, nz));
+
+        // A ray running along a plane it is outside of never gets in.
+        if (_mm_movemask_ps(_mm_and_ps(_mm_cmpeq_ps(speed, zero), _mm_cmpgt_ps(dist, zero))))
+            return false;
+
+        __m128 crossT = _mm_div_ps(_mm_sub_ps(zero, dist), speed);
+        __m128 enters = _mm_and_ps(_mm_cmplt_ps(speed, zero), _mm_cmpgt_ps(crossT, enter4));
+        __m128 exits  = _mm_and_ps(_mm_cmpgt_ps(speed, zero), _mm_cmplt_ps(crossT, exit4));
+        enter4 = _mm_or_ps(_mm_and_ps(enters, crossT), _mm_andnot_ps(enters, enter4));
+        plane4 = _mm_or_ps(_mm_and_ps(enters, index4), _mm_andnot_ps(enters, plane4));
+        exit4  = _mm_or_ps(_mm_and_ps(exits, crossT), _mm_andnot_ps(exits, exit4));
+        index4 = _mm_add_ps(index4, _mm_set1_ps(4.0f));
+    }
+
+    float enters[4], exits[4], planes[4];
+    _mm_storeu_ps(enters, enter4);
+    _mm_storeu_ps(exits, exit4);
+    _mm_storeu_ps(planes, plane4);
+    for (int k = 0; k < 4; k++)
+    {
+        if (enters[k] > tEnter)
+        {
+            tEnter     = enters[k];
+            enterPlane = (int)planes[k];
+        }
+        tExit = Alg::Min(tExit, exits[k]);
+    }
+#else
+    for (UPInt i = 0; i < Planes.GetSize(); i++)
+    {
+        float dist  = Planes[i].TestSide(origin);
+        float speed = Planes[i].N * norm;
+        if (speed < 0)
+        {
+            float crossT = -dist / speed;
+            if (crossT > tEnter)
+            {
+                tEnter     = crossT;
+                enterPlane = (int)i;
+            }
+        }
+        else if (speed > 0)
+            tExit = Alg::Min(tExit, -dist / speed);
+        else if (dist > 0)
+            return false;
+    }
+#endif
+
+    return finishClipRay(tEnter, tExit, enterPlane, len, t, plane);
+}
+
+void CollisionModel::ClipRays(const CollisionRay* rays, int count, float* ts, int* planes) const
+{
+#ifdef OVR_RENDER_SSE
+    const __m128 zero = _mm_setzero_ps();
+
+    // Rays are taken four at a time, one per lane, and tested against one plane at a
+    // time; a partial group repeats its last ray.
+    for (int first = 0; first < count; first += 4)
+    {
+        float o[3][4], n[3][4];
+        for (int k = 0; k < 4; k++)
+        {
+            const CollisionRay& ray = rays[Alg::Min(first + k, count - 1)];
+            o[0][k] = ray.Origin.x; o[1][k] = ray.Origin.y; o[2][k] = ray.Origin.z;
+            n[0][k] = ray.Norm.x;   n[1][k] = ray.Norm.y;   n[2][k] = ray.Norm.z;
+        }
+        __m128 ox = _mm_loadu_ps(o[0]), oy = _mm_loadu_ps(o[1]), oz = _mm_loadu_ps(o[2]);
+        __m128 nx = _mm_loadu_ps(n[0]), ny = _mm_loadu_ps(n[1]), nz = _mm_loadu_ps(n[2]);
+        __m128 enter4 = _mm_set1_ps(-Math<float>::MaxValue), exit4 = _mm_set1_ps(Math<float>::MaxValue);
+        __m128 plane4 = _mm_set1_ps(-1.0f), missed = zero;
+
+        for (UPInt i = 0; i < Planes.GetSize(); i++)
+        {
+            __m128 px = _mm_set1_ps(PlaneX[i]), py = _mm_set1_ps(PlaneY[i]), pz = _mm_set1_ps(PlaneZ[i]);
+            __m128 dist  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, ox), _mm_mul_ps(py, oy)),
+                                      _mm_add_ps(_mm_mul_ps(pz, oz), _mm_set1_ps(PlaneW[i])));
+            __m128 speed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, nx), _mm_mul_ps(py, ny)), _mm_mul_ps(pz, nz));
+            missed = _mm_or_ps(missed, _mm_and_ps(_mm_cmpeq_ps(speed, zero), _mm_cmpgt_ps(dist, zero)));
+
+            __m128 crossT = _mm_div_ps(_mm_sub_ps(zero, dist), speed);
+            __m128 enters = _mm_and_ps(_mm_cmplt_ps(speed, zero), _mm_cmpgt_ps(crossT, enter4));
+            __m128 exits  = _mm_and_ps(_mm_cmpgt_ps(speed, zero), _mm_cmplt_ps(crossT, exit4));
+            enter4 = _mm_or_ps(_mm_and_ps(enters, crossT), _mm_andnot_ps(enters, enter4));
+            plane4 = _mm_or_ps(_mm_and_ps(enters, _mm_set1_ps((float)i)), _mm_andnot_ps(enters, plane4));
+            exit4  = _mm_or_ps(_mm_and_ps(exits, crossT), _mm_andnot_ps(exits, exit4));
+        }
+
+        float enters[4], exits[4], hitPlanes[4];
+        int   missMask = _mm_movemask_ps(missed);
+        _mm_storeu_ps(enters, enter4);
+        _mm_storeu_ps(exits, exit4);
+        _mm_storeu_ps(hitPlanes, plane4);
+        for (int k = 0; (k < 4) && (first + k < count); k++)
+        {
+            int i = first + k;
+            if ((missMask & (1 << k)) ||
+                !finishClipRay(enters[k], exits[k], (int)hitPlanes[k], rays[i].Len, ts[i], planes[i]))
+            {
+                ts[i]     = -1.0f;
+                planes[i] = -1;
+            }
+        }
+    }
+#else
+    for (int i = 0; i < count; i++)
+    {
+        if (!ClipRay(rays[i].Origin, rays[i].Norm, rays[i].Len, ts[i], planes[i]))
+        {
+            ts[i]     = -1.0f;
+            planes[i] = -1;
+        }
+    }
+#endif
+}
+
+// The box is found from the corners where three of the planes meet. The planes are
+// closed off by a large box first; a corner on that box means the hull is open on
+// that side.
+bool CollisionModel::GetBounds(Bounds* bounds) const
+{
+    const float   limit = 100000.0f;
+    Array<Planef> planes;
+    for (UPInt i = 0; i < Planes.GetSize(); i++)
+        planes.PushBack(Planes[i]);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        Vector3f n(axis == 0 ? 1.0f : 0, axis == 1 ? 1.0f : 0, axis == 2 ? 1.0f : 0);
+        planes.PushBack(Planef(n, -limit));
+        planes.PushBack(Planef(-n, -limit));
+    }
+
+    bounds->Clear();
+    for (UPInt i = 0; i < planes.GetSize(); i++)
+    {
+        for (UPInt j = i + 1; j < planes.GetSize(); j++)
+        {
+            Vector3f nij = planes[i].N.Cross(planes[j].N);
+            for (UPInt k = j + 1; k < planes.GetSize(); k++)
+            {
+                float det = nij * planes[k].N;
+                if (fabsf(det) < 1e-6f)
+                    continue;
+
+                Vector3f corner = (planes[j].N.Cross(planes[k].N) * planes[i].D +
+                                   planes[k].N.Cross(planes[i].N) * planes[j].D +
+                                   nij * planes[k].D) / -det;
+
+                float tolerance = 0.001f * Alg::Max(1.0f, Alg::Max(fabsf(corner.x),
+                                                    Alg::Max(fabsf(corner.y), fabsf(corner.z))));
+                bool  inside    = true;
+                for (UPInt p = 0; (p < planes.GetSize()) && inside; p++)
+                    inside = planes[p].TestSide(corner) <= tolerance;
+                if (inside)
+                    bounds->AddPoint(corner);
+            }
+        }
+    }
+
+    return !bounds->IsEmpty() &&
+           (bounds->Min.x > -limit * 0.5f) && (bounds->Max.x < limit * 0.5f) &&
+           (bounds->Min.y > -limit * 0.5f) && (bounds->Max.y < limit * 0.5f) &&
+           (bounds->Min.z > -limit * 0.5f) && (bounds->Max.z < limit * 0.5f);
+}
+
 int GetNumMipLevels(int w, int h)
 {
     int n = 1;
@@ -906,4 +1839,19 @@ int GetTextureSize(int format, int w, int h)
     return 0;
 }
 
+Texture* CreateTextureFromImage(RenderDevice* ren, const TextureImage& image)
+{
+    if (image.Data.GetSize() == 0)
+    {
+        return NULL;
+    }
+
+    Texture* out = ren->CreateTexture(image.Format, image.Width, image.Height, &image.Data[0], image.MipCount);
+    if (out && image.Clamp)
+    {
+        out->SetSampleMode(Sample_Clamp);
+    }
+    return out;
+}
+
 }}
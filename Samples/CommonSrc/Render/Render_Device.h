@@ -65,6 +65,10 @@ public:
     virtual void Unset() const {}
 
     virtual void SetTexture(int i, class Texture* tex) { OVR_UNUSED2(i,tex); }
+
+    // True if the fill is drawn with alpha blending, so that the order in which
+    // its models are drawn matters.
+    virtual bool IsBlended() const { return false; }
 };
 
 enum ShaderStage
@@ -91,7 +95,8 @@ enum BuiltinShaders
     FShader_LitGouraud  = 5,
     FShader_LitTexture  = 6,
 	FShader_MultiTexture= 7,
-    FShader_Count       = 8,
+    FShader_PostProcessMesh = 8,
+    FShader_Count       = 9,
 };
 
 
@@ -263,14 +268,18 @@ class ShaderFill : public Fill
 {
     Ptr<ShaderSet> Shaders;
     Ptr<Texture>   Textures[8];
+    bool           Blended;
 
 public:
-    ShaderFill(ShaderSet* sh) : Shaders(sh) {  }
-    ShaderFill(ShaderSet& sh) : Shaders(sh) {  }
+    ShaderFill(ShaderSet* sh) : Shaders(sh), Blended(false) {  }
+    ShaderFill(ShaderSet& sh) : Shaders(sh), Blended(false) {  }
     void Set(PrimitiveType prim) const;
     ShaderSet* GetShaders() { return Shaders; }
 
     virtual void SetTexture(int i, class Texture* tex) { if (i < 8) Textures[i] = tex; }
+
+    void         SetBlended(bool blended) { Blended = blended; }
+    virtual bool IsBlended() const        { return Blended; }
 };
 
 /* Buffer for vertex or index data. Some renderers require separate buffers, so that
@@ -316,21 +325,110 @@ public:
 
 //-----------------------------------------------------------------------------------
 
+struct Bounds;
+
+// A ray for packet queries: 'Len' is the distance checked along the unit vector 'Norm'.
+struct CollisionRay
+{
+    Vector3f Origin;
+    Vector3f Norm;
+    float    Len;
+};
+
+// Convex hull given by the planes bounding it; points with positive distance to any
+// plane are outside. Planes are also kept component by component in groups of four,
+// padded with planes that are never crossed, so that the tests below handle four
+// planes at a time; both are only changed by Add, which keeps them in step.
 class CollisionModel : public RefCountBase<CollisionModel>
 {
 public:
-	Array<Planef > Planes;
+	void Add(const Planef& p);
 
-	void Add(const Planef& p)
-	{
-		Planes.PushBack(p);
-	}
+	const Array<Planef>& GetPlanes() const { return Planes; }
 
 	// Return whether p is inside this
 	bool TestPoint(const Vector3f& p) const;
 
 	// Assumes that the origin of the ray is outside this.
 	bool TestRay(const Vector3f& origin, const Vector3f& norm, float& len, Planef* ph = NULL) const;
+
+    // Clips the ray against the hull. Returns true if it enters within 'len', setting 't'
+    // to the distance and 'plane' to the index of the plane crossed; an origin inside
+    // the hull hits at 0 with 'plane' -1.
+    bool ClipRay(const Vector3f& origin, const Vector3f& norm, float len, float& t, int& plane) const;
+
+    // ClipRay for several rays at once, four at a time. 'ts' is set to -1 for the rays
+    // that miss.
+    void ClipRays(const CollisionRay* rays, int count, float* ts, int* planes) const;
+
+    // Finds the box enclosing the hull; returns false if the planes don't enclose a
+    // finite volume.
+    bool GetBounds(Bounds* bounds) const;
+
+private:
+    Array<Planef> Planes;
+    Array<float>  PlaneX, PlaneY, PlaneZ, PlaneW;
+};
+
+
+//-----------------------------------------------------------------------------------
+
+// Bounding volume of a node in its own coordinates: an axis-aligned box, and a sphere
+// around the center of the box.
+struct Bounds
+{
+    Vector3f Min, Max;
+    Vector3f Center;
+    float    Radius;
+
+    Bounds() { Clear(); }
+
+    void Clear()
+    {
+        Min    = Vector3f(Math<float>::MaxValue);
+        Max    = Vector3f(-Math<float>::MaxValue);
+        Center = Vector3f(0);
+        Radius = -1.0f;
+    }
+    bool IsEmpty() const { return Min.x > Max.x; }
+
+    // The box is built first, from points or from the bounds of children whose local
+    // to parent matrix is 'm'.
+    void AddPoint(const Vector3f& p)
+    {
+        Min.x = Alg::Min(Min.x, p.x); Max.x = Alg::Max(Max.x, p.x);
+        Min.y = Alg::Min(Min.y, p.y); Max.y = Alg::Max(Max.y, p.y);
+        Min.z = Alg::Min(Min.z, p.z); Max.z = Alg::Max(Max.z, p.z);
+    }
+    void AddBox(const Bounds& b, const Matrix4f& m);
+
+    // The sphere is then centered on the box by BeginSphere, and grown to enclose the
+    // same points or children. It never exceeds the half diagonal of the box.
+    void BeginSphere();
+    void EnclosePoint(const Vector3f& p);
+    void EncloseSphere(const Bounds& b, const Matrix4f& m);
+};
+
+// The six clipping planes of a projection, for culling with Bounds. The planes point
+// into the frustum and are kept as four planes per group, component by component, so
+// that a node is tested against four planes at a time.
+class Frustum
+{
+public:
+    Frustum() { }
+    // 'viewProj' is the projection, or projection times view; bounds tested are then
+    // transformed to view or world space by the matrix passed to TestBounds.
+    Frustum(const Matrix4f& viewProj) { Set(viewProj); }
+
+    void Set(const Matrix4f& viewProj);
+
+    // Returns false if the bounds, transformed by 'm', are entirely outside the frustum.
+    // The sphere is tested first, and the box only against the planes it crosses.
+    bool TestBounds(const Bounds& b, const Matrix4f& m) const;
+
+private:
+    enum { PlaneCount = 6, GroupCount = 2 };
+    float   PlaneX[GroupCount * 4], PlaneY[GroupCount * 4], PlaneZ[GroupCount * 4], PlaneW[GroupCount * 4];
 };
 
 class Node : public RefCountBase<Node>
@@ -384,6 +482,13 @@ public:
     }
 
 	virtual void     Render(const Matrix4f& ltw, RenderDevice* ren) { OVR_UNUSED2(ltw, ren); }
+    // Draws the node for both eyes set with RenderDevice::SetStereoViews; 'ltw' is
+    // the local to world matrix, without the eye views.
+    virtual void     RenderStereo(const Matrix4f& ltw, RenderDevice* ren) { OVR_UNUSED2(ltw, ren); }
+
+    // Bounds of what the node draws, in its own coordinates; null if unknown, in which
+    // case the node is never culled.
+    virtual const Bounds* GetBounds() { return NULL; }
 };
 
 struct Vertex
@@ -410,6 +515,43 @@ struct Vertex
     }
 };
 
+// Layouts of a model's vertex buffer. Model::Vertices are always kept as Vertex; they
+// are converted to the model's format when the buffer is created.
+enum VertexFormat
+{
+    VertexFormat_Standard,      // Vertex, 44 bytes.
+    VertexFormat_Compact,       // CompactVertex, 24 bytes; U2,V2 are taken to be U,V.
+    VertexFormat_CompactUV2,    // CompactVertexUV2, 28 bytes.
+    VertexFormat_Depth,         // Position only, 12 bytes, for depth-only passes.
+    VertexFormat_Count
+};
+
+// UVs are half floats, and the normal is octahedral encoded into two 16-bit snorms.
+struct CompactVertex
+{
+    Vector3f  Pos;
+    Color     C;
+    UInt16    UV[2];
+    SInt16    Norm[2];
+};
+
+struct CompactVertexUV2
+{
+    Vector3f  Pos;
+    Color     C;
+    UInt16    UV[2];
+    SInt16    Norm[2];
+    UInt16    UV2[2];
+};
+
+UInt16 FloatToHalf(float f);
+// Maps a unit normal onto the octahedron folded into [-1,1]^2, as 16-bit snorms.
+void   EncodeOctNormal(const Vector3f& n, SInt16 encoded[2]);
+
+UPInt  GetVertexSize(VertexFormat format);
+// Converts 'count' vertices to 'format'; 'dest' must hold count * GetVertexSize(format) bytes.
+void   ConvertVertices(VertexFormat format, const Vertex* vertices, UPInt count, void* dest);
+
 // this is stored in a uniform buffer, don't change it without fixing all renderers
 struct LightingParams
 {
@@ -432,8 +574,10 @@ class Model : public Node
 {
 public:
     Array<Vertex>     Vertices;
-    Array<UInt16>     Indices;
+    // Indices are kept 32-bit; GetIndexSize gives the width used in the index buffer.
+    Array<UInt32>     Indices;
     PrimitiveType     Type;
+    VertexFormat      Format;
     Ptr<class Fill>   Fill;
     bool              Visible;
 	bool			  IsCollisionModel;
@@ -443,15 +587,37 @@ public:
     Ptr<Buffer>       VertexBuffer;
     Ptr<Buffer>       IndexBuffer;
 
-    Model(PrimitiveType t = Prim_Triangles) : Type(t), Fill(NULL), Visible(true) { }
+    // Computed from the vertices by UpdateBounds, or by GetBounds when first needed.
+    Bounds            ModelBounds;
+    bool              BoundsValid;
+
+    Model(PrimitiveType t = Prim_Triangles)
+        : Type(t), Format(VertexFormat_Standard), Fill(NULL), Visible(true), IsCollisionModel(false),
+          BoundsValid(false) { }
     ~Model() { }
 
     virtual NodeType GetType() const { return Node_Model; }
 
     virtual void Render(const Matrix4f& ltw, RenderDevice* ren);
+    virtual void RenderStereo(const Matrix4f& ltw, RenderDevice* ren);
+
+    virtual const Bounds* GetBounds()
+    {
+        if (!BoundsValid)
+            UpdateBounds();
+        return &ModelBounds;
+    }
+    // Recomputes the bounds; needed after Vertices are changed directly.
+    void UpdateBounds();
 
     PrimitiveType GetPrimType() const { return Type; }
 
+    // Selects a compact format, with or without the second UV set, if the UVs are
+    // within [-2,2], where half floats keep them within 1/2048. Returns false, leaving
+    // the format as it is, otherwise. Compact formats need the fill to use a built-in
+    // model vertex shader.
+    bool SetCompactFormat(bool secondUVs);
+
     void SetVisible(bool visible) { Visible = visible; }
     bool IsVisible() const        { return Visible; }
 
@@ -462,40 +628,47 @@ public:
     }
 
     // Returns the index next added vertex will have.
-    UInt16 GetNextVertexIndex() const
+    UInt32 GetNextVertexIndex() const
     {
-        return (UInt16)Vertices.GetSize();
+        return (UInt32)Vertices.GetSize();
     }
 
-    UInt16 AddVertex(const Vertex& v)
+    // Index buffers are 16-bit unless there are more vertices than that can address.
+    UPInt  GetIndexSize() const
+    {
+        return (Vertices.GetSize() > 0x10000) ? sizeof(UInt32) : sizeof(UInt16);
+    }
+
+    UInt32 AddVertex(const Vertex& v)
     {
         assert(!VertexBuffer && !IndexBuffer);
-        UInt16 index = (UInt16)Vertices.GetSize();
+        UInt32 index = (UInt32)Vertices.GetSize();
         Vertices.PushBack(v);
+        BoundsValid = false;
         return index;
     }
-    UInt16 AddVertex(const Vector3f& v, const Color& c, float u_ = 0, float v_ = 0)
+    UInt32 AddVertex(const Vector3f& v, const Color& c, float u_ = 0, float v_ = 0)
     {
         return AddVertex(Vertex(v,c,u_,v_));
     }
-    UInt16 AddVertex(float x, float y, float z, const Color& c, float u, float v)
+    UInt32 AddVertex(float x, float y, float z, const Color& c, float u, float v)
     {
         return AddVertex(Vertex(Vector3f(x,y,z),c, u,v));
     }
 
-    void AddLine(UInt16 a, UInt16 b)
+    void AddLine(UInt32 a, UInt32 b)
     {
         Indices.PushBack(a);
         Indices.PushBack(b);
     }
 
-    UInt16 AddVertex(float x, float y, float z, const Color& c,
+    UInt32 AddVertex(float x, float y, float z, const Color& c,
                      float u, float v, float nx, float ny, float nz)
     {
         return AddVertex(Vertex(Vector3f(x,y,z),c, u,v, Vector3f(nx,ny,nz)));
     }
 
-	UInt16 AddVertex(float x, float y, float z, const Color& c,
+	UInt32 AddVertex(float x, float y, float z, const Color& c,
                      float u1, float v1, float u2, float v2, float nx, float ny, float nz)
     {
         return AddVertex(Vertex(Vector3f(x,y,z), c, u1, v1, u2, v2, Vector3f(nx,ny,nz)));
@@ -506,7 +679,7 @@ public:
         AddLine(AddVertex(a), AddVertex(b));
     }
 
-    void AddTriangle(UInt16 a, UInt16 b, UInt16 c)
+    void AddTriangle(UInt32 a, UInt32 b, UInt32 c)
     {
         Indices.PushBack(a);
         Indices.PushBack(b);
@@ -536,6 +709,46 @@ public:
 							 Color minor = Color(64,64,64,192), Color major = Color(128,128,128,192));
 };
 
+// Range of a model's indices, drawn with RenderDevice::Render and RenderStereo.
+struct IndexRange
+{
+    int Start, Count;
+};
+
+// Static models sharing a fill, merged by Scene::BuildBatches into one model whose
+// vertices are in the space of the batch's parent. Each source model keeps its range
+// of indices, with bounds, so the ranges are culled separately; visible ranges that
+// are adjacent are drawn together.
+class ModelBatch : public Model
+{
+public:
+    struct Range
+    {
+        IndexRange  Indices;
+        Bounds      RangeBounds;
+    };
+    Array<Range>    Ranges;
+
+    ModelBatch(PrimitiveType t = Prim_Triangles) : Model(t) { }
+
+    virtual void Render(const Matrix4f& ltw, RenderDevice* ren);
+    virtual void RenderStereo(const Matrix4f& ltw, RenderDevice* ren);
+
+    // Returns false if the batch would no longer fit 16-bit indices.
+    bool CanAdd(const Model* model) const
+    {
+        return Vertices.GetSize() + model->Vertices.GetSize() <= 0x10000;
+    }
+    // Appends the model, transformed by its matrix, as a new range.
+    void AddModel(const Model* model);
+
+private:
+    // Collects the ranges that pass the frustum test, merging adjacent ones.
+    void cullRanges(const Matrix4f& m, RenderDevice* ren, bool stereo);
+
+    Array<IndexRange> VisibleRanges;
+};
+
 class Container : public Node
 {
 public:
@@ -555,14 +768,39 @@ public:
     virtual NodeType GetType() const { return Node_Container; }
 
     virtual void Render(const Matrix4f& ltw, RenderDevice* ren);
+    virtual void RenderStereo(const Matrix4f& ltw, RenderDevice* ren);
+
+    // Encloses the bounds of all children, including hidden ones. The bounds are cached;
+    // InvalidateBounds must be called when children are moved or their vertices change.
+    virtual const Bounds* GetBounds();
+    void InvalidateBounds() { BoundsState = Bounds_Invalid; }
 
-    void Add(Node *n) { Nodes.PushBack(n); }
-	void Add(Model *n, class Fill *f) { n->Fill = f; Nodes.PushBack(n); }
-	void Clear() { Nodes.Clear(); }
+    void Add(Node *n) { Nodes.PushBack(n); InvalidateBounds(); }
+	void Add(Model *n, class Fill *f) { n->Fill = f; Nodes.PushBack(n); InvalidateBounds(); }
+	void Clear() { Nodes.Clear(); InvalidateBounds(); }
 
 	bool               CollideChildren;
 
-	Container() : CollideChildren(1) {}
+	Container() : CollideChildren(1), BoundsState(Bounds_Invalid) {}
+
+private:
+    enum BoundsStateType
+    {
+        Bounds_Invalid,
+        Bounds_Valid,
+        Bounds_Unknown      // A child has no bounds.
+    };
+    Bounds             ContainerBounds;
+    BoundsStateType    BoundsState;
+};
+
+// SceneViewCallback supplies the view matrix of an eye to Scene::Render right before
+// the eye is drawn, so that the view can follow the latest head orientation.
+class SceneViewCallback
+{
+public:
+    virtual ~SceneViewCallback() { }
+    virtual Matrix4f GetEyeView(StereoEye eye) = 0;
 };
 
 class Scene
@@ -575,6 +813,21 @@ public:
 
 public:
     void Render(RenderDevice* ren, const Matrix4f& view);
+    // Renders the scene for 'eye' with the view returned by the callback.
+    void Render(RenderDevice* ren, SceneViewCallback* viewCallback, StereoEye eye);
+    // Renders the scene for both eyes in a single traversal, drawing each model once
+    // per eye. Viewports and projections are taken from the eye parameters, views
+    // from the callback; clearing both viewports is left to the caller.
+    void RenderStereo(RenderDevice* ren, SceneViewCallback* viewCallback,
+                      const StereoEyeParams& left, const StereoEyeParams& right);
+
+    // Replaces the models directly in World that are visible and not collision models
+    // with a ModelBatch for each fill, primitive type and vertex format, each at the
+    // place of its first model. Batched models are no longer drawn from Models, so
+    // changing them has no effect on rendering. Triangle strips, models that need
+    // 32-bit indices, and models with blended fills are left as they are; merging
+    // the latter would move them in the draw order, which blending depends on.
+    void BuildBatches();
 
     void SetAmbient(Vector4f color)
     {
@@ -677,14 +930,53 @@ protected:
     Ptr<ShaderSet>  pPostProcessShader;
     Ptr<Buffer>     pFullScreenVertexBuffer;
     float           SceneRenderScale;
+    // Scale that pSceneColorTex is allocated for; smaller render scales only
+    // shrink the viewport, so the texture is not recreated when they change.
+    float           SceneRenderScaleMax;
     DistortionConfig Distortion;
     Color           DistortionClearColor;
+
+    // When a distortion mesh is set, FinishScene draws it instead of running
+    // the per-pixel distortion shader. GPU copies are kept for each eye.
+    struct DistortionMeshBuffers
+    {
+        Ptr<Buffer>             pVertices;
+        Ptr<Buffer>             pIndices;
+        const DistortionMesh*   pSource;
+        UInt32                  Version;
+        int                     IndexCount;
+
+        DistortionMeshBuffers() : pSource(0), Version(0), IndexCount(0) { }
+    };
+    const DistortionMesh*  pDistortionMesh;
+    int                    DistortionMeshEye;
+    DistortionMeshBuffers  DistortionMeshCache[2];
+    Ptr<ShaderSet>         pDistortionMeshShader;
+    // Reprojection of the next FinishScene, in [-1,1] viewport coordinates of the eye.
+    Matrix4f               TimewarpMatrix;
     UPInt			TotalTextureMemoryUsage;
 
     // For lighting on platforms with uniform buffers
     Ptr<Buffer>     LightingBuffer;
 
+    // Eye state of single-traversal stereo rendering, set by SetStereoViews.
+    struct StereoView
+    {
+        Viewport        VP;
+        Matrix4f        Projection;
+        Matrix4f        View;
+        Frustum         CullFrustum;    // In world space.
+        Ptr<Buffer>     LightingBuffer;
+    };
+    StereoView      StereoViews[2];
+
+    const Frustum*  pCullFrustum;
+
+    // Makes the viewport, projection and lighting of the eye current.
+    void applyStereoView(int eye);
+
     void FinishScene1();
+    void updateDistortionMeshBuffers(DistortionMeshBuffers& buffers, const DistortionMesh& mesh);
 
 public:
     enum CompareFunc
@@ -717,6 +1009,8 @@ public:
         SetProjection(params.Projection);
         if (params.pDistortion)
             SetDistortionConfig(*params.pDistortion, params.Eye);
+        SetDistortionMesh(params.pDistortionMesh, params.Eye);
+        SetTimewarpMatrix(Matrix4f());
     }
 
     // Apply "orthographic" stereo parameters used for rendering 2D HUD overlays.
@@ -726,6 +1020,7 @@ public:
         SetProjection(params.OrthoProjection);
         if (params.pDistortion)
             SetDistortionConfig(*params.pDistortion, params.Eye);
+        SetDistortionMesh(params.pDistortionMesh, params.Eye);
     }
 
 
@@ -752,6 +1047,16 @@ public:
     // Waits for rendering to complete; important for reducing latency.
     virtual void ForceFlushGPU() { }
 
+    // GPU frame timing. Begin and End bracket the GPU work of a frame; the result is
+    // read back a few frames later, so GetGPUFrameTime returns the time of the most
+    // recent frame that has completed, in seconds, or a negative value if no timing
+    // is available on this device.
+    virtual void  BeginGPUFrameTimer() { }
+    virtual void  EndGPUFrameTimer() { }
+    virtual float GetGPUFrameTime() { return -1.0f; }
+    // Refresh rate of the display the window is on, in Hz; 0 if unknown.
+    virtual float GetRefreshRate() { return 0; }
+
     // Resources
     virtual Buffer*  CreateBuffer() { return NULL; }
     virtual Texture* CreateTexture(int format, int width, int height, const void* data, int mipcount=1)
@@ -791,6 +1096,26 @@ public:
 
     // This is a View matrix only, it will be combined with the projection matrix from SetProjection
     virtual void Render(const Matrix4f& matrix, Model* model) = 0;
+    // Draws only the given ranges of the model's indices, binding its state once.
+    virtual void Render(const Matrix4f& matrix, Model* model, const IndexRange* ranges, int rangeCount) = 0;
+
+    // Single-traversal stereo rendering. SetStereoViews records the viewport, projection,
+    // view and lighting of both eyes; RenderStereo then draws the model for each eye with
+    // its world matrix combined with the eye's view. Renderers override RenderStereo to
+    // bind the model's buffers and fill only once for both draws.
+    void         SetStereoViews(const StereoEyeParams& left, const StereoEyeParams& right,
+                                const Matrix4f views[2], const LightingParams* lighting[2]);
+    virtual void RenderStereo(const Matrix4f& world, Model* model);
+    virtual void RenderStereo(const Matrix4f& world, Model* model, const IndexRange* ranges, int rangeCount);
+    // Returns false if the bounds, transformed to world space by 'world', are outside
+    // the frusta of both eyes set by SetStereoViews.
+    bool         IsStereoVisible(const Bounds& b, const Matrix4f& world) const;
+
+    // Frustum that Model and Container::Render cull against, with the matrices passed
+    // to them; null disables culling. It is not copied.
+    void           SetCullFrustum(const Frustum* frustum) { pCullFrustum = frustum; }
+    const Frustum* GetCullFrustum() const                 { return pCullFrustum; }
+
     // offset is in bytes; indices can be null.
     virtual void Render(const Fill* fill, Buffer* vertices, Buffer* indices,
                         const Matrix4f& matrix, int offset, int count, PrimitiveType prim = Prim_Triangles) = 0;
@@ -805,7 +1130,11 @@ public:
     Fill *        CreateTextureFill(Texture* tex, bool useAlpha = false);
 
     // PostProcess distortion
+    // Render scales up to the maximum scale just change the scene viewport; a larger
+    // scale raises the maximum and reallocates the scene texture.
     void          SetSceneRenderScale(float ss);
+    void          SetMaxSceneRenderScale(float ss);
+    float         GetSceneRenderScale() const { return SceneRenderScale; }
 
     void          SetDistortionConfig(const DistortionConfig& config, StereoEye eye = StereoEye_Left)
     {
@@ -814,6 +1143,22 @@ public:
             Distortion.XCenterOffset = -Distortion.XCenterOffset;
     }
 
+    // Sets the mesh used for distortion of the next FinishScene; null selects
+    // the distortion shader.
+    void          SetDistortionMesh(const DistortionMesh* mesh, StereoEye eye = StereoEye_Left)
+    {
+        pDistortionMesh   = mesh;
+        DistortionMeshEye = (eye == StereoEye_Right) ? 1 : 0;
+    }
+
+    // Sets the reprojection applied by the distortion pass of the next FinishScene,
+    // as computed by StereoEyeParams::CalculateTimewarpMatrix. ApplyStereoParams
+    // resets it to identity, so it is set after the scene has been rendered.
+    void          SetTimewarpMatrix(const Matrix4f& timewarp)
+    {
+        TimewarpMatrix = timewarp;
+    }
+
     // Sets the color that is applied around distortion.
     void          SetDistortionClearColor(Color clearColor)
     {
@@ -844,6 +1189,25 @@ int GetTextureSize(int format, int w, int h);
 // Image size must be a power of 2.
 void FilterRgba2x2(const UByte* src, int w, int h, UByte* dest);
 
+// Texture data decoded from a file, ready for RenderDevice::CreateTexture: mip levels
+// follow each other in Data, largest first. Decoding doesn't use the device, so it
+// can be done on any thread.
+struct TextureImage
+{
+    int          Format;
+    int          Width, Height;
+    int          MipCount;
+    bool         Clamp;         // Files named "*_c.*" are sampled with Sample_Clamp.
+    Array<UByte> Data;
+
+    TextureImage() : Format(0), Width(0), Height(0), MipCount(0), Clamp(false) { }
+};
+
+// TGA images are decoded to RGBA with a full mip chain; DDS data is kept compressed.
+bool     DecodeTextureTga(File* f, TextureImage* image);
+bool     DecodeTextureDDS(File* f, TextureImage* image);
+Texture* CreateTextureFromImage(RenderDevice* ren, const TextureImage& image);
+
 Texture* LoadTextureTga(RenderDevice* ren, File* f);
 Texture* LoadTextureDDS(RenderDevice* ren, File* f);
 
@@ -0,0 +1,213 @@
+/************************************************************************************
+
+Filename    :   Render_HeightField.cpp
+Content     :   Ground heightfield for downward collision queries
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "Render_HeightField.h"
+#include "Render_CollisionTree.h"
+#include "Kernel/OVR_Alg.h"
+
+namespace OVR { namespace Render {
+
+void CollisionHeightField::Clear()
+{
+    Models.Clear();
+    Unbounded.Clear();
+    CellStarts.Clear();
+    CellEntries.Clear();
+    CellsX = CellsZ = 0;
+}
+
+void CollisionHeightField::Build(const Array<Ptr<CollisionModel> >& models, float cellSize)
+{
+    Clear();
+
+    Array<Bounds> modelBounds;
+    Array<UInt32> bounded;
+    Bounds        extent;
+    for (UPInt i = 0; i < models.GetSize(); i++)
+    {
+        // Models without planes have no surface to hit.
+        if (models[i]->GetPlanes().GetSize() == 0)
+            continue;
+
+        UInt32 index = (UInt32)Models.GetSize();
+        Models.PushBack(models[i]);
+
+        Bounds b;
+        if (models[i]->GetBounds(&b))
+        {
+            bounded.PushBack(index);
+            extent.AddPoint(b.Min);
+            extent.AddPoint(b.Max);
+        }
+        else
+        {
+            CellEntry entry = { index, -Math<float>::MaxValue, Math<float>::MaxValue };
+            Unbounded.PushBack(entry);
+        }
+        modelBounds.PushBack(b);
+    }
+    if (bounded.GetSize() == 0)
+        return;
+
+    Vector3f size = extent.Max - extent.Min;
+    CellSize = Alg::Max(cellSize, 0.01f);
+    while ((size.x / CellSize + 1.0f) * (size.z / CellSize + 1.0f) > float(MaxCells))
+        CellSize *= 2.0f;
+    InvCellSize = 1.0f / CellSize;
+    Origin      = extent.Min;
+    CellsX      = (int)(size.x * InvCellSize) + 1;
+    CellsZ      = (int)(size.z * InvCellSize) + 1;
+
+    // Entries are counted per cell first, so that each cell's are stored together.
+    CellStarts.Resize(CellsX * CellsZ + 1);
+    for (UPInt c = 0; c < CellStarts.GetSize(); c++)
+        CellStarts[c] = 0;
+
+    Array<UInt32> cursors;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (UPInt i = 0; i < bounded.GetSize(); i++)
+        {
+            const Bounds& b  = modelBounds[bounded[i]];
+            int           x0 = Alg::Clamp((int)((b.Min.x - Origin.x) * InvCellSize), 0, CellsX - 1);
+            int           x1 = Alg::Clamp((int)((b.Max.x - Origin.x) * InvCellSize), 0, CellsX - 1);
+            int           z0 = Alg::Clamp((int)((b.Min.z - Origin.z) * InvCellSize), 0, CellsZ - 1);
+            int           z1 = Alg::Clamp((int)((b.Max.z - Origin.z) * InvCellSize), 0, CellsZ - 1);
+
+            for (int z = z0; z <= z1; z++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    int cell = z * CellsX + x;
+                    if (pass == 0)
+                    {
+                        CellStarts[cell + 1]++;
+                    }
+                    else
+                    {
+                        CellEntry entry = { bounded[i], b.Min.y, b.Max.y };
+                        CellEntries[cursors[cell]++] = entry;
+                    }
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (int c = 0; c < CellsX * CellsZ; c++)
+                CellStarts[c + 1] += CellStarts[c];
+            CellEntries.Resize(CellStarts[CellsX * CellsZ]);
+            cursors.Resize(CellsX * CellsZ);
+            for (int c = 0; c < CellsX * CellsZ; c++)
+                cursors[c] = CellStarts[c];
+        }
+    }
+
+    // Highest entries first, so that queries can stop at the first hit below them.
+    for (int c = 0; c < CellsX * CellsZ; c++)
+    {
+        for (UInt32 i = CellStarts[c] + 1; i < CellStarts[c + 1]; i++)
+        {
+            CellEntry entry = CellEntries[i];
+            UInt32    j     = i;
+            for (; (j > CellStarts[c]) && (CellEntries[j - 1].MaxY < entry.MaxY); j--)
+                CellEntries[j] = CellEntries[j - 1];
+            CellEntries[j] = entry;
+        }
+    }
+}
+
+int CollisionHeightField::getCell(float x, float z) const
+{
+    float fx = (x - Origin.x) * InvCellSize;
+    float fz = (z - Origin.z) * InvCellSize;
+    if ((fx < 0) || (fz < 0) || (fx >= float(CellsX)) || (fz >= float(CellsZ)))
+        return -1;
+    return (int)fz * CellsX + (int)fx;
+}
+
+// Clips the down ray against the entry's model if it can be hit nearer than 'bestT'.
+void CollisionHeightField::testEntry(const CellEntry& entry, const Vector3f& origin, float len,
+                                     float& bestT, int& bestModel, int& bestPlane) const
+{
+    if ((entry.MinY > origin.y) || (entry.MaxY < origin.y - len))
+        return;
+
+    float t;
+    int   plane;
+    if (Models[entry.Model]->ClipRay(origin, Vector3f(0.0f, -1.0f, 0.0f), Alg::Min(len, bestT), t, plane) &&
+        (t < bestT))
+    {
+        bestT     = t;
+        bestModel = (int)entry.Model;
+        bestPlane = plane;
+    }
+}
+
+bool CollisionHeightField::TestDown(const Vector3f& origin, float& len, Planef* ph) const
+{
+    float bestT     = Math<float>::MaxValue;
+    int   bestModel = -1, bestPlane = -1;
+
+    for (UPInt i = 0; i < Unbounded.GetSize(); i++)
+        testEntry(Unbounded[i], origin, len, bestT, bestModel, bestPlane);
+
+    int cell = (CellsX > 0) ? getCell(origin.x, origin.z) : -1;
+    if (cell >= 0)
+    {
+        for (UInt32 i = CellStarts[cell]; i < CellStarts[cell + 1]; i++)
+        {
+            // Once an entry's top is farther down than the best hit, so are the rest.
+            const CellEntry& entry = CellEntries[i];
+            if (origin.y - entry.MaxY > bestT)
+                break;
+            testEntry(entry, origin, len, bestT, bestModel, bestPlane);
+        }
+    }
+
+    if (bestModel < 0)
+        return false;
+
+    len = Alg::Max(bestT - CollisionTree::HitMargin, 0.0f);
+    if (ph)
+        *ph = Models[bestModel]->GetPlanes()[(bestPlane < 0) ? 0 : bestPlane];
+    return true;
+}
+
+bool CollisionHeightField::GetHeightRange(float x, float z, float& minY, float& maxY) const
+{
+    int cell = (CellsX > 0) ? getCell(x, z) : -1;
+    if ((cell < 0) || (CellStarts[cell] == CellStarts[cell + 1]))
+        return false;
+
+    minY = Math<float>::MaxValue;
+    maxY = -Math<float>::MaxValue;
+    for (UInt32 i = CellStarts[cell]; i < CellStarts[cell + 1]; i++)
+    {
+        minY = Alg::Min(minY, CellEntries[i].MinY);
+        maxY = Alg::Max(maxY, CellEntries[i].MaxY);
+    }
+    return true;
+}
+
+}}
@@ -0,0 +1,81 @@
+/************************************************************************************
+
+Filename    :   Render_HeightField.h
+Content     :   Ground heightfield for downward collision queries
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef INC_Render_HeightField_h
+#define INC_Render_HeightField_h
+
+#include "Render_Device.h"
+
+namespace OVR { namespace Render {
+
+// CollisionHeightField answers rays cast straight down against ground collision
+// models in constant time, whatever the size of the level. The models are baked into
+// a regular grid over the horizontal plane; each cell lists the models above it with
+// their height range, highest first, so that a query looks up one cell and usually
+// clips the ray against a single model. Models that aren't closed, and so have no
+// finite box, are tested by every query.
+class CollisionHeightField
+{
+public:
+    enum { MaxCells = 1 << 20 };
+
+    CollisionHeightField() : CellSize(1.0f), InvCellSize(1.0f), CellsX(0), CellsZ(0) { }
+
+    // Bakes the grid from 'models', replacing any earlier contents. Cells are 'cellSize'
+    // across, grown if needed to stay within MaxCells.
+    void Build(const Array<Ptr<CollisionModel> >& models, float cellSize = 1.0f);
+    void Clear();
+    bool IsEmpty() const { return Models.GetSize() == 0; }
+
+    // Casts a ray down from 'origin' for 'len'; results are as for CollisionTree::TestRay.
+    bool TestDown(const Vector3f& origin, float& len, Planef* ph = NULL) const;
+
+    // Returns the range of ground heights in the cell at (x, z), or false if the cell
+    // has no ground under it.
+    bool GetHeightRange(float x, float z, float& minY, float& maxY) const;
+
+private:
+    struct CellEntry
+    {
+        UInt32 Model;
+        float  MinY, MaxY;
+    };
+
+    // Index of the cell at (x, z), or -1 outside of the grid.
+    int  getCell(float x, float z) const;
+    void testEntry(const CellEntry& entry, const Vector3f& origin, float len,
+                   float& bestT, int& bestModel, int& bestPlane) const;
+
+    Array<Ptr<CollisionModel> > Models;
+    Array<CellEntry>            Unbounded;
+    // Entries of cell i are CellEntries[CellStarts[i], CellStarts[i + 1]).
+    Array<UInt32>               CellStarts;
+    Array<CellEntry>            CellEntries;
+    Vector3f                    Origin;
+    float                       CellSize, InvCellSize;
+    int                         CellsX, CellsZ;
+};
+
+}}
+
+#endif
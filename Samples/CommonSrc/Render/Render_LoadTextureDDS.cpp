@@ -62,7 +62,7 @@ struct OVR_DDS_HEADER
     UInt32				Reserved2;
 };
 
-Texture* LoadTextureDDS(RenderDevice* ren, File* f)
+bool DecodeTextureDDS(File* f, TextureImage* image)
 {
     OVR_DDS_HEADER header;
     unsigned char filecode[4];
@@ -70,7 +70,7 @@ Texture* LoadTextureDDS(RenderDevice* ren, File* f)
     f->Read(filecode, 4);
     if (strncmp((const char*)filecode, "DDS ", 4) != 0)
     {
-        return NULL;
+        return false;
     }
 
     f->Read((unsigned char*)(&header), sizeof(header));
@@ -97,20 +97,37 @@ Texture* LoadTextureDDS(RenderDevice* ren, File* f)
         }
         else
         {
-            return NULL;
+            return false;
         }
     }
 
-    int            byteLen = f->BytesAvailable();
-    unsigned char* bytes   = new unsigned char[byteLen];
-    f->Read(bytes, byteLen);
-    Texture* out = ren->CreateTexture(format, (int)width, (int)height, bytes, mipCount);
-    if(strstr(f->GetFilePath(), "_c."))
+    int byteLen = f->BytesAvailable();
+    if (byteLen <= 0)
+    {
+        return false;
+    }
+    image->Data.Resize(byteLen);
+    if (f->Read(&image->Data[0], byteLen) != byteLen)
+    {
+        return false;
+    }
+
+    image->Format   = format;
+    image->Width    = width;
+    image->Height   = height;
+    image->MipCount = (int)mipCount;
+    image->Clamp    = strstr(f->GetFilePath(), "_c.") != NULL;
+    return true;
+}
+
+Texture* LoadTextureDDS(RenderDevice* ren, File* f)
+{
+    TextureImage image;
+    if (!DecodeTextureDDS(f, &image))
     {
-        out->SetSampleMode(Sample_Clamp);
+        return NULL;
     }
-    OVR_FREE(bytes);
-    return out;
+    return CreateTextureFromImage(ren, image);
 }
 
 
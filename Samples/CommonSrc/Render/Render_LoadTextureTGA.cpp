@@ -26,7 +26,29 @@ limitations under the License.
 
 namespace OVR { namespace Render {
 
-Texture* LoadTextureTga(RenderDevice* ren, File* f)
+// Halves an RGBA image with a 2x2 box filter; for odd sizes the last row or column
+// is repeated.
+static void filterMipLevel(const UByte* src, int w, int h, UByte* dest)
+{
+    int mipw = Alg::Max(w >> 1, 1);
+    int miph = Alg::Max(h >> 1, 1);
+
+    for (int j = 0; j < miph; j++)
+    {
+        const UByte* row0 = src + (j * 2) * w * 4;
+        const UByte* row1 = src + Alg::Min(j * 2 + 1, h - 1) * w * 4;
+
+        for (int i = 0; i < mipw; i++, dest += 4)
+        {
+            int x0 = (i * 2) * 4;
+            int x1 = Alg::Min(i * 2 + 1, w - 1) * 4;
+            for (int c = 0; c < 4; c++)
+                dest[c] = (UByte)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) >> 2);
+        }
+    }
+}
+
+bool DecodeTextureTga(File* f, TextureImage* image)
 {
     int desclen = f->ReadUByte();
     int palette = f->ReadUByte();
@@ -41,62 +63,79 @@ Texture* LoadTextureTga(RenderDevice* ren, File* f)
     int height = f->ReadUInt16();
     int bpp = f->ReadUByte();
     f->ReadUByte();
-    int imgsize = width * height * 4;
-    unsigned char* imgdata = (unsigned char*) OVR_ALLOC(imgsize);
-    unsigned char buf[16];
-    f->Read(imgdata, desclen);
-    f->Read(imgdata, palCount * (palSize + 7) >> 3);
-    int bpl = width * 4;
-
-    switch (imgtype)
+    f->SkipBytes(desclen);
+    f->SkipBytes(palCount * (palSize + 7) >> 3);
+
+    if ((imgtype != 2) || ((bpp != 24) && (bpp != 32)) || (width == 0) || (height == 0))
+    {
+        return false;
+    }
+
+    // The mip chain is generated here rather than by the device, so that it is
+    // built on the decoding thread.
+    int mipCount = GetNumMipLevels(width, height);
+    int dataSize = 0;
+    for (int level = 0, w = width, h = height; level < mipCount; level++)
+    {
+        dataSize += w * h * 4;
+        w = Alg::Max(w >> 1, 1);
+        h = Alg::Max(h >> 1, 1);
+    }
+    image->Data.Resize(dataSize);
+
+    // Rows are read whole, then converted from BGR(A).
+    UByte*       imgdata   = &image->Data[0];
+    int          pixelSize = bpp / 8;
+    int          rowSize   = width * pixelSize;
+    Array<UByte> row;
+    row.Resize(rowSize);
+
+    for (int y = 0; y < height; y++)
     {
-    case 2:
-        switch (bpp)
+        if (f->Read(&row[0], rowSize) != rowSize)
         {
-        case 24:
-            for (int y = 0; y < height; y++)
-                for (int x = 0; x < width; x++)
-                {
-                    f->Read(buf, 3);
-                    imgdata[y*bpl+x*4+0] = buf[2];
-                    imgdata[y*bpl+x*4+1] = buf[1];
-                    imgdata[y*bpl+x*4+2] = buf[0];
-                    imgdata[y*bpl+x*4+3] = 255;
-                }
-            break;
-        case 32:
-            for (int y = 0; y < height; y++)
-                for (int x = 0; x < width; x++)
-                {
-                    f->Read(buf, 4);
-                    imgdata[y*bpl+x*4+0] = buf[2];
-                    imgdata[y*bpl+x*4+1] = buf[1];
-                    imgdata[y*bpl+x*4+2] = buf[0];
-                    imgdata[y*bpl+x*4+3] = buf[3];
-                }
-            break;
-
-        default:
-            OVR_FREE(imgdata);
-            return NULL;
+            return false;
         }
-        break;
 
-    default:
-        OVR_FREE(imgdata);
-        return NULL;
+        const UByte* src  = &row[0];
+        UByte*       dest = imgdata + y * width * 4;
+        for (int x = 0; x < width; x++, src += pixelSize, dest += 4)
+        {
+            dest[0] = src[2];
+            dest[1] = src[1];
+            dest[2] = src[0];
+            dest[3] = (pixelSize == 4) ? src[3] : 255;
+        }
     }
 
-	Texture* out = ren->CreateTexture(Texture_RGBA|Texture_GenMipmaps, width, height, imgdata);
+    UByte* level = imgdata;
+    for (int i = 1, w = width, h = height; i < mipCount; i++)
+    {
+        UByte* next = level + w * h * 4;
+        filterMipLevel(level, w, h, next);
+        level = next;
+        w     = Alg::Max(w >> 1, 1);
+        h     = Alg::Max(h >> 1, 1);
+    }
 
-	// check for clamp based on texture name
-	if(strstr(f->GetFilePath(), "_c."))
-	{
-		out->SetSampleMode(Sample_Clamp);
-	}
+    image->Format   = Texture_RGBA;
+    image->Width    = width;
+    image->Height   = height;
+    image->MipCount = mipCount;
 
-    OVR_FREE(imgdata);
-    return out;
+    // check for clamp based on texture name
+    image->Clamp    = strstr(f->GetFilePath(), "_c.") != NULL;
+    return true;
+}
+
+Texture* LoadTextureTga(RenderDevice* ren, File* f)
+{
+    TextureImage image;
+    if (!DecodeTextureTga(f, &image))
+    {
+        return NULL;
+    }
+    return CreateTextureFromImage(ren, image);
 }
 
 }}
@@ -0,0 +1,455 @@
+/************************************************************************************
+
+Filename    :   Render_MeshOptimizer.cpp
+Content     :   Load-time reordering of model triangles and vertices
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "Render_MeshOptimizer.h"
+#include "Kernel/OVR_Alg.h"
+
+namespace OVR { namespace Render {
+
+//-----------------------------------------------------------------------------------
+// ***** FIFO cache simulation
+
+// Each vertex keeps the time it entered the cache, counted in misses; it is still in
+// the cache while fewer than CacheSize misses followed.
+class FifoCacheSim
+{
+public:
+    FifoCacheSim(UPInt vertexCount, int cacheSize) : CacheSize(cacheSize), Time(0)
+    {
+        Timestamps.Resize(vertexCount);
+        for (UPInt i = 0; i < vertexCount; i++)
+            Timestamps[i] = 0;
+        Reset();
+    }
+
+    void Reset()
+    {
+        // Pushes all vertices out of the cache.
+        Time += CacheSize + 1;
+        if (Time < 0 || Time > 0x3fffffff)
+        {
+            Time = CacheSize + 1;
+            for (UPInt i = 0; i < Timestamps.GetSize(); i++)
+                Timestamps[i] = 0;
+        }
+    }
+
+    // Returns the number of misses, 0 to 3, for drawing the triangle.
+    int AddTriangle(const UInt32* tri)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            if (Time - Timestamps[tri[k]] > CacheSize)
+            {
+                Timestamps[tri[k]] = ++Time;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+private:
+    int         CacheSize;
+    int         Time;
+    Array<int>  Timestamps;
+};
+
+float GetAverageCacheMissRatio(const UInt32* indices, UPInt indexCount, UPInt vertexCount, int cacheSize)
+{
+    UPInt triCount = indexCount / 3;
+    if (triCount == 0)
+        return 0.0f;
+
+    FifoCacheSim cache(vertexCount, cacheSize);
+    UPInt        misses = 0;
+    for (UPInt t = 0; t < triCount; t++)
+        misses += cache.AddTriangle(indices + t * 3);
+    return float(misses) / float(triCount);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Vertex cache order
+
+// Scoring constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+static const int   ForsythCacheSize      = 32;
+static const float ForsythCacheDecay     = 1.5f;
+static const float ForsythLastTriScore   = 0.75f;
+static const float ForsythValenceScale   = 2.0f;
+static const float ForsythValencePower   = 0.5f;
+
+static float forsythVertexScore(int cachePosition, UInt32 remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the last triangle are scored lower, so that the next triangle
+        // doesn't just repeat them.
+        if (cachePosition < 3)
+            score = ForsythLastTriScore;
+        else
+            score = powf(1.0f - float(cachePosition - 3) / float(ForsythCacheSize - 3), ForsythCacheDecay);
+    }
+    // Vertices with few triangles left are preferred, to finish them off.
+    return score + ForsythValenceScale * powf(float(remainingTriangles), -ForsythValencePower);
+}
+
+static void optimizeVertexCache(Array<UInt32>& indices, UPInt vertexCount)
+{
+    UPInt triCount = indices.GetSize() / 3;
+
+    // Triangles of each vertex; the first RemainingTris of its list aren't drawn yet.
+    Array<UInt32> triOffsets, triList, remainingTris;
+    triOffsets.Resize(vertexCount + 1);
+    remainingTris.Resize(vertexCount);
+    for (UPInt v = 0; v < vertexCount; v++)
+        remainingTris[v] = 0;
+    for (UPInt i = 0; i < indices.GetSize(); i++)
+        remainingTris[indices[i]]++;
+
+    UInt32 offset = 0;
+    for (UPInt v = 0; v < vertexCount; v++)
+    {
+        triOffsets[v] = offset;
+        offset += remainingTris[v];
+        remainingTris[v] = 0;
+    }
+    triOffsets[vertexCount] = offset;
+    triList.Resize(offset);
+    for (UPInt t = 0; t < triCount; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            UInt32 v = indices[t * 3 + k];
+            triList[triOffsets[v] + remainingTris[v]++] = (UInt32)t;
+        }
+    }
+
+    Array<int>   cachePositions;
+    Array<float> vertexScores, triScores;
+    Array<bool>  triAdded;
+    cachePositions.Resize(vertexCount);
+    vertexScores.Resize(vertexCount);
+    triScores.Resize(triCount);
+    triAdded.Resize(triCount);
+
+    for (UPInt v = 0; v < vertexCount; v++)
+    {
+        cachePositions[v] = -1;
+        vertexScores[v]   = forsythVertexScore(-1, remainingTris[v]);
+    }
+    for (UPInt t = 0; t < triCount; t++)
+    {
+        triAdded[t]  = false;
+        triScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                       vertexScores[indices[t * 3 + 2]];
+    }
+
+    // The cache holds three extra entries for the vertices pushed out by a triangle.
+    UInt32 cache[ForsythCacheSize + 3], newCache[ForsythCacheSize + 3];
+    int    cacheCount = 0;
+
+    Array<UInt32> result;
+    result.Reserve(indices.GetSize());
+
+    SPInt  bestTri    = -1;
+    UPInt  scanStart  = 0;
+    for (UPInt drawn = 0; drawn < triCount; drawn++)
+    {
+        // When no triangle of a cached vertex is left, the best one is searched for;
+        // triangles before scanStart are all drawn.
+        if (bestTri < 0)
+        {
+            float bestScore = -1.0f;
+            for (UPInt t = scanStart; t < triCount; t++)
+            {
+                if (triAdded[t])
+                {
+                    if (t == scanStart)
+                        scanStart++;
+                    continue;
+                }
+                if (triScores[t] > bestScore)
+                {
+                    bestScore = triScores[t];
+                    bestTri   = (SPInt)t;
+                }
+            }
+        }
+
+        const UInt32* tri = &indices[bestTri * 3];
+        result.PushBack(tri[0]);
+        result.PushBack(tri[1]);
+        result.PushBack(tri[2]);
+        triAdded[bestTri] = true;
+
+        // Removes the triangle from its vertices' lists of remaining triangles.
+        for (int k = 0; k < 3; k++)
+        {
+            UInt32  v     = tri[k];
+            UInt32* list  = &triList[triOffsets[v]];
+            UInt32  count = remainingTris[v];
+            for (UInt32 j = 0; j < count; j++)
+            {
+                if (list[j] == (UInt32)bestTri)
+                {
+                    list[j] = list[count - 1];
+                    break;
+                }
+            }
+            remainingTris[v]--;
+        }
+
+        // The triangle's vertices move to the front of the cache.
+        int newCount = 0;
+        for (int k = 0; k < 3; k++)
+            newCache[newCount++] = tri[k];
+        for (int i = 0; i < cacheCount; i++)
+        {
+            UInt32 v = cache[i];
+            if ((v != tri[0]) && (v != tri[1]) && (v != tri[2]))
+                newCache[newCount++] = v;
+        }
+
+        // Rescores the cached vertices and their triangles, and picks the best triangle.
+        float bestScore = -1.0f;
+        bestTri = -1;
+        for (int i = 0; i < newCount; i++)
+        {
+            UInt32 v        = newCache[i];
+            int    position = (i < ForsythCacheSize) ? i : -1;
+            float  score    = forsythVertexScore(position, remainingTris[v]);
+            float  delta    = score - vertexScores[v];
+
+            cachePositions[v] = position;
+            vertexScores[v]   = score;
+
+            const UInt32* list = &triList[triOffsets[v]];
+            for (UInt32 j = 0; j < remainingTris[v]; j++)
+            {
+                UInt32 t = list[j];
+                triScores[t] += delta;
+                if (triScores[t] > bestScore)
+                {
+                    bestScore = triScores[t];
+                    bestTri   = (SPInt)t;
+                }
+            }
+        }
+
+        cacheCount = Alg::Min(newCount, (int)ForsythCacheSize);
+        memcpy(cache, newCache, cacheCount * sizeof(UInt32));
+    }
+
+    indices = result;
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Overdraw order
+
+struct MeshCluster
+{
+    UPInt   Start, Count;    // In triangles.
+    float   SortKey;
+};
+
+static bool operator<(const MeshCluster& a, const MeshCluster& b)
+{
+    // Sorted by descending key; clusters with equal keys stay in order.
+    if (a.SortKey != b.SortKey)
+        return a.SortKey > b.SortKey;
+    return a.Start < b.Start;
+}
+
+static void optimizeOverdraw(Array<UInt32>& indices, const Array<Vertex>& vertices, float threshold)
+{
+    const int CacheSize = 16;
+    UPInt     triCount  = indices.GetSize() / 3;
+    if (triCount < 2)
+        return;
+
+    // Clusters start where a triangle misses on all of its vertices, since the cache
+    // is restarted there anyway.
+    Array<UPInt> hardStarts;
+    {
+        FifoCacheSim cache(vertices.GetSize(), CacheSize);
+        for (UPInt t = 0; t < triCount; t++)
+        {
+            if ((cache.AddTriangle(&indices[t * 3]) == 3) || (t == 0))
+                hardStarts.PushBack(t);
+        }
+    }
+    hardStarts.PushBack(triCount);
+
+    // Hard clusters are split further where the part so far already has a miss ratio
+    // within 'threshold' of the whole cluster's.
+    Array<MeshCluster> clusters;
+    for (UPInt h = 0; h + 1 < hardStarts.GetSize(); h++)
+    {
+        UPInt start = hardStarts[h], end = hardStarts[h + 1];
+        float clusterRatio = GetAverageCacheMissRatio(&indices[start * 3], (end - start) * 3,
+                                                      vertices.GetSize(), CacheSize);
+
+        FifoCacheSim cache(vertices.GetSize(), CacheSize);
+        UPInt        misses = 0;
+        for (UPInt t = start; t < end; t++)
+        {
+            misses += cache.AddTriangle(&indices[t * 3]);
+            UPInt count = t + 1 - start;
+            if ((t + 1 == end) || (float(misses) / float(count) <= clusterRatio * threshold))
+            {
+                MeshCluster c = { start, count, 0.0f };
+                clusters.PushBack(c);
+                start  = t + 1;
+                misses = 0;
+                cache.Reset();
+            }
+        }
+    }
+    if (clusters.GetSize() < 2)
+        return;
+
+    // Clusters are sorted by how far they face out from the mesh centroid, with
+    // centroids and normals weighted by triangle area.
+    Array<Vector3f> centroids, normals;
+    centroids.Resize(clusters.GetSize());
+    normals.Resize(clusters.GetSize());
+    Vector3f meshCentroid(0);
+    float    meshArea = 0;
+
+    for (UPInt c = 0; c < clusters.GetSize(); c++)
+    {
+        Vector3f centroid(0), normal(0), average(0);
+        float    area = 0;
+        for (UPInt t = clusters[c].Start; t < clusters[c].Start + clusters[c].Count; t++)
+        {
+            const Vector3f& p0 = vertices[indices[t * 3]].Pos;
+            const Vector3f& p1 = vertices[indices[t * 3 + 1]].Pos;
+            const Vector3f& p2 = vertices[indices[t * 3 + 2]].Pos;
+            Vector3f n = (p1 - p0).Cross(p2 - p0);
+            float    a = n.Length();
+
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            average  += (p0 + p1 + p2) / 3.0f;
+            normal   += n;
+            area     += a;
+        }
+
+        centroids[c]  = (area > 0) ? centroid / area : average / float(clusters[c].Count);
+        normals[c]    = normal;
+        meshCentroid += centroid;
+        meshArea     += area;
+    }
+    if (meshArea > 0)
+        meshCentroid /= meshArea;
+
+    for (UPInt c = 0; c < clusters.GetSize(); c++)
+    {
+        float length = normals[c].Length();
+        clusters[c].SortKey = (length > 0) ? ((centroids[c] - meshCentroid) * normals[c]) / length : 0.0f;
+    }
+    Alg::QuickSort(clusters);
+
+    Array<UInt32> result;
+    result.Reserve(indices.GetSize());
+    for (UPInt c = 0; c < clusters.GetSize(); c++)
+    {
+        for (UPInt i = clusters[c].Start * 3; i < (clusters[c].Start + clusters[c].Count) * 3; i++)
+            result.PushBack(indices[i]);
+    }
+    indices = result;
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Vertex fetch order
+
+static void optimizeVertexFetch(Array<UInt32>& indices, Array<Vertex>& vertices)
+{
+    const UInt32  unassigned = 0xffffffff;
+    Array<UInt32> remap;
+    remap.Resize(vertices.GetSize());
+    for (UPInt v = 0; v < remap.GetSize(); v++)
+        remap[v] = unassigned;
+
+    UInt32 next = 0;
+    for (UPInt i = 0; i < indices.GetSize(); i++)
+    {
+        UInt32& r = remap[indices[i]];
+        if (r == unassigned)
+            r = next++;
+        indices[i] = r;
+    }
+    for (UPInt v = 0; v < remap.GetSize(); v++)
+    {
+        if (remap[v] == unassigned)
+            remap[v] = next++;
+    }
+
+    // Vertex has no default constructor, so the old order is copied by appending.
+    Array<Vertex> source;
+    source.Reserve(vertices.GetSize());
+    for (UPInt v = 0; v < vertices.GetSize(); v++)
+        source.PushBack(vertices[v]);
+    for (UPInt v = 0; v < source.GetSize(); v++)
+        vertices[remap[v]] = source[v];
+}
+
+
+//-----------------------------------------------------------------------------------
+
+bool OptimizeMesh(Model* model, int flags, float overdrawThreshold)
+{
+    if ((model->Type != Prim_Triangles) || model->VertexBuffer || model->IndexBuffer ||
+        (model->Indices.GetSize() < 3))
+    {
+        return false;
+    }
+
+    // The passes index per-vertex arrays with the indices, which may come straight
+    // from a scene file.
+    UPInt vertexCount = model->Vertices.GetSize();
+    for (UPInt i = 0; i < model->Indices.GetSize(); i++)
+    {
+        if (model->Indices[i] >= vertexCount)
+            return false;
+    }
+
+    // A trailing partial triangle isn't drawn, and is dropped.
+    model->Indices.Resize(model->Indices.GetSize() - model->Indices.GetSize() % 3);
+
+    if (flags & MeshOptimize_VertexCache)
+        optimizeVertexCache(model->Indices, vertexCount);
+    if (flags & MeshOptimize_Overdraw)
+        optimizeOverdraw(model->Indices, model->Vertices, overdrawThreshold);
+    if (flags & MeshOptimize_VertexFetch)
+        optimizeVertexFetch(model->Indices, model->Vertices);
+    return true;
+}
+
+}}
@@ -0,0 +1,62 @@
+/************************************************************************************
+
+Filename    :   Render_MeshOptimizer.h
+Content     :   Load-time reordering of model triangles and vertices
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef INC_Render_MeshOptimizer_h
+#define INC_Render_MeshOptimizer_h
+
+#include "Render_Device.h"
+
+namespace OVR { namespace Render {
+
+// Passes of OptimizeMesh, applied in this order:
+//  - VertexCache reorders triangles so that vertices are reused while they are still
+//    in the post-transform cache, with Tom Forsyth's linear-speed algorithm.
+//  - Overdraw splits the result into clusters where the cache is restarted anyway,
+//    and draws clusters facing away from the mesh center first, so that they tend
+//    to occlude the rest. Clusters keep their triangle order, so the cache efficiency
+//    is only lowered by up to overdrawThreshold.
+//  - VertexFetch renumbers vertices in the order the triangles first use them, so that
+//    vertex fetches walk through the vertex buffer; unused vertices are moved last.
+// Only the order changes; triangles keep their winding.
+enum MeshOptimizeFlags
+{
+    MeshOptimize_VertexCache = 0x01,
+    MeshOptimize_Overdraw    = 0x02,
+    MeshOptimize_VertexFetch = 0x04,
+    MeshOptimize_All         = 0x07
+};
+
+// Average number of vertices transformed per triangle, with a FIFO post-transform
+// cache of 'cacheSize' vertices; between 0.5 and 3, lower is better. All indices must
+// be less than 'vertexCount'.
+float GetAverageCacheMissRatio(const UInt32* indices, UPInt indexCount, UPInt vertexCount,
+                               int cacheSize = 16);
+
+// Reorders the model's triangles and vertices; must be called before its buffers are
+// created. Only triangle lists are changed. Returns false if the model was left as it is,
+// which is also the case if any index is out of range of its vertices.
+bool  OptimizeMesh(Model* model, int flags = MeshOptimize_All, float overdrawThreshold = 1.05f);
+
+}}
+
+#endif
@@ -0,0 +1,271 @@
+/************************************************************************************
+
+Filename    :   Render_TextureLoader.cpp
+Content     :   Texture decoding on worker threads with paced uploads
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "Render_TextureLoader.h"
+#include "Kernel/OVR_SysFile.h"
+#include "Kernel/OVR_Log.h"
+
+namespace OVR { namespace Render {
+
+bool DecodeTextureFile(const char* fileName, TextureImage* image)
+{
+    // The extension is the part of the name after the last dot, which the path
+    // may also contain.
+    const char* dot   = strrchr(fileName, '.');
+    const char* slash = Alg::Max(strrchr(fileName, '/'), strrchr(fileName, '\\'));
+    bool        dds   = dot && (dot > slash) && ((dot[1] == 'd') || (dot[1] == 'D'));
+
+    SysFile file(fileName);
+    if (!file.IsValid())
+    {
+        return false;
+    }
+    return dds ? DecodeTextureDDS(&file, image) : DecodeTextureTga(&file, image);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** TextureLoader
+
+TextureLoader::TextureLoader(int threadCount)
+    : NextRequest(0), RunningWorkers(0), Exiting(false)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = Alg::Max(Thread::GetCPUCount() - 1, 1);
+    }
+
+    Mutex::Locker lock(&QueueLock);
+    for (int i = 0; i < threadCount; i++)
+    {
+        Ptr<Thread> worker = *new Thread(workerThreadFn, this);
+        if (!worker->Start())
+        {
+            break;
+        }
+        Workers.PushBack(worker);
+        RunningWorkers++;
+    }
+}
+
+TextureLoader::~TextureLoader()
+{
+    // Workers reference this object, so wait for all of them to leave workerRun.
+    Mutex::Locker lock(&QueueLock);
+    Exiting = true;
+    WorkQueued.NotifyAll();
+    while (RunningWorkers > 0)
+    {
+        WorkDone.Wait(&QueueLock);
+    }
+}
+
+int TextureLoader::Load(const char* fileName)
+{
+    Ptr<Request> request = *new Request;
+    request->FileName = fileName;
+    request->State    = Request::State_Queued;
+
+    Mutex::Locker lock(&QueueLock);
+    Requests.PushBack(request);
+    WorkQueued.Notify();
+    return (int)Requests.GetSize() - 1;
+}
+
+void TextureLoader::SetFillTexture(int index, ShaderFill* fill, int slot)
+{
+    Request*    request = Requests[index];
+    FillBinding binding;
+    binding.pFill = fill;
+    binding.Slot  = slot;
+
+    if (request->pTexture)
+    {
+        fill->SetTexture(slot, request->pTexture);
+    }
+    else
+    {
+        request->Fills.PushBack(binding);
+    }
+}
+
+Texture* TextureLoader::GetPlaceholder(RenderDevice* pRender)
+{
+    if (!Placeholder)
+    {
+        static const UByte grey[4] = { 128, 128, 128, 255 };
+        Texture* texture = pRender->CreateTexture(Texture_RGBA, 1, 1, grey);
+        if (texture)
+        {
+            Placeholder = *texture;
+        }
+    }
+    return Placeholder;
+}
+
+bool TextureLoader::Update(RenderDevice* pRender, UPInt byteBudget)
+{
+    // Without workers, textures are decoded here one per frame.
+    if (Workers.GetSize() == 0)
+    {
+        decodeNext();
+    }
+
+    Array<Ptr<Request> > decoded;
+    bool                 done = true;
+    {
+        Mutex::Locker lock(&QueueLock);
+        for (UPInt i = 0; i < Requests.GetSize(); i++)
+        {
+            if (Requests[i]->State == Request::State_Decoded)
+            {
+                decoded.PushBack(Requests[i]);
+            }
+            else if (Requests[i]->State == Request::State_Queued)
+            {
+                done = false;
+            }
+        }
+    }
+
+    // Decoded requests are only changed by this thread, so no lock is needed to
+    // create their textures.
+    UPInt uploaded = 0;
+    for (UPInt i = 0; i < decoded.GetSize(); i++)
+    {
+        if ((i > 0) && (uploaded >= byteBudget))
+        {
+            return false;
+        }
+
+        Request* request = decoded[i];
+        Texture* texture = CreateTextureFromImage(pRender, request->Image);
+        uploaded += request->Image.Data.GetSize();
+        request->Image.Data.ClearAndRelease();
+
+        if (!texture)
+        {
+            request->State = Request::State_Failed;
+            request->Fills.ClearAndRelease();
+            continue;
+        }
+
+        request->pTexture = *texture;
+        request->State    = Request::State_Created;
+        for (UPInt j = 0; j < request->Fills.GetSize(); j++)
+        {
+            request->Fills[j].pFill->SetTexture(request->Fills[j].Slot, texture);
+        }
+        request->Fills.ClearAndRelease();
+    }
+    return done;
+}
+
+void TextureLoader::Finish(RenderDevice* pRender)
+{
+    while (decodeNext())
+    {
+    }
+
+    {
+        Mutex::Locker lock(&QueueLock);
+        for (UPInt i = 0; i < Requests.GetSize(); i++)
+        {
+            while (Requests[i]->State == Request::State_Queued)
+            {
+                WorkDone.Wait(&QueueLock);
+            }
+        }
+    }
+
+    Update(pRender, ~UPInt(0));
+}
+
+void TextureLoader::Clear()
+{
+    Mutex::Locker lock(&QueueLock);
+    Requests.ClearAndRelease();
+    NextRequest = 0;
+}
+
+Texture* TextureLoader::GetTexture(int index) const
+{
+    return Requests[index]->pTexture;
+}
+
+bool TextureLoader::decodeNext()
+{
+    Ptr<Request> request;
+    {
+        Mutex::Locker lock(&QueueLock);
+        if (NextRequest == Requests.GetSize())
+        {
+            return false;
+        }
+        request = Requests[NextRequest++];
+    }
+
+    // The file is read and decoded without the lock, so workers decode in parallel.
+    bool decoded = DecodeTextureFile(request->FileName, &request->Image);
+    if (!decoded)
+    {
+        OVR_DEBUG_LOG(("Failed to load texture %s.", request->FileName.ToCStr()));
+        request->Image.Data.ClearAndRelease();
+    }
+
+    Mutex::Locker lock(&QueueLock);
+    request->State = decoded ? Request::State_Decoded : Request::State_Failed;
+    WorkDone.NotifyAll();
+    return true;
+}
+
+int TextureLoader::workerThreadFn(Thread* thread, void* handle)
+{
+    thread->SetThreadName("TextureLoader");
+    return ((TextureLoader*)handle)->workerRun();
+}
+
+int TextureLoader::workerRun()
+{
+    for (;;)
+    {
+        {
+            Mutex::Locker lock(&QueueLock);
+            while ((NextRequest == Requests.GetSize()) && !Exiting)
+            {
+                WorkQueued.Wait(&QueueLock);
+            }
+
+            if (Exiting)
+            {
+                RunningWorkers--;
+                WorkDone.NotifyAll();
+                return 0;
+            }
+        }
+
+        decodeNext();
+    }
+}
+
+}}
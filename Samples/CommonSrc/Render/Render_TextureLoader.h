@@ -0,0 +1,120 @@
+/************************************************************************************
+
+Filename    :   Render_TextureLoader.h
+Content     :   Texture decoding on worker threads with paced uploads
+Created     :
+Authors     :
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef INC_Render_TextureLoader_h
+#define INC_Render_TextureLoader_h
+
+#include "Render_Device.h"
+#include <Kernel/OVR_Threads.h>
+
+namespace OVR { namespace Render {
+
+// Reads and decodes a texture file, as DDS or TGA by its extension.
+bool DecodeTextureFile(const char* fileName, TextureImage* image);
+
+
+// TextureLoader reads and decodes texture files on worker threads, and creates the
+// textures on the render thread a few at a time. Loading a scene then uses every core
+// for decoding, and the render loop keeps its frame rate while textures are uploaded.
+//
+// A scene loader queues each file with Load, and binds the fills using it with
+// SetFillTexture; the fills show the placeholder texture until the texture is created.
+// The render loop calls Update once per frame with the number of bytes it may upload.
+// Files that fail to load leave their fills with the placeholder.
+class TextureLoader
+{
+public:
+    // Starts 'threadCount' workers; 0 starts one fewer than the CPU count, and at
+    // least one.
+    TextureLoader(int threadCount = 0);
+    ~TextureLoader();
+
+    // Queues a file for decoding, returning its index.
+    int      Load(const char* fileName);
+    // Sets texture 'slot' of 'fill' to the texture once it is created.
+    void     SetFillTexture(int index, ShaderFill* fill, int slot);
+
+    // A mid grey texture for fills to use until theirs are created.
+    Texture* GetPlaceholder(RenderDevice* pRender);
+
+    // Creates decoded textures until 'byteBudget' bytes of image data have been passed
+    // to the device; at least one texture is created per call, whatever its size.
+    // Returns true once every queued texture is created or has failed to load.
+    bool     Update(RenderDevice* pRender, UPInt byteBudget);
+    // Waits for all queued textures to be decoded, and creates them.
+    void     Finish(RenderDevice* pRender);
+    // Drops all textures; those being decoded are discarded when done.
+    void     Clear();
+
+    // Null until the texture is created, or if it failed to load.
+    Texture* GetTexture(int index) const;
+    int      GetCount() const   { return (int)Requests.GetSize(); }
+
+private:
+    struct FillBinding
+    {
+        Ptr<ShaderFill> pFill;
+        int             Slot;
+    };
+
+    // Workers only touch a request's Image between taking it and setting its State
+    // to Decoded or Failed; after that it belongs to the render thread.
+    struct Request : public RefCountBase<Request>
+    {
+        enum StateType
+        {
+            State_Queued,
+            State_Decoded,
+            State_Created,
+            State_Failed
+        };
+
+        String              FileName;
+        StateType           State;
+        TextureImage        Image;
+        Ptr<Texture>        pTexture;
+        Array<FillBinding>  Fills;
+    };
+
+    static int  workerThreadFn(Thread* thread, void* handle);
+    int         workerRun();
+    // Decodes the next queued request on the calling thread; false if there is none.
+    bool        decodeNext();
+
+    // Workers sleep on WorkQueued until NextRequest is behind the end of Requests;
+    // WorkDone is signalled when a request is decoded and when a worker exits.
+    Array<Ptr<Thread> >     Workers;
+    Mutex                   QueueLock;
+    WaitCondition           WorkQueued;
+    WaitCondition           WorkDone;
+    Array<Ptr<Request> >    Requests;
+    UPInt                   NextRequest;
+    int                     RunningWorkers;
+    bool                    Exiting;
+
+    Ptr<Texture>            Placeholder;
+};
+
+}}
+
+#endif
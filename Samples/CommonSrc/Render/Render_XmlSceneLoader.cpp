@@ -22,6 +22,8 @@ limitations under the License.
 ************************************************************************************/
 
 #include "Render_XmlSceneLoader.h"
+#include "Render_MeshOptimizer.h"
+#include "Render_BinarySceneLoader.h"
 #include <Kernel/OVR_Log.h>
 
 #ifdef OVR_DEFINE_NEW
@@ -43,7 +45,8 @@ XmlHandler::~XmlHandler()
 bool XmlHandler::ReadFile(const char* fileName, OVR::Render::RenderDevice* pRender,
 	                      OVR::Render::Scene* pScene,
                           OVR::Array<Ptr<CollisionModel> >* pCollisions,
-	                      OVR::Array<Ptr<CollisionModel> >* pGroundCollisions)
+	                      OVR::Array<Ptr<CollisionModel> >* pGroundCollisions,
+                          TextureLoader* pTextureLoader)
 {
     if(pXmlDocument->LoadFile(fileName) != 0)
     {
@@ -70,11 +73,11 @@ bool XmlHandler::ReadFile(const char* fileName, OVR::Render::RenderDevice* pRend
 		          QueryIntAttribute("count", &textureCount);
     XMLElement* pXmlTexture = pXmlDocument->FirstChildElement("scene")->
 		                                    FirstChildElement("textures")->FirstChildElement("texture");
+    Array<int>  textureLoads;
 
     for(int i = 0; i < textureCount; ++i)
     {
         const char* textureName = pXmlTexture->Attribute("fileName");
-		SPInt       dotpos = strcspn(textureName, ".");
         char        fname[300];
 
 		if (pos == len)
@@ -86,26 +89,29 @@ bool XmlHandler::ReadFile(const char* fileName, OVR::Render::RenderDevice* pRend
 			OVR_sprintf(fname, 300, "%s%s", filePath, textureName);
 		}
 
-        SysFile* pFile = new SysFile(fname);
 		Ptr<Texture> texture;
-		if (textureName[dotpos + 1] == 'd' || textureName[dotpos + 1] == 'D')
+		if (pTextureLoader)
 		{
-			// DDS file
-			texture.SetPtr(*LoadTextureDDS(pRender, pFile));
+			textureLoads.PushBack(pTextureLoader->Load(fname));
+			texture = pTextureLoader->GetPlaceholder(pRender);
 		}
 		else
 		{
-			texture.SetPtr(*LoadTextureTga(pRender, pFile));
+			Texture* loaded = LoadSceneTexture(pRender, fname);
+			if (loaded)
+			{
+				texture = *loaded;
+			}
 		}
 
         Textures.PushBack(texture);
-		pFile->Close();
-		pFile->Release();
+        TextureNames.PushBack(textureName);
         pXmlTexture = pXmlTexture->NextSiblingElement("texture");
     }
 	OVR_DEBUG_LOG_TEXT(("Done.\n"));
 
     // Load the models
+    SceneFillCache fills(pRender, Textures, pTextureLoader, textureLoads);
 	pXmlDocument->FirstChildElement("scene")->FirstChildElement("models")->
 		          QueryIntAttribute("count", &modelCount);
 	
@@ -183,27 +189,10 @@ bool XmlHandler::ReadFile(const char* fileName, OVR::Render::RenderDevice* pRend
             pXmlCurMaterial = pXmlCurMaterial->NextSiblingElement("material");
         }
 
-        //set up the shader
-        Ptr<ShaderFill> shader = *new ShaderFill(*pRender->CreateShaderSet());
-        shader->GetShaders()->SetShader(pRender->LoadBuiltinShader(Shader_Vertex, VShader_MVP));
-        if(diffuseTextureIndex > -1)
-        {
-            shader->SetTexture(0, Textures[diffuseTextureIndex]);
-            if(lightmapTextureIndex > -1)
-            {
-                shader->GetShaders()->SetShader(pRender->LoadBuiltinShader(Shader_Fragment, FShader_MultiTexture));
-                shader->SetTexture(1, Textures[lightmapTextureIndex]);
-            }
-            else
-            {
-                shader->GetShaders()->SetShader(pRender->LoadBuiltinShader(Shader_Fragment, FShader_Texture));
-            }
-        }
-        else
-        {
-            shader->GetShaders()->SetShader(pRender->LoadBuiltinShader(Shader_Fragment, FShader_LitGouraud));
-        }
-        Models[i]->Fill = shader;
+        //set up the shader; models with the same textures share it
+        Models[i]->Fill = fills.GetFill(diffuseTextureIndex, lightmapTextureIndex);
+        DiffuseTextures.PushBack(diffuseTextureIndex);
+        LightmapTextures.PushBack(lightmapTextureIndex);
 
         //add all the vertices to the model
         const UPInt numVerts = vertices->GetSize();
@@ -253,7 +242,7 @@ bool XmlHandler::ReadFile(const char* fileName, OVR::Render::RenderDevice* pRend
                 text[l] = indexStr[j + l];
             }
             text[k - j] = '\0';
-            Models[i]->Indices.InsertAt(0, (unsigned short)atoi(text));
+            Models[i]->Indices.InsertAt(0, (UInt32)atoi(text));
             j = k + 1;
         }
 
@@ -262,6 +251,12 @@ bool XmlHandler::ReadFile(const char* fileName, OVR::Render::RenderDevice* pRend
         delete diffuseUVs;
         delete lightmapUVs;
 
+        // Exported meshes come in no particular triangle order.
+        OptimizeMesh(Models[i]);
+
+        // The second UV set is only needed for lightmaps.
+        Models[i]->SetCompactFormat(lightmapTextureIndex > -1);
+        Models[i]->UpdateBounds();
         pScene->World.Add(Models[i]);
         pScene->Models.PushBack(Models[i]);
         pXmlModel = pXmlModel->NextSiblingElement("model");
@@ -377,6 +372,14 @@ void XmlHandler::ParseVectorString(const char* str, OVR::Array<OVR::Vector3f> *a
     }
 }
 
+bool XmlHandler::WriteBinaryFile(const char* fileName, const FileStat& source,
+                                 const OVR::Array<Ptr<CollisionModel> >& collisions,
+                                 const OVR::Array<Ptr<CollisionModel> >& groundCollisions) const
+{
+    return WriteBinaryScene(fileName, source, TextureNames, Models, DiffuseTextures, LightmapTextures,
+                            collisions, groundCollisions);
+}
+
 }} // OVR::Render
 
 #ifdef OVR_DEFINE_NEW
@@ -25,6 +25,7 @@ limitations under the License.
 #define INC_Render_XMLSceneLoader_h
 
 #include "Render_Device.h"
+#include "Render_TextureLoader.h"
 #include <Kernel/OVR_SysFile.h>
 using namespace OVR;
 using namespace OVR::Render;
@@ -45,10 +46,19 @@ public:
     XmlHandler();
     ~XmlHandler();
 
+    // Textures are loaded before returning unless 'pTextureLoader' is given, in which
+    // case they are queued on it and the fills use its placeholder until then.
     bool ReadFile(const char* fileName, OVR::Render::RenderDevice* pRender,
                   OVR::Render::Scene* pScene,
 		          OVR::Array<Ptr<CollisionModel> >* pColisions,
-                  OVR::Array<Ptr<CollisionModel> >* pGroundCollisions);
+                  OVR::Array<Ptr<CollisionModel> >* pGroundCollisions,
+                  TextureLoader* pTextureLoader = NULL);
+
+    // Writes the scene last read, along with its collision models, as a compiled scene
+    // for BinarySceneLoader. 'source' describes the XML file, as by SysFile::GetFileStat.
+    bool WriteBinaryFile(const char* fileName, const FileStat& source,
+                         const OVR::Array<Ptr<CollisionModel> >& collisions,
+                         const OVR::Array<Ptr<CollisionModel> >& groundCollisions) const;
 
 protected:
     void ParseVectorString(const char* str, OVR::Array<OVR::Vector3f> *array,
@@ -59,8 +69,11 @@ private:
     char                   filePath[250];
     int                    textureCount;
     OVR::Array<Ptr<Texture> > Textures;
+    OVR::Array<String>     TextureNames;
     int                    modelCount;
     OVR::Array<Ptr<Model> > Models;
+    OVR::Array<int>        DiffuseTextures;
+    OVR::Array<int>        LightmapTextures;
     int                    collisionModelCount;
     int                    groundCollisionModelCount;
 };
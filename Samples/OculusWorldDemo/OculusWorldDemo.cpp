@@ -28,6 +28,8 @@ limitations under the License.
 #include "../CommonSrc/Platform/Platform_Default.h"
 #include "../CommonSrc/Render/Render_Device.h"
 #include "../CommonSrc/Render/Render_XMLSceneLoader.h"
+#include "../CommonSrc/Render/Render_BinarySceneLoader.h"
+#include "../CommonSrc/Render/Render_TextureLoader.h"
 #include "../CommonSrc/Render/Render_FontEmbed_DejaVu48.h"
 
 #include <Kernel/OVR_SysFile.h>
@@ -39,6 +41,9 @@ limitations under the License.
 // This path allows the shortcut to work.
 #define WORLDDEMO_ASSET_PATH3 "Samples/OculusWorldDemo/Assets/Tuscany/"
 
+// Chrome trace written by F6 or SIGUSR1, in the working directory.
+static const char* TraceFileName = "OculusWorldDemo_Trace.json";
+
 
 using namespace OVR;
 using namespace OVR::Platform;
@@ -56,6 +61,7 @@ using namespace OVR::Render;
 //  F3 - Stereo and distortion.
 //  F8 - Toggle MSAA.
 //  F9 - Set FullScreen mode on the HMD; necessary for previewing content with Rift.
+//  F6 - Start recording a trace; pressed again, writes it for chrome://tracing.
 //
 // Important Oculus-specific logic can be found at following locations:
 //
@@ -80,7 +86,7 @@ using namespace OVR::Render;
 //    sensor and movement input and then renders the frame.
 //  - Additional input processing is done in OnMouse, OnKey and OnGamepad.
 
-class OculusWorldDemoApp : public Application, public MessageHandler
+class OculusWorldDemoApp : public Application, public MessageHandler, public SceneViewCallback
 {
 public:
     OculusWorldDemoApp();
@@ -97,6 +103,14 @@ public:
     virtual void OnMessage(const Message& msg);
 
     void         Render(const StereoEyeParams& stereo);
+    // Renders both eyes, traversing the scene once for the two of them.
+    void         RenderStereo(const StereoEyeParams& left, const StereoEyeParams& right);
+    // Draws the 2D overlay of an eye into the current scene and finishes it.
+    void         RenderOverlay(const StereoEyeParams& stereo);
+
+    // Computes the view of an eye from the orientation predicted for its scanout.
+    virtual Matrix4f GetEyeView(StereoEye eye);
+    Matrix4f     CalcView(float yaw, float pitch, float roll) const;
 
     // Sets temporarily displayed message for adjustments
     void         SetAdjustMessage(const char* format, ...);
@@ -138,6 +152,10 @@ protected:
 
     Ptr<LatencyTestDevice>  pLatencyTester;
     Util::LatencyTest   LatencyUtil;
+    // Color of the latency quad in the frame being rendered, read once per frame so
+    // that both eyes and a virtual Latency Tester (-vlt) see the same one.
+    bool                LatencyQuadVisible;
+    Color               LatencyQuadColor;
 
     double              LastUpdate;
     int                 FPS;
@@ -146,6 +164,13 @@ protected:
 
     Array<Ptr<CollisionModel> > CollisionModels;
     Array<Ptr<CollisionModel> > GroundCollisionModels;
+    CollisionTree               Collisions;
+    CollisionTree               GroundCollisions;
+    CollisionHeightField        GroundHeights;
+
+    // Scene textures are decoded on worker threads, and created a few per frame.
+    enum { TextureUploadBudget = 4 * 1024 * 1024 };
+    TextureLoader               SceneTextures;
 
     // Loading process displays screenshot in first frame
     // and then proceeds to load until finished.
@@ -170,10 +195,22 @@ protected:
     StereoConfig        SConfig;
     PostProcessType     PostProcess;
 
+    // Each eye is rendered with the orientation predicted for its scanout time;
+    // the distortion pass reprojects the scene to a newer prediction, if Timewarp
+    // is enabled. EyeRenderOrientation is indexed by StereoEye.
+    Util::Render::FrameTiming Timing;
+    Quatf               EyeRenderOrientation[3];
+    bool                Timewarp;
+
+    // Scene render scale follows the GPU frame time, where the renderer can measure
+    // it. The LOD is dropped once frames stay over budget at the lowest scale, or
+    // once the frame rate stays low, which also covers renderers without GPU timing.
+    Util::Render::DynamicResolutionController ResolutionController;
+
     // LOD
     String	            MainFilePath;
     Array<String>       LODFilePaths;
-    int					ConsecutiveLowFPSFrames;
+    int					ConsecutiveOverBudgetFrames;
     int					CurrentLODFileIndex;
 
     float               DistortionK0;
@@ -213,34 +250,43 @@ protected:
         Text_Orientation,
         Text_Config,
         Text_Help,
+        Text_Profiler,
         Text_Count
     };
     TextScreen          TextScreen;
 
+    // While tracing, profiler scopes are recorded for a Chrome trace, which is
+    // written when tracing is stopped or on SIGUSR1.
+    bool                Tracing;
+
     Model* CreateModel(Vector3f pos, struct SlabModel* sm);
     Model* CreateBoundingModel(CollisionModel &cm);
     void PopulateLODFileNames();
     void DropLOD();
     void RaiseLOD();
     void CycleDisplay();
+    void UpdateRefreshRate();
 };
 
 //-------------------------------------------------------------------------------------
 
 OculusWorldDemoApp::OculusWorldDemoApp()
     : pRender(0),
+      LatencyQuadVisible(false),
       LastUpdate(0),
       LoadingState(LoadingState_Frame0),
       // Initial location
       SConfig(),
       PostProcess(PostProcess_Distortion),
+      Timewarp(true),
       DistortionClearColor(0, 0, 0),
 
       ShiftDown(false),
       pAdjustFunc(0),
       AdjustDirection(1.0f),
       SceneMode(Scene_World),
-      TextScreen(Text_None)
+      TextScreen(Text_None),
+      Tracing(false)
 {
     Width  = 1280;
     Height = 800;
@@ -251,7 +297,7 @@ OculusWorldDemoApp::OculusWorldDemoApp()
     FrameCounter = 0;
     NextFPSUpdate = 0;
 
-    ConsecutiveLowFPSFrames = 0;
+    ConsecutiveOverBudgetFrames = 0;
     CurrentLODFileIndex = 0;
 
     AdjustMessageTimeout = 0;
@@ -269,6 +315,10 @@ OculusWorldDemoApp::~OculusWorldDemoApp()
     pHMD.Clear();
 	CollisionModels.ClearAndRelease();
 	GroundCollisionModels.ClearAndRelease();
+    Collisions.Clear();
+    GroundCollisions.Clear();
+    GroundHeights.Clear();
+    SceneTextures.Clear();
 }
 
 int OculusWorldDemoApp::OnStartup(int argc, const char** argv)
@@ -282,6 +332,9 @@ int OculusWorldDemoApp::OnStartup(int argc, const char** argv)
 
     pManager = *DeviceManager::Create();
 
+    Profiler::SetThreadName(GetCurrentThreadId(), "OculusWorldDemo::Render");
+    Profiler::SetTraceSignal(TraceFileName);
+
     // We'll handle it's messages in this case.
     pManager->SetMessageHandler(this);
 
@@ -309,7 +362,17 @@ int OculusWorldDemoApp::OnStartup(int argc, const char** argv)
     }
 
     // Create the Latency Tester device and assign it to the LatencyTesterUtil object.
+    // With -vlt and no tester plugged in, a virtual one reads the latency quad color
+    // reported after each Present.
     pLatencyTester = *pManager->EnumerateDevices<LatencyTestDevice>().CreateDevice();
+    for(int i = 1; (i < argc) && !pLatencyTester; i++)
+    {
+        if(!strcmp(argv[i], "-vlt"))
+        {
+            pManager->SetVirtualLatencyTesterEnabled(true);
+            pLatencyTester = *pManager->EnumerateDevices<LatencyTestDevice>().CreateDevice();
+        }
+    }
     if (pLatencyTester)
     {
         LatencyUtil.SetDevice(pLatencyTester);
@@ -412,8 +475,13 @@ int OculusWorldDemoApp::OnStartup(int argc, const char** argv)
             SConfig.SetDistortionFitPointVP(0.0f, 1.0f);        
     }
 
+    // The scene texture is allocated once for the full distortion scale; the resolution
+    // controller lowers the render scale down to half of it when frames run long.
+    pRender->SetMaxSceneRenderScale(SConfig.GetDistortionScale());
     pRender->SetSceneRenderScale(SConfig.GetDistortionScale());
-    //pRender->SetSceneRenderScale(0.8f);
+    UpdateRefreshRate();
+    ResolutionController.SetScaleRange(SConfig.GetDistortionScale() * 0.5f, SConfig.GetDistortionScale());
+    ResolutionController.Reset(SConfig.GetDistortionScale());
 
     SConfig.Set2DAreaFov(DegreeToRad(85.0f));
 
@@ -636,6 +704,7 @@ void OculusWorldDemoApp::OnKey(KeyCode key, int chr, bool down, int modifiers)
         if(!down)
         {
             TextScreen = (enum TextScreen)((TextScreen + 1) % Text_Count);
+            Profiler::SetEnabled(Tracing || (TextScreen == Text_Profiler));
         }
         break;
 
@@ -672,6 +741,7 @@ void OculusWorldDemoApp::OnKey(KeyCode key, int chr, bool down, int modifiers)
             pPlatform->SetMouseMode(Mouse_Normal);            
             pPlatform->SetFullscreen(RenderParams, pRender->IsFullscreen() ? Display_Window : Display_FakeFullscreen);
             pPlatform->SetMouseMode(Mouse_Relative); // Avoid mode world rotation jump.
+            UpdateRefreshRate();
             // If using an HMD, enable post-process (for distortion) and stereo.
             if(RenderParams.MonitorName.GetLength() && pRender->IsFullscreen())
             {
@@ -689,6 +759,7 @@ void OculusWorldDemoApp::OnKey(KeyCode key, int chr, bool down, int modifiers)
             RenderParams.MonitorName = pPlatform->GetScreenName(0);
             pRender->SetParams(RenderParams);
             Screen = 0;
+            UpdateRefreshRate();
         }
         break;
 
@@ -841,8 +912,31 @@ void OculusWorldDemoApp::OnKey(KeyCode key, int chr, bool down, int modifiers)
                     pNode->Visible = !pNode->Visible;
                 }
             }
-            break;
         }
+        break;
+
+    case Key_P:
+        if (down)
+        {
+            Timewarp = !Timewarp;
+            SetAdjustMessage("Timewarp: %s", Timewarp ? "On" : "Off");
+        }
+        break;
+
+    case Key_F6:
+        if (down)
+        {
+            Tracing = !Tracing;
+            Profiler::SetEnabled(Tracing || (TextScreen == Text_Profiler));
+            if (Tracing)
+                SetAdjustMessage("Tracing");
+            else if (Profiler::WriteChromeTrace(TraceFileName))
+                SetAdjustMessage("Trace written to %s", TraceFileName);
+            else
+                SetAdjustMessage("Failed to write %s", TraceFileName);
+        }
+        break;
+
     case Key_N:
         RaiseLOD();
         break;
@@ -857,6 +951,10 @@ void OculusWorldDemoApp::OnIdle()
     double curtime = pPlatform->GetAppTime();
     float  dt      = float(curtime - LastUpdate);
     LastUpdate     = curtime;
+    Timing.BeginFrame();
+
+    Profiler::EndFrame();
+    OVR_PROFILE_SCOPE("OnIdle");
 
     if (LoadingState == LoadingState_DoLoad)
     {
@@ -865,6 +963,11 @@ void OculusWorldDemoApp::OnIdle()
         return;
     }
 
+    {
+        OVR_PROFILE_SCOPE("TextureUpload");
+        SceneTextures.Update(pRender, TextureUploadBudget);
+    }
+
     // If one of Stereo setting adjustment keys is pressed, adjust related state.
     if (pAdjustFunc)
     {
@@ -880,6 +983,7 @@ void OculusWorldDemoApp::OnIdle()
 
     // Have to place this as close as possible to where the HMD orientation is read.
     LatencyUtil.ProcessInputs();
+    LatencyQuadVisible = LatencyUtil.DisplayScreenColor(LatencyQuadColor);
 
 
     // Handle Sensor motion.
@@ -888,6 +992,9 @@ void OculusWorldDemoApp::OnIdle()
     if(pSensor)
     {
         Quatf    hmdOrient = SFusion.GetOrientation();
+        EyeRenderOrientation[StereoEye_Center] = hmdOrient;
+        EyeRenderOrientation[StereoEye_Left]   = hmdOrient;
+        EyeRenderOrientation[StereoEye_Right]  = hmdOrient;
 
         float    yaw = 0.0f;
         hmdOrient.GetEulerAngles<Axis_Y, Axis_X, Axis_Z>(&yaw, &Player.EyePitch, &Player.EyeRoll);
@@ -912,23 +1019,23 @@ void OculusWorldDemoApp::OnIdle()
     }
     FrameCounter++;
 
-    if(FPS < 40)
+    if(ResolutionController.IsOverBudget() || FPS < 40)
     {
-        ConsecutiveLowFPSFrames++;
+        ConsecutiveOverBudgetFrames++;
     }
     else
     {
-        ConsecutiveLowFPSFrames = 0;
+        ConsecutiveOverBudgetFrames = 0;
     }
 
-    if(ConsecutiveLowFPSFrames > 200)
+    if(ConsecutiveOverBudgetFrames > 200)
     {
         DropLOD();
-        ConsecutiveLowFPSFrames = 0;
+        ConsecutiveOverBudgetFrames = 0;
     }
 
     Player.EyeYaw -= Player.GamepadRotate.x * dt;
-	Player.HandleCollision(dt, &CollisionModels, &GroundCollisionModels, ShiftDown);
+	Player.HandleCollision(dt, Collisions, GroundCollisions, GroundHeights, ShiftDown);
 
     if(!pSensor)
     {
@@ -945,33 +1052,9 @@ void OculusWorldDemoApp::OnIdle()
         }
     }
 
-    // Rotate and position View Camera, using YawPitchRoll in BodyFrame coordinates.
-    //
-    Matrix4f rollPitchYaw = Matrix4f::RotationY(Player.EyeYaw) * Matrix4f::RotationX(Player.EyePitch) *
-                            Matrix4f::RotationZ(Player.EyeRoll);
-    Vector3f up      = rollPitchYaw.Transform(UpVector);
-    Vector3f forward = rollPitchYaw.Transform(ForwardVector);
-
-
-    // Minimal head modeling; should be moved as an option to SensorFusion.
-    float headBaseToEyeHeight     = 0.15f;  // Vertical height of eye from base of head
-    float headBaseToEyeProtrusion = 0.09f;  // Distance forward of eye from base of head
-
-    Vector3f eyeCenterInHeadFrame(0.0f, headBaseToEyeHeight, -headBaseToEyeProtrusion);
-    Vector3f shiftedEyePos = Player.EyePos + rollPitchYaw.Transform(eyeCenterInHeadFrame);
-    shiftedEyePos.y -= eyeCenterInHeadFrame.y; // Bring the head back down to original height
-    View = Matrix4f::LookAtRH(shiftedEyePos, shiftedEyePos + forward, up);
-
-    //  Transformation without head modeling.
-    // View = Matrix4f::LookAtRH(EyePos, EyePos + forward, up);
-
-    // This is an alternative to LookAtRH:
-    // Here we transpose the rotation matrix to get its inverse.
-    //  View = (Matrix4f::RotationY(EyeYaw) * Matrix4f::RotationX(EyePitch) *
-    //                                        Matrix4f::RotationZ(EyeRoll)).Transposed() *
-    //         Matrix4f::Translation(-EyePos);
-
+    View = CalcView(Player.EyeYaw, Player.EyePitch, Player.EyeRoll);
 
+    pRender->BeginGPUFrameTimer();
     switch(SConfig.GetStereoMode())
     {
     case Stereo_None:
@@ -980,15 +1063,43 @@ void OculusWorldDemoApp::OnIdle()
 
     case Stereo_LeftRight_Multipass:
         //case Stereo_LeftDouble_Multipass:
-        Render(SConfig.GetEyeRenderParams(StereoEye_Left));
-        Render(SConfig.GetEyeRenderParams(StereoEye_Right));
+        RenderStereo(SConfig.GetEyeRenderParams(StereoEye_Left),
+                     SConfig.GetEyeRenderParams(StereoEye_Right));
         break;
 
     }
+    pRender->EndGPUFrameTimer();
 
-    pRender->Present();
+    double presentStart = pPlatform->GetAppTime();
+    {
+        OVR_PROFILE_SCOPE("Present");
+        pRender->Present();
+    }
+    // With vsync, Present returns at vsync; this keeps the scanout estimates in phase.
+    Timing.MarkVSync();
+
+    // A virtual Latency Tester senses the quad through this report; the quad sits in
+    // the middle of the panel, which is scanned out with the center eye. Hardware
+    // testers ignore it.
+    if (pLatencyTester && LatencyQuadVisible)
+    {
+        pLatencyTester->ReportScanoutColor(LatencyQuadColor, Timing.GetEyeScanoutTicks(StereoEye_Center));
+    }
     // Force GPU to flush the scene, resulting in the lowest possible latency.
-    pRender->ForceFlushGPU();
+    {
+        OVR_PROFILE_SCOPE("ForceFlushGPU");
+        pRender->ForceFlushGPU();
+    }
+
+    // The GPU time is that of a frame or two ago, as the timer queries are read
+    // without waiting on the GPU. Without it the scale is left alone: the CPU time
+    // alone can't tell whether rendering fewer pixels would help.
+    float gpuTime = pRender->GetGPUFrameTime();
+    if (gpuTime > 0)
+    {
+        float cpuTime = float(presentStart - curtime);
+        pRender->SetSceneRenderScale(ResolutionController.Update(cpuTime, gpuTime));
+    }
 }
 
 static const char* HelpText =
@@ -999,6 +1110,8 @@ static const char* HelpText =
     "F8\t100 MSAA       \t420 Shift   \t630 Adjust Faster\n"
     "F9\t100 FullScreen \t420 F11     \t630 Fast FullScreen\n"
 	"- +\t100 Adjust EyeHeight\n"
+    "P \t100 Timewarp\n"
+    "F6\t100 Start/Write Trace\n"
     "R \t100 Reset SensorFusion"    
     ;
 
@@ -1033,8 +1146,113 @@ static void DrawTextBox(RenderDevice* prender, float x, float y,
     prender->RenderText(&DejaVu, text, x, y, textSize, Color(255,255,0,210));
 }
 
+// Draws the scopes of a profiler frame as bars, one row per thread and nesting level,
+// with 'width' corresponding to 'duration' seconds from the frame start.
+static void DrawProfilerTimeline(RenderDevice* prender, const ProfilerFrame& frame,
+                                 float x, float y, float width, float rowHeight, double duration)
+{
+    static const Color depthColors[4] =
+    {
+        Color(200, 80, 60, 210), Color(60, 170, 80, 210), Color(70, 110, 210, 210), Color(190, 170, 60, 210)
+    };
+
+    // Rows of each thread start below the deepest row of the thread before it.
+    int   rowBase = 0, threadRows = 0, thread = -1;
+    float scale   = width / float(duration);
+
+    prender->FillRect(x - 0.01f, y - 0.01f, x + width + 0.01f, y + rowHeight * 6 + 0.01f, Color(40,40,100,160));
+
+    for (int i = 0; i < frame.ScopeCount; i++)
+    {
+        const ProfilerScope& scope = frame.Scopes[i];
+        if (scope.Thread != thread)
+        {
+            rowBase   += threadRows;
+            threadRows = 0;
+            thread     = scope.Thread;
+        }
+        threadRows = Alg::Max(threadRows, scope.Depth + 1);
+
+        float left  = x + float(frame.ToSeconds(scope.Start)) * scale;
+        float right = x + float(frame.ToSeconds(scope.End)) * scale;
+        if (left > x + width)
+            continue;
+        right = Alg::Max(Alg::Min(right, x + width), left + 0.002f);
+
+        float top = y + (rowBase + scope.Depth) * rowHeight;
+        prender->FillRect(left, top, right, top + rowHeight * 0.8f, depthColors[scope.Depth % 4]);
+    }
+}
+
+// Lists the scopes of a profiler frame as a tree, with the time spent in each. Repeated
+// scopes under the same parent, such as the sensor messages of a frame, are combined.
+static void FormatProfilerFrame(const ProfilerFrame& frame, char* buf, UPInt size)
+{
+    enum { MaxLines = 40 };
+    struct Line
+    {
+        const char* Name;
+        int         Thread, Depth, Parent, Count;
+        double      Time;
+    } lines[MaxLines];
+    int lineCount = 0, thread = -1;
+    int parents[Profiler::MaxDepth];
+
+    for (int i = 0; i < frame.ScopeCount; i++)
+    {
+        const ProfilerScope& scope = frame.Scopes[i];
+        if (scope.Thread != thread)
+        {
+            // Parents of a thread's first scopes may have started before the frame.
+            for (int d = 0; d < Profiler::MaxDepth; d++)
+                parents[d] = -1;
+            thread = scope.Thread;
+        }
+
+        int    parent = (scope.Depth > 0) ? parents[scope.Depth - 1] : -1;
+        double time   = double(scope.End - scope.Start) / double(frame.RawFrequency);
+
+        int line = parent + 1;
+        for (; line < lineCount; line++)
+        {
+            if ((lines[line].Parent == parent) && (lines[line].Thread == scope.Thread) &&
+                (lines[line].Depth == scope.Depth) && !OVR_strcmp(lines[line].Name, scope.Name))
+                break;
+        }
+        if (line == lineCount)
+        {
+            if (lineCount == MaxLines)
+                break;
+            Line& l  = lines[lineCount++];
+            l.Name   = scope.Name;
+            l.Thread = scope.Thread;
+            l.Depth  = scope.Depth;
+            l.Parent = parent;
+            l.Count  = 0;
+            l.Time   = 0;
+        }
+        lines[line].Count++;
+        lines[line].Time += time;
+        parents[scope.Depth] = line;
+    }
+
+    // Lines are prefixed with the index of their thread.
+    UPInt length = OVR_sprintf(buf, size, "Frame\t300 %6.2f ms", frame.GetDuration() * 1000.0);
+    for (int i = 0; (i < lineCount) && (length + 80 < size); i++)
+    {
+        const Line& l = lines[i];
+        char count[16] = "";
+        if (l.Count > 1)
+            OVR_sprintf(count, sizeof(count), " x%d", l.Count);
+        length += OVR_sprintf(buf + length, size - length, "\n%d %*s%s%s\t300 %6.2f ms",
+                              l.Thread, l.Depth * 2, "", l.Name, count, l.Time * 1000.0);
+    }
+}
+
 void OculusWorldDemoApp::Render(const StereoEyeParams& stereo)
 {
+    OVR_PROFILE_SCOPE("Render");
+
     pRender->BeginScene(PostProcess);
 
     // *** 3D - Configures Viewport/Projection and Render
@@ -1044,9 +1262,43 @@ void OculusWorldDemoApp::Render(const StereoEyeParams& stereo)
     pRender->SetDepthMode(true, true);
     if (SceneMode != Scene_Grid)
     {
-        MainScene.Render(pRender, stereo.ViewAdjust * View);
+        MainScene.Render(pRender, this, stereo.Eye);
+    }
+
+    RenderOverlay(stereo);
+}
+
+void OculusWorldDemoApp::RenderStereo(const StereoEyeParams& left, const StereoEyeParams& right)
+{
+    OVR_PROFILE_SCOPE("RenderStereo");
+
+    // Both eyes share the scene render target, so the 3D scene of both can be drawn
+    // before either is distorted; the overlays are drawn per eye afterwards.
+    pRender->BeginScene(PostProcess);
+
+    pRender->ApplyStereoParams(left);
+    pRender->Clear();
+    pRender->ApplyStereoParams(right);
+    pRender->Clear();
+
+    pRender->SetDepthMode(true, true);
+    if (SceneMode != Scene_Grid)
+    {
+        MainScene.RenderStereo(pRender, this, left, right);
     }
 
+    RenderOverlay(left);
+
+    // FinishScene has returned to the back buffer; resume the scene for the right eye.
+    pRender->BeginScene(PostProcess);
+    pRender->ApplyStereoParams(right);
+    RenderOverlay(right);
+}
+
+void OculusWorldDemoApp::RenderOverlay(const StereoEyeParams& stereo)
+{
+    OVR_PROFILE_SCOPE((stereo.Eye == StereoEye_Left)  ? "RenderOverlay Left" :
+                      (stereo.Eye == StereoEye_Right) ? "RenderOverlay Right" : "RenderOverlay");
 
     // *** 2D Text & Grid - Configure Orthographic rendering.
 
@@ -1086,10 +1338,10 @@ void OculusWorldDemoApp::Render(const StereoEyeParams& stereo)
         size_t texMemInMB = pRender->GetTotalTextureMemoryUsage() / 1058576;
         OVR_sprintf(buf, sizeof(buf),
                     " Yaw:%4.0f  Pitch:%4.0f  Roll:%4.0f \n"
-                    " FPS: %d  Frame: %d \n Pos: %3.2f, %3.2f, %3.2f \n"
+                    " FPS: %d  Frame: %d  Scale: %3.2f \n Pos: %3.2f, %3.2f, %3.2f \n"
                     " GPU Tex: %u MB \n EyeHeight: %3.2f",
                     RadToDegree(Player.EyeYaw), RadToDegree(Player.EyePitch), RadToDegree(Player.EyeRoll),
-                    FPS, FrameCounter, Player.EyePos.x, Player.EyePos.y, Player.EyePos.z, texMemInMB, Player.EyePos.y);
+                    FPS, FrameCounter, pRender->GetSceneRenderScale(), Player.EyePos.x, Player.EyePos.y, Player.EyePos.z, texMemInMB, Player.EyePos.y);
             DrawTextBox(pRender, 0, 0.05f, textHeight, buf, DrawText_HCenter);
     }
     break;
@@ -1120,20 +1372,87 @@ void OculusWorldDemoApp::Render(const StereoEyeParams& stereo)
 
     case Text_Help:
         DrawTextBox(pRender, 0, 0, textHeight, HelpText, DrawText_Center);
+        break;
+
+    case Text_Profiler:
+    {
+        // Last frame on top, the slowest of the last seconds below, both on a scale
+        // of two refresh periods; the text breaks the slowest frame down.
+        char   textBuff[4096];
+        double scale = 2.0 / Timing.GetRefreshRate();
+
+        DrawProfilerTimeline(pRender, Profiler::GetLastFrame(), -0.6f, -0.7f, 1.2f, textHeight, scale);
+        DrawProfilerTimeline(pRender, Profiler::GetPeakFrame(), -0.6f, -0.3f, 1.2f, textHeight, scale);
+
+        FormatProfilerFrame(Profiler::GetPeakFrame(), textBuff, sizeof(textBuff));
+        DrawTextBox(pRender, -0.6f, 0.1f, textHeight, textBuff);
+    }
     }
 
 
     // Display colored quad if we're doing a latency test.
-    Color colorToDisplay;
-    if (LatencyUtil.DisplayScreenColor(colorToDisplay))
+    if (LatencyQuadVisible)
     {
-        pRender->FillRect(-0.4f, -0.4f, 0.4f, 0.4f, colorToDisplay);
+        pRender->FillRect(-0.4f, -0.4f, 0.4f, 0.4f, LatencyQuadColor);
+    }
+
+    // Read the orientation again as late as possible, so that the distortion pass
+    // can correct for head motion since View was computed.
+    if (pSensor && Timewarp)
+    {
+        pRender->SetTimewarpMatrix(stereo.CalculateTimewarpMatrix(EyeRenderOrientation[stereo.Eye],
+                                                                  Timing.GetPredictedOrientation(SFusion, stereo.Eye)));
     }
 
     pRender->FinishScene();
 }
 
 
+// Rotate and position View Camera, using YawPitchRoll in BodyFrame coordinates.
+Matrix4f OculusWorldDemoApp::CalcView(float yaw, float pitch, float roll) const
+{
+    Matrix4f rollPitchYaw = Matrix4f::RotationY(yaw) * Matrix4f::RotationX(pitch) *
+                            Matrix4f::RotationZ(roll);
+    Vector3f up      = rollPitchYaw.Transform(UpVector);
+    Vector3f forward = rollPitchYaw.Transform(ForwardVector);
+
+
+    // Minimal head modeling; should be moved as an option to SensorFusion.
+    float headBaseToEyeHeight     = 0.15f;  // Vertical height of eye from base of head
+    float headBaseToEyeProtrusion = 0.09f;  // Distance forward of eye from base of head
+
+    Vector3f eyeCenterInHeadFrame(0.0f, headBaseToEyeHeight, -headBaseToEyeProtrusion);
+    Vector3f shiftedEyePos = Player.EyePos + rollPitchYaw.Transform(eyeCenterInHeadFrame);
+    shiftedEyePos.y -= eyeCenterInHeadFrame.y; // Bring the head back down to original height
+    return Matrix4f::LookAtRH(shiftedEyePos, shiftedEyePos + forward, up);
+
+    //  Transformation without head modeling.
+    // return Matrix4f::LookAtRH(EyePos, EyePos + forward, up);
+
+    // This is an alternative to LookAtRH:
+    // Here we transpose the rotation matrix to get its inverse.
+    //  return (Matrix4f::RotationY(EyeYaw) * Matrix4f::RotationX(EyePitch) *
+    //                                        Matrix4f::RotationZ(EyeRoll)).Transposed() *
+    //         Matrix4f::Translation(-EyePos);
+}
+
+Matrix4f OculusWorldDemoApp::GetEyeView(StereoEye eye)
+{
+    const Matrix4f& viewAdjust = SConfig.GetEyeRenderParams(eye).ViewAdjust;
+    if (!pSensor)
+        return viewAdjust * View;
+
+    // Late-latch the orientation for this eye, keeping the yaw added by mouse and
+    // gamepad the same as for the rest of the frame.
+    Quatf hmdOrient = Timing.GetPredictedOrientation(SFusion, eye);
+    EyeRenderOrientation[eye] = hmdOrient;
+
+    float yaw = 0.0f, pitch = 0.0f, roll = 0.0f;
+    hmdOrient.GetEulerAngles<Axis_Y, Axis_X, Axis_Z>(&yaw, &pitch, &roll);
+    return viewAdjust * CalcView(Player.EyeYaw + (yaw - Player.LastSensorYaw), pitch, roll);
+}
+
+
 // Sets temporarily displayed message for adjustments
 void OculusWorldDemoApp::SetAdjustMessage(const char* format, ...)
 {
@@ -1196,13 +1515,40 @@ void OculusWorldDemoApp::AdjustEyeHeight(float dt)
 // Loads the scene data
 void OculusWorldDemoApp::PopulateScene(const char *fileName)
 {    
-    XmlHandler xmlHandler;     
-    if(!xmlHandler.ReadFile(fileName, pRender, &MainScene, &CollisionModels, &GroundCollisionModels))
+    // The scene is loaded from its compiled copy when there is an up to date one, as
+    // that takes no parsing; otherwise the copy is written once the XML is loaded.
+    String binaryFileName = fileName;
+    binaryFileName.StripExtension();
+    binaryFileName += ".ovrscene";
+
+    // Without the XML, the compiled copy is used as it is.
+    FileStat xmlStat;
+    bool     haveXml = SysFile::GetFileStat(&xmlStat, fileName);
+
+    BinarySceneLoader binaryLoader;
+    if (!binaryLoader.ReadFile(binaryFileName, pRender, &MainScene, &CollisionModels, &GroundCollisionModels,
+                               haveXml ? &xmlStat : NULL, &SceneTextures))
     {
-        SetAdjustMessage("---------------------------------\nFILE LOAD FAILED\n---------------------------------");
-        SetAdjustMessageTimeout(10.0f);
-    }    
+        XmlHandler xmlHandler;     
+        if(!xmlHandler.ReadFile(fileName, pRender, &MainScene, &CollisionModels, &GroundCollisionModels,
+                                &SceneTextures))
+        {
+            SetAdjustMessage("---------------------------------\nFILE LOAD FAILED\n---------------------------------");
+            SetAdjustMessageTimeout(10.0f);
+        }
+        else if (haveXml)
+        {
+            xmlHandler.WriteBinaryFile(binaryFileName, xmlStat, CollisionModels, GroundCollisionModels);
+        }
+    }
+
+    // Collision queries only visit the models near the player.
+    Collisions.Build(CollisionModels);
+    GroundCollisions.Build(GroundCollisionModels);
+    GroundHeights.Build(GroundCollisionModels);
 
+    // Loaded models are static, so those sharing a fill are drawn as one batch.
+    MainScene.BuildBatches();
     MainScene.SetAmbient(Vector4f(1.0f, 1.0f, 1.0f, 1.0f));
     
     // Distortion debug grid (brought up by 'G' key).
@@ -1250,6 +1596,10 @@ void OculusWorldDemoApp::ClearScene()
 {
     MainScene.Clear();
     GridScene.Clear();
+    SceneTextures.Clear();
+    // Collision models are reloaded with the scene, and written with its compiled copy.
+    CollisionModels.Clear();
+    GroundCollisionModels.Clear();
 }
 
 void OculusWorldDemoApp::PopulateLODFileNames()
@@ -1362,6 +1712,19 @@ void OculusWorldDemoApp::CycleDisplay()
         pRender->SetParams(RenderParams);
         pPlatform->SetFullscreen(RenderParams, Display_Fullscreen);
     }
+    UpdateRefreshRate();
+}
+
+// Frame timing follows the refresh rate of the display the window is on, where
+// the renderer can report it.
+void OculusWorldDemoApp::UpdateRefreshRate()
+{
+    float refreshRate = pRender->GetRefreshRate();
+    if (refreshRate <= 0)
+        refreshRate = 60.0f;
+
+    Timing.SetRefreshRate(refreshRate);
+    ResolutionController.SetTargetFrameTime(1.0f / refreshRate);
 }
 
 //-------------------------------------------------------------------------------------
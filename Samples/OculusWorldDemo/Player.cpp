@@ -22,6 +22,7 @@ limitations under the License.
 
 #include "Player.h"
 #include <Kernel/OVR_Alg.h>
+#include <Kernel/OVR_Profiler.h>
 
 Player::Player(void)
 	: EyeHeight(1.8f),
@@ -39,9 +40,12 @@ Player::~Player(void)
 {
 }
 
-void Player::HandleCollision(double dt, Array<Ptr<CollisionModel> >* collisionModels,
-	                         Array<Ptr<CollisionModel> >* groundCollisionModels, bool shiftDown)
+void Player::HandleCollision(double dt, const CollisionTree& collisions,
+	                         const CollisionTree& groundCollisions,
+	                         const CollisionHeightField& groundHeights, bool shiftDown)
 {
+    OVR_PROFILE_SCOPE("HandleCollision");
+
 	if(MoveForward || MoveBack || MoveLeft || MoveRight || GamepadMove.LengthSq() > 0)
     {
         Vector3f orientationVector;
@@ -84,42 +88,27 @@ void Player::HandleCollision(double dt, Array<Ptr<CollisionModel> >* collisionMo
 
         float moveLength = OVR::Alg::Min<float>(MoveSpeed * (float)dt * (shiftDown ? 3.0f : 1.0f), 1.0f);
 
-        float   checkLengthForward = moveLength;
-        Planef  collisionPlaneForward;
-        float   checkLengthLeft = moveLength;
-        Planef  collisionPlaneLeft;
-        float   checkLengthRight = moveLength;
-        Planef  collisionPlaneRight;
-        bool    gotCollision = false;
-        bool    gotCollisionLeft = false;
-        bool    gotCollisionRight = false;
-
-        for(unsigned int i = 0; i < collisionModels->GetSize(); ++i)
+        // Checks for collisions at eye level, which should prevent us from
+        // slipping under walls. The forward, left and right probes are tested as one packet.
+        Matrix4f     leftRotation  = Matrix4f::RotationY(45 * (Math<float>::Pi / 180.0f));
+        Matrix4f     rightRotation = Matrix4f::RotationY(-45 * (Math<float>::Pi / 180.0f));
+        CollisionRay probes[3];
+        probes[0].Norm = orientationVector;
+        probes[1].Norm = leftRotation.Transform(orientationVector);
+        probes[2].Norm = rightRotation.Transform(orientationVector);
+        for (int i = 0; i < 3; i++)
         {
-            // Checks for collisions at eye level, which should prevent us from
-			// slipping under walls
-            if (collisionModels->At(i)->TestRay(EyePos, orientationVector, checkLengthForward,
-				                                &collisionPlaneForward))
-            {
-                gotCollision = true;
-            }
-
-            Matrix4f leftRotation = Matrix4f::RotationY(45 * (Math<float>::Pi / 180.0f));
-            Vector3f leftVector   = leftRotation.Transform(orientationVector);
-            if (collisionModels->At(i)->TestRay(EyePos, leftVector, checkLengthLeft,
-				                                &collisionPlaneLeft))
-            {
-                gotCollisionLeft = true;
-            }
-            Matrix4f rightRotation = Matrix4f::RotationY(-45 * (Math<float>::Pi / 180.0f));
-            Vector3f rightVector   = rightRotation.Transform(orientationVector);
-            if (collisionModels->At(i)->TestRay(EyePos, rightVector, checkLengthRight,
-				                                &collisionPlaneRight))
-            {
-                gotCollisionRight = true;
-            }
+            probes[i].Origin = EyePos;
+            probes[i].Len    = moveLength;
         }
 
+        bool    gotCollisions[3];
+        Planef  collisionPlanes[3];
+        collisions.TestRays(probes, 3, gotCollisions, collisionPlanes);
+
+        bool    gotCollision = gotCollisions[0];
+        Planef& collisionPlaneForward = collisionPlanes[0];
+
         if (gotCollision)
         {
             // Project orientationVector onto the plane
@@ -127,13 +116,9 @@ void Player::HandleCollision(double dt, Array<Ptr<CollisionModel> >* collisionMo
 				* (orientationVector * collisionPlaneForward.N);
 
             // Make sure we aren't in a corner
-            for(unsigned int j = 0; j < collisionModels->GetSize(); ++j)
+            if (collisions.TestPoint(EyePos - Vector3f(0.0f, RailHeight, 0.0f) + (slideVector * (moveLength))))
             {
-                if (collisionModels->At(j)->TestPoint(EyePos - Vector3f(0.0f, RailHeight, 0.0f) +
-					                                  (slideVector * (moveLength))) )
-                {
-                    moveLength = 0;
-                }
+                moveLength = 0;
             }
             if (moveLength != 0)
             {
@@ -147,14 +132,13 @@ void Player::HandleCollision(double dt, Array<Ptr<CollisionModel> >* collisionMo
         Planef collisionPlaneDown;
         float finalDistanceDown = 10;
 
-        for(unsigned int i = 0; i < groundCollisionModels->GetSize(); ++i)
+        float checkLengthDown = 10;
+        bool  gotGround = groundHeights.IsEmpty() ?
+                          groundCollisions.TestRay(EyePos, Vector3f(0.0f, -1.0f, 0.0f), checkLengthDown, &collisionPlaneDown) :
+                          groundHeights.TestDown(EyePos, checkLengthDown, &collisionPlaneDown);
+        if (gotGround)
         {
-            float checkLengthDown = 10;
-            if (groundCollisionModels->At(i)->TestRay(EyePos, Vector3f(0.0f, -1.0f, 0.0f),
-				                                      checkLengthDown, &collisionPlaneDown))
-            {
-                finalDistanceDown = Alg::Min(finalDistanceDown, checkLengthDown);
-            }
+            finalDistanceDown = Alg::Min(finalDistanceDown, checkLengthDown);
         }
 
         // Maintain the minimum camera height
@@ -26,6 +26,8 @@ limitations under the License.
 
 #include "OVR.h"
 #include "../CommonSrc/Render/Render_Device.h"
+#include "../CommonSrc/Render/Render_CollisionTree.h"
+#include "../CommonSrc/Render/Render_HeightField.h"
 
 using namespace OVR;
 using namespace OVR::Render;
@@ -72,8 +74,11 @@ public:
 
 	Player(void);
 	~Player(void);
-	void HandleCollision(double dt, Array<Ptr<CollisionModel> >* collisionModels,
-		                 Array<Ptr<CollisionModel> >* groundCollisionModels, bool shiftDown);
+	// The ground is looked up in 'groundHeights' if it was built, and in
+	// 'groundCollisions' otherwise.
+	void HandleCollision(double dt, const CollisionTree& collisions,
+		                 const CollisionTree& groundCollisions,
+		                 const CollisionHeightField& groundHeights, bool shiftDown);
 };
 
 #endif